@@ -7,7 +7,17 @@ class AES128Decryptor {
 public:
     static bool decryptFile(const std::string& inputPath, const std::string& outputPath,
         const std::vector<uint8_t>& key, std::string& error);
+    static bool decryptFile(const std::string& inputPath, const std::string& outputPath,
+        const std::vector<uint8_t>& key, size_t jobs, std::string& error);
+
+    // Plaintext bytes [offset, offset + length) of a chunked or segmented file,
+    // decrypting only the chunks that cover them.
+    static bool decryptRange(const std::string& inputPath, uint64_t offset, uint64_t length,
+        std::ostream& out, const std::vector<uint8_t>& key, std::string& error);
 
-private:
-    static void readHeader(std::ifstream& in, std::vector<uint8_t>& iv, std::string& md5);
+    // Decrypts a whole .crypt image held in memory into `out`, which must hold
+    // decryptedSize() bytes. The output is only valid when true is returned.
+    static bool decryptedSize(const uint8_t* in, size_t inSize, size_t& plainSize, std::string& error);
+    static bool decrypt(const uint8_t* in, size_t inSize, uint8_t* out, size_t outCapacity, size_t& outSize,
+        const std::vector<uint8_t>& key, std::string& error);
 };
\ No newline at end of file
@@ -1,79 +1,31 @@
 #include "AES256Decryptor.h"
-#include "FileValidator.h"
-#include "KeyGenerator.h"
-#include <fstream>
-#include <cryptopp/aes.h>
-#include <cryptopp/gcm.h>
-#include <cryptopp/filters.h>
+#include "CryptoSession.h"
+#include "ThreadPool.h"
 
 bool AES256Decryptor::decryptFile(const std::string& inputPath, const std::string& outputPath,
     const std::vector<uint8_t>& key, std::string& error) {
-    try {
-        std::ifstream inFile(inputPath, std::ios::binary);
-        if (!inFile.is_open()) {
-            error = "Cannot open encrypted file.";
-            return false;
-        }
+    return decryptFile(inputPath, outputPath, key, ThreadPool::defaultThreadCount(), error);
+}
 
-        uint8_t algId;
-        inFile.read(reinterpret_cast<char*>(&algId), sizeof(algId));
-
-        if (algId != 0x02) {
-            error = "File was not encrypted with AES-256. Use the correct decryption algorithm.";
-            inFile.close();
-            return false;
-        }
-
-        std::vector<uint8_t> iv(12);
-        std::string storedMD5(32, '\0');
-        inFile.read(reinterpret_cast<char*>(iv.data()), iv.size());
-        inFile.read(&storedMD5[0], 32);
-
-        inFile.seekg(0, std::ios::end);
-        size_t totalSize = inFile.tellg();
-        size_t dataStart = 1 + 12 + 32;
-        size_t dataSize = totalSize - dataStart;
-
-        inFile.seekg(dataStart);
-        std::vector<uint8_t> ciphertext(dataSize);
-        inFile.read(reinterpret_cast<char*>(ciphertext.data()), dataSize);
-        inFile.close();
-
-        std::string plaintext;
-        CryptoPP::GCM<CryptoPP::AES>::Decryption dec;
-        dec.SetKeyWithIV(key.data(), key.size(), iv.data(), iv.size());
-
-        try {
-            CryptoPP::StringSource ss(ciphertext.data(), ciphertext.size(), true,
-                new CryptoPP::AuthenticatedDecryptionFilter(dec,
-                    new CryptoPP::StringSink(plaintext)
-                )
-            );
-        }
-        catch (const CryptoPP::Exception&) {
-            error = "Authentication failed - invalid key or corrupted file.";
-            return false;
-        }
-
-        std::ofstream outFile(outputPath, std::ios::binary);
-        if (!outFile.is_open()) {
-            error = "Cannot create output file.";
-            return false;
-        }
-        outFile.write(plaintext.data(), plaintext.size());
-        outFile.close();
-
-        std::string computedMD5 = FileValidator::computeMD5(outputPath);
-        if (computedMD5 != storedMD5) {
-            error = "File integrity check failed - possible corruption.";
-            std::remove(outputPath.c_str());
-            return false;
-        }
-
-        return true;
-    }
-    catch (const std::exception& e) {
-        error = std::string("Decryption error: ") + e.what();
-        return false;
-    }
+bool AES256Decryptor::decryptFile(const std::string& inputPath, const std::string& outputPath,
+    const std::vector<uint8_t>& key, size_t jobs, std::string& error) {
+    DecryptionSession session;
+    session.setPipelined(true);
+    return session.setKey(key, false, error) && session.decryptFile(inputPath, outputPath, jobs, error);
+}
+
+bool AES256Decryptor::decryptRange(const std::string& inputPath, uint64_t offset, uint64_t length,
+    std::ostream& out, const std::vector<uint8_t>& key, std::string& error) {
+    DecryptionSession session;
+    return session.setKey(key, false, error) && session.decryptRange(inputPath, offset, length, out, error);
+}
+
+bool AES256Decryptor::decryptedSize(const uint8_t* in, size_t inSize, size_t& plainSize, std::string& error) {
+    return DecryptionSession::decryptedSize(in, inSize, plainSize, error);
+}
+
+bool AES256Decryptor::decrypt(const uint8_t* in, size_t inSize, uint8_t* out, size_t outCapacity, size_t& outSize,
+    const std::vector<uint8_t>& key, std::string& error) {
+    DecryptionSession session;
+    return session.setKey(key, false, error) && session.decrypt(in, inSize, out, outCapacity, outSize, error);
 }
\ No newline at end of file
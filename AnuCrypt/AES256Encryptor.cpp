@@ -1,49 +1,26 @@
 #include "AES256Encryptor.h"
-#include "FileValidator.h"
-#include "KeyGenerator.h"
-#include <fstream>
-#include <cryptopp/aes.h>
-#include <cryptopp/gcm.h>
-#include <cryptopp/filters.h>
-#include <cryptopp/osrng.h>
-#include <cryptopp/files.h> 
+#include "CryptFormat.h"
+#include "CryptoSession.h"
+#include "SegmentedCipher.h"
 
 bool AES256Encryptor::encryptFile(const std::string& inputPath, const std::string& outputPath,
     const std::vector<uint8_t>& key, std::string& error) {
-    try {
-        std::string md5 = FileValidator::computeMD5(inputPath);
+    EncryptionSession session;
+    session.setPipelined(true);
+    return session.setKey(key, false, error) && session.encryptFile(inputPath, outputPath, error);
+}
 
-        CryptoPP::AutoSeededRandomPool rng;
-        std::vector<uint8_t> iv(12);
-        rng.GenerateBlock(iv.data(), iv.size());
+bool AES256Encryptor::encryptFileParallel(const std::string& inputPath, const std::string& outputPath,
+    const std::vector<uint8_t>& key, size_t jobs, std::string& error) {
+    return SegmentedCipher::encryptFile(inputPath, outputPath, key, CryptFormat::AES256_SEGMENTED, jobs, error);
+}
 
-        std::string ciphertext;
-        CryptoPP::GCM<CryptoPP::AES>::Encryption enc;
-        enc.SetKeyWithIV(key.data(), key.size(), iv.data(), iv.size());
+uint64_t AES256Encryptor::encryptedSize(uint64_t plainSize) {
+    return EncryptionSession::encryptedSize(plainSize);
+}
 
-        CryptoPP::FileSource fs(inputPath.c_str(), true,
-            new CryptoPP::AuthenticatedEncryptionFilter(enc,
-                new CryptoPP::StringSink(ciphertext)
-            )
-        );
-
-        std::ofstream outFile(outputPath, std::ios::binary);
-        if (!outFile.is_open()) {
-            error = "Cannot open output file.";
-            return false;
-        }
-
-        uint8_t algId = 0x02; 
-        outFile.write(reinterpret_cast<const char*>(&algId), sizeof(algId));
-        outFile.write(reinterpret_cast<const char*>(iv.data()), iv.size());
-        outFile.write(md5.data(), md5.size());
-        outFile.write(ciphertext.data(), ciphertext.size());
-        outFile.close();
-
-        return true;
-    }
-    catch (const std::exception& e) {
-        error = e.what();
-        return false;
-    }
+bool AES256Encryptor::encrypt(const uint8_t* in, size_t inSize, uint8_t* out, size_t outCapacity, size_t& outSize,
+    const std::vector<uint8_t>& key, std::string& error) {
+    EncryptionSession session;
+    return session.setKey(key, false, error) && session.encrypt(in, inSize, out, outCapacity, outSize, error);
 }
\ No newline at end of file
@@ -7,4 +7,15 @@ class AES256Encryptor {
 public:
     static bool encryptFile(const std::string& inputPath, const std::string& outputPath,
                             const std::vector<uint8_t>& key, std::string& error);
+
+    // Splits the file into segments that are encrypted concurrently on `jobs` threads.
+    static bool encryptFileParallel(const std::string& inputPath, const std::string& outputPath,
+                                    const std::vector<uint8_t>& key, size_t jobs, std::string& error);
+
+    // Encrypts a buffer into the .crypt layout encryptFile writes. `out` must
+    // hold encryptedSize(inSize) bytes. To encrypt many buffers under one key,
+    // keep an EncryptionSession instead.
+    static uint64_t encryptedSize(uint64_t plainSize);
+    static bool encrypt(const uint8_t* in, size_t inSize, uint8_t* out, size_t outCapacity, size_t& outSize,
+                        const std::vector<uint8_t>& key, std::string& error);
 };
\ No newline at end of file
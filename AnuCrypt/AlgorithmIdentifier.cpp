@@ -1,59 +1,161 @@
 #include "AlgorithmIdentifier.h"
-#include <fstream>
-#include <cryptopp/base64.h>
-#include <cryptopp/filters.h>
+#include "CryptFormat.h"
+#include "CpuFeatures.h"
+#include "FileView.h"
+#include "FileSystem.h"
+#include "ReorderBuffer.h"
+#include "ThreadPool.h"
 #include <algorithm>
-#include <cctype>
+#include <bitset>
+#include <mutex>
+#ifdef ANUCRYPT_X86
+#include <immintrin.h>
+#endif
 
-AlgorithmIdentifier::AlgorithmType AlgorithmIdentifier::identifyFromFile(const std::string& filepath) {
-    std::ifstream file(filepath, std::ios::binary);
-    if (!file.is_open()) {
-        return UNKNOWN;
-    }
+namespace {
+    enum CharClass : uint8_t {
+        SPACE = 1,
+        HEX = 2,
+        BASE64 = 4,
+        PAD = 8
+    };
 
-    // Try to read first byte to identify encrypted files
-    uint8_t algId;
-    if (file.read(reinterpret_cast<char*>(&algId), sizeof(algId))) {
-        file.close();
+    struct ClassTable {
+        uint8_t classes[256];
 
-        switch (algId) {
-        case 0x01:
-            return AES128;
-        case 0x02:
-            return AES256;
-        default:
-            break;
+        ClassTable() {
+            std::fill(classes, classes + 256, static_cast<uint8_t>(0));
+            for (char c : { ' ', '\t', '\n', '\v', '\f', '\r' }) {
+                classes[static_cast<uint8_t>(c)] = SPACE;
+            }
+            for (const char* c = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/"; *c; ++c) {
+                classes[static_cast<uint8_t>(*c)] = BASE64;
+            }
+            for (const char* c = "0123456789ABCDEFabcdef"; *c; ++c) {
+                classes[static_cast<uint8_t>(*c)] |= HEX;
+            }
+            classes[static_cast<uint8_t>('=')] = BASE64 | PAD;
         }
+    };
+
+    const ClassTable& classTable() {
+        static const ClassTable table;
+        return table;
     }
-    else {
-        file.close();
+
+    // Returns how far it got; it stops early once neither verdict can hold.
+    size_t scanScalar(const uint8_t* data, size_t size, size_t& length, size_t& padding, bool& hex, bool& base64) {
+        const uint8_t* classes = classTable().classes;
+        size_t i = 0;
+        for (; i < size && (hex || base64); ++i) {
+            uint8_t cls = classes[data[i]];
+            if (cls & SPACE) {
+                continue;
+            }
+            ++length;
+            padding += (cls & PAD) ? 1 : 0;
+            hex = hex && (cls & HEX) != 0;
+            base64 = base64 && (cls & BASE64) != 0;
+        }
+        return i;
     }
 
-    // If not an encrypted file, read content to check for hashes or Base64
-    file.open(filepath, std::ios::binary);
-    file.seekg(0, std::ios::end);
-    size_t size = file.tellg();
-    if (size > 0) {
-        file.seekg(0, std::ios::beg);
-        std::string content(size, '\0');
-        file.read(&content[0], size);
-        file.close();
+#ifdef ANUCRYPT_X86
+    ANUCRYPT_TARGET("avx2")
+    inline __m256i inRange(__m256i c, char lo, char hi) {
+        // Bytes above 0x7F are negative and fall outside every ASCII range.
+        return _mm256_and_si256(_mm256_cmpgt_epi8(c, _mm256_set1_epi8(lo - 1)),
+            _mm256_cmpgt_epi8(_mm256_set1_epi8(hi + 1), c));
+    }
 
-        // Remove whitespace and newlines
-        content.erase(std::remove_if(content.begin(), content.end(), ::isspace), content.end());
+    ANUCRYPT_TARGET("avx2")
+    size_t scanAVX2(const uint8_t* data, size_t size, size_t& length, size_t& padding, bool& hex, bool& base64) {
+        size_t i = 0;
+        for (; i + 32 <= size && (hex || base64); i += 32) {
+            __m256i c = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+            __m256i lower = _mm256_or_si256(c, _mm256_set1_epi8(0x20));
 
-        // Check if content looks like hexadecimal hash
-        if (content.find_first_not_of("0123456789ABCDEFabcdef") == std::string::npos) {
-            return identifyHashFromHex(content);
+            __m256i space = _mm256_or_si256(_mm256_cmpeq_epi8(c, _mm256_set1_epi8(' ')), inRange(c, '\t', '\r'));
+            __m256i digit = inRange(c, '0', '9');
+            __m256i isHex = _mm256_or_si256(digit, inRange(lower, 'a', 'f'));
+            __m256i pad = _mm256_cmpeq_epi8(c, _mm256_set1_epi8('='));
+            __m256i isBase64 = _mm256_or_si256(_mm256_or_si256(digit, inRange(lower, 'a', 'z')),
+                _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(c, _mm256_set1_epi8('+')),
+                    _mm256_cmpeq_epi8(c, _mm256_set1_epi8('/'))), pad));
+
+            uint32_t spaceMask = static_cast<uint32_t>(_mm256_movemask_epi8(space));
+            length += 32 - std::bitset<32>(spaceMask).count();
+            padding += std::bitset<32>(static_cast<uint32_t>(_mm256_movemask_epi8(pad))).count();
+            hex = hex && static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_or_si256(isHex, space))) == 0xFFFFFFFFu;
+            base64 = base64 &&
+                static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_or_si256(isBase64, space))) == 0xFFFFFFFFu;
         }
+        return i;
+    }
+#endif
+}
+
+void AlgorithmIdentifier::scan(const uint8_t* data, size_t size, CharScan& result) {
+    size_t done = 0;
+#ifdef ANUCRYPT_X86
+    static const bool avx2 = CpuFeatures::hasAVX2();
+    if (avx2) {
+        done = scanAVX2(data, size, result.length, result.padding, result.hex, result.base64);
+    }
+#endif
+    scanScalar(data + done, size - done, result.length, result.padding, result.hex, result.base64);
+}
 
-        // Check if content looks like Base64
-        if (content.find_first_not_of("ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/=") == std::string::npos) {
-            return BASE64_ENCODED;
+AlgorithmIdentifier::AlgorithmType AlgorithmIdentifier::identifyFromFile(const std::string& filepath) {
+    FileView file;
+    if (!file.open(filepath) || file.empty()) {
+        return UNKNOWN;
+    }
+    return identifyFromData(file.data(), file.size());
+}
+
+AlgorithmIdentifier::AlgorithmType AlgorithmIdentifier::identifyFromData(const uint8_t* data, size_t size) {
+    if (size == 0) {
+        return UNKNOWN;
+    }
+
+    // Check the first byte to identify encrypted files
+    switch (data[0]) {
+    case CryptFormat::AES128_LEGACY:
+    case CryptFormat::AES128_CHUNKED:
+    case CryptFormat::AES128_SEGMENTED:
+    case CryptFormat::AES128_ARCHIVE:
+        return AES128;
+    case CryptFormat::AES256_LEGACY:
+    case CryptFormat::AES256_CHUNKED:
+    case CryptFormat::AES256_SEGMENTED:
+    case CryptFormat::AES256_ARCHIVE:
+        return AES256;
+    default:
+        break;
+    }
+
+    // If not an encrypted file, look for hashes or Base64, ignoring whitespace
+    // and newlines. Past the prefix only evenly spaced windows are checked, the
+    // last one ending at the end of the data.
+    CharScan result;
+    scan(data, std::min(size, PREFIX_SIZE), result);
+    if (size > PREFIX_SIZE) {
+        result.hex = false;
+        size_t span = size - PREFIX_SIZE;
+        for (size_t i = 1; i <= WINDOW_COUNT && result.base64; ++i) {
+            size_t end = PREFIX_SIZE + static_cast<size_t>(static_cast<double>(span) * i / WINDOW_COUNT);
+            size_t start = std::max(PREFIX_SIZE, end > WINDOW_SIZE ? end - WINDOW_SIZE : 0);
+            scan(data + start, end - start, result);
         }
     }
-    else {
-        file.close();
+
+    if (result.length > 0 && result.hex) {
+        return identifyHashFromLength(result.length);
+    }
+
+    if (result.length > 0 && result.base64) {
+        return BASE64_ENCODED;
     }
 
     return UNKNOWN;
@@ -64,38 +166,64 @@ AlgorithmIdentifier::AlgorithmType AlgorithmIdentifier::identifyFromText(const s
         return UNKNOWN;
     }
 
-    // Remove whitespace and newlines
-    std::string cleanText = text;
-    cleanText.erase(std::remove_if(cleanText.begin(), cleanText.end(), ::isspace), cleanText.end());
+    CharScan result;
+    scan(reinterpret_cast<const uint8_t*>(text.data()), text.size(), result);
 
     // Check if text looks like hexadecimal hash
-    if (cleanText.find_first_not_of("0123456789ABCDEFabcdef") == std::string::npos) {
-        return identifyHashFromHex(cleanText);
+    if (result.hex) {
+        return identifyHashFromLength(result.length);
     }
 
-    // Check if text looks like Base64 encoded data
-    if (cleanText.find_first_not_of("ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/=") == std::string::npos) {
-        // Additional validation - try to decode it
+    // Check if text looks like Base64 encoded data; it needs at least two
+    // characters besides padding to decode to anything
+    if (result.base64 && result.length - result.padding >= 2) {
+        return BASE64_ENCODED;
+    }
+
+    return UNKNOWN;
+}
+
+bool AlgorithmIdentifier::identifyFolder(const std::string& folder, size_t jobs, std::ostream& out,
+    FolderSummary& summary, std::string& error) {
+    ReorderBuffer results(out, OUTPUT_BUFFER_SIZE);
+    std::mutex countMutex;
+    bool traversalOk = true;
+    summary = FolderSummary();
+
+    {
+        ThreadPool pool(jobs, jobs * 64);
+
         try {
-            CryptoPP::Base64Decoder decoder;
-            decoder.Put(reinterpret_cast<const CryptoPP::byte*>(cleanText.data()), cleanText.size());
-            decoder.MessageEnd();
+            for (auto& entry : fs::recursive_directory_iterator(folder)) {
+                if (!fs::is_regular_file(entry.status())) {
+                    continue;
+                }
 
-            if (decoder.MaxRetrievable() > 0) {
-                return BASE64_ENCODED;
+                std::string path = entry.path().string();
+                size_t sequence = summary.files++;
+                pool.submit([&, path, sequence] {
+                    AlgorithmType alg = identifyFromFile(path);
+                    {
+                        std::lock_guard<std::mutex> lock(countMutex);
+                        ++summary.counts[alg];
+                    }
+                    results.complete(sequence, path + ": " + algorithmToString(alg) + "\n");
+                });
             }
         }
-        catch (...) {
-            // If decoding fails, it's probably not Base64
+        catch (const std::exception& e) {
+            error = e.what();
+            traversalOk = false;
         }
+
+        pool.wait();
     }
 
-    return UNKNOWN;
+    results.finish();
+    return traversalOk;
 }
 
-AlgorithmIdentifier::AlgorithmType AlgorithmIdentifier::identifyHashFromHex(const std::string& hexString) {
-    size_t length = hexString.length();
-
+AlgorithmIdentifier::AlgorithmType AlgorithmIdentifier::identifyHashFromLength(size_t length) {
     switch (length) {
     case 32:  // 128 bits
         return MD5_HASH;
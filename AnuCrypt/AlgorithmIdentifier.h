@@ -1,5 +1,7 @@
 #pragma once
 #include <string>
+#include <iostream>
+#include <cstdint>
 
 class AlgorithmIdentifier {
 public:
@@ -13,10 +15,38 @@ public:
         UNKNOWN
     };
 
+    struct FolderSummary {
+        size_t files = 0;
+        size_t counts[UNKNOWN + 1] = {};
+    };
+
+    // Files larger than PREFIX_SIZE are judged from the prefix plus a few sampled
+    // windows, so the cost does not grow with the file. A hash file is at most
+    // 64 characters plus whitespace, so only a prefix-sized file can be one.
     static AlgorithmType identifyFromFile(const std::string& filepath);
     static AlgorithmIdentifier::AlgorithmType identifyFromText(const std::string& text);
+    static AlgorithmType identifyFromData(const uint8_t* data, size_t size);
     static std::string algorithmToString(AlgorithmType alg);
 
+    // Classifies every file under a folder on `jobs` threads and writes one
+    // "path: type" line per file, in traversal order.
+    static bool identifyFolder(const std::string& folder, size_t jobs, std::ostream& out,
+                               FolderSummary& summary, std::string& error);
+
 private:
-    static AlgorithmType identifyHashFromHex(const std::string& hexString);
+    // Character classes seen in a range; whitespace is skipped throughout.
+    struct CharScan {
+        size_t length = 0;   // non-whitespace characters
+        size_t padding = 0;  // '=' characters
+        bool hex = true;
+        bool base64 = true;
+    };
+
+    static void scan(const uint8_t* data, size_t size, CharScan& result);
+    static AlgorithmType identifyHashFromLength(size_t length);
+
+    static constexpr size_t PREFIX_SIZE = 64 * 1024;
+    static const size_t WINDOW_SIZE = 4 * 1024;
+    static const size_t WINDOW_COUNT = 8;
+    static const size_t OUTPUT_BUFFER_SIZE = 64 * 1024;
 };
\ No newline at end of file
@@ -3,13 +3,19 @@
 #include <vector>
 #include <fstream>
 #include <map>
+#include <algorithm>
+#include <sstream>
+#include <cstdio>
+#include <cstdlib>
+#include <chrono>
+#ifdef _WIN32
 #include <windows.h>
-#define _SILENCE_EXPERIMENTAL_FILESYSTEM_DEPRECATION_WARNING
-#if defined(_MSC_VER) && (_MSC_VER >= 1910)
-#include <experimental/filesystem>
-namespace fs = std::experimental::filesystem;
+#include <io.h>
+#include <fcntl.h>
 #endif
 
+#include "FileSystem.h"
+#include "FileView.h"
 #include "KeyGenerator.h"
 #include "KeyValidator.h"
 #include "AES128Encryptor.h"
@@ -17,10 +23,20 @@ namespace fs = std::experimental::filesystem;
 #include "AES256Encryptor.h"
 #include "AES256Decryptor.h"
 #include "FileValidator.h"
-#include "Base64Encoder.h"
-#include "Base64Decoder.h"
+#include "Base64Stream.h"
 #include "Hashing.h"
 #include "AlgorithmIdentifier.h"
+#include "FolderEncryptor.h"
+#include "FolderHasher.h"
+#include "ThreadPool.h"
+#include "Benchmark.h"
+#include "Archive.h"
+#include "IOEngine.h"
+#include "BatchHasher.h"
+#include "CryptoBackend.h"
+#include "Daemon.h"
+#include "Batch.h"
+#include "SelfTest.h"
 
 const std::string VERSION = "1.0.0";
 
@@ -57,21 +73,6 @@ void saveSettings() {
     }
 }
 
-std::string getRelativePath(const fs::path& fullPath, const fs::path& baseDir) {
-    std::string fullPathStr = fullPath.string();
-    std::string baseDirStr = baseDir.string();
-
-    if (!baseDirStr.empty() && baseDirStr.back() != '\\' && baseDirStr.back() != '/') {
-        baseDirStr += '\\';
-    }
-
-    if (fullPathStr.substr(0, baseDirStr.length()) == baseDirStr) {
-        return fullPathStr.substr(baseDirStr.length());
-    }
-
-    return fullPathStr;
-}
-
 std::string generateDefaultOutputPath(const std::string& inputPath, bool isEncrypting) {
     if (isEncrypting) {
         return inputPath + ".crypt";
@@ -87,32 +88,90 @@ std::string generateDefaultOutputPath(const std::string& inputPath, bool isEncry
     }
 }
 
-std::vector<uint8_t> readFileAsBinary(const std::string& filepath) {
-    std::ifstream file(filepath, std::ios::binary);
+bool writeBinaryToFile(const std::string& filepath, const std::vector<uint8_t>& data) {
+    std::ofstream file(filepath, std::ios::binary);
     if (!file.is_open()) {
-        return std::vector<uint8_t>();
+        return false;
     }
 
-    file.seekg(0, std::ios::end);
-    size_t size = file.tellg();
-    file.seekg(0, std::ios::beg);
-
-    std::vector<uint8_t> data(size);
-    file.read(reinterpret_cast<char*>(data.data()), size);
+    file.write(reinterpret_cast<const char*>(data.data()), data.size());
     file.close();
+    return true;
+}
 
-    return data;
+// Base64 input is stdin for "-", the named file if there is one, or otherwise
+// the argument itself.
+std::istream& openBase64Input(const std::string& input, std::ifstream& file, std::istringstream& text) {
+    if (input == "-") {
+#ifdef _WIN32
+        _setmode(_fileno(stdin), _O_BINARY);
+#endif
+        return std::cin;
+    }
+
+    if (fs::is_regular_file(input)) {
+        file.open(input, std::ios::binary);
+        if (file.is_open()) {
+            return file;
+        }
+    }
+
+    text.str(input);
+    return text;
 }
 
-bool writeBinaryToFile(const std::string& filepath, const std::vector<uint8_t>& data) {
-    std::ofstream file(filepath, std::ios::binary);
-    if (!file.is_open()) {
+// "<offset>:<length>" in bytes
+bool parseRange(const std::string& value, uint64_t& offset, uint64_t& length) {
+    size_t colon = value.find(':');
+    if (colon == std::string::npos) {
         return false;
     }
+    try {
+        size_t pos = 0;
+        std::string first = value.substr(0, colon);
+        std::string second = value.substr(colon + 1);
+        offset = std::stoull(first, &pos);
+        if (pos != first.size() || first[0] == '-') {
+            return false;
+        }
+        length = std::stoull(second, &pos);
+        return pos == second.size() && second[0] != '-';
+    }
+    catch (const std::exception&) {
+        return false;
+    }
+}
 
-    file.write(reinterpret_cast<const char*>(data.data()), data.size());
-    file.close();
-    return true;
+bool parseJobs(const std::string& value, size_t& jobs) {
+    try {
+        size_t pos = 0;
+        unsigned long count = std::stoul(value, &pos);
+        if (pos != value.size() || count == 0) {
+            return false;
+        }
+        jobs = count;
+        return true;
+    }
+    catch (const std::exception&) {
+        return false;
+    }
+}
+
+// Requests in flight per worker unless --io-depth says otherwise; fewer workers
+// get deeper queues so the device sees about the same load either way.
+size_t defaultIODepth(size_t jobs) {
+    return std::max<size_t>(4, 32 / std::max<size_t>(jobs, 1));
+}
+
+void printIOStats(const std::string& backend, const IOEngine::Stats& stats, double seconds) {
+    double megabytes = (stats.bytesRead + stats.bytesWritten) / (1024.0 * 1024.0);
+    std::ostringstream line;
+    line.setf(std::ios::fixed);
+    line.precision(1);
+    line << "I/O: " << backend << ", " << stats.reads << " reads, " << stats.writes << " writes, "
+         << megabytes << " MB in " << seconds << " s (" << (seconds > 0 ? megabytes / seconds : 0) << " MB/s), "
+         << "queue depth avg " << stats.averageDepth() << " max " << stats.maxDepth;
+    std::cerr << line.str() << std::endl;
 }
 
 void printHelp() {
@@ -124,22 +183,51 @@ void printHelp() {
     std::cout << "  --encode              : Encode file or text (use with --base64)\n";
     std::cout << "  --decode              : Decode file or text (use with --base64)\n";
     std::cout << "  -f   | --folder       : Encrypt all files in folder (recursive)\n";
+    std::cout << "  -j   | --jobs         : Worker threads for folder and parallel operations (default: all cores)\n";
+    std::cout << "  --parallel            : Encrypt a single file in segments on several threads\n";
+    std::cout << "  --io                  : Folder I/O through io_uring or an I/O thread pool (auto, uring, threads)\n";
     std::cout << "  -vk  | --validatekey  : Validate key file\n";
     std::cout << "  -dk  | --defaultkey   : Set default key path\n";
     std::cout << "  -v   | --version      : Show version\n";
     std::cout << "  -h   | --help         : Help Information\n";
-    std::cout << "  --hash                : Hash files or text\n";
+    std::cout << "  --hash                : Hash files or text (--md5, --sha1/--rc2, --sha256; combine them or use --all)\n";
     std::cout << "  -aid | --algorithmidentifier : Identify algorithm used in file\n";
+    std::cout << "  --speed               : Benchmark ciphers, hashes and Base64 (MB/s and cycles/byte)\n";
+    std::cout << "  --selftest            : Check that Base64 kernels and crypto backends agree byte for byte on this machine\n";
+    std::cout << "  --archive             : Pack a folder into one encrypted archive, list or extract it\n";
+    std::cout << "  --backend             : Crypto library for any command (cryptopp, openssl, or auto to time both)\n";
+    std::cout << "  --batch               : Run many jobs from a job file or stdin, with JSON-lines results\n";
+    std::cout << "  --daemon              : Serve jobs over a Unix socket with keys and workers kept warm\n";
+    std::cout << "  --client              : Run an encrypt, decrypt, hash, encode, decode or identify job on the daemon\n";
     std::cout << "\nUsage:\n";
     std::cout << "  AnuCrypt --generatekey --256bit\n";
     std::cout << "  AnuCrypt --encrypt --aes256 <file> --output <output> --key <keyfile>\n";
-    std::cout << "  AnuCrypt --encrypt --folder --aes256 <input_dir> --output <output_dir> --key <keyfile>\n";
-    std::cout << "  AnuCrypt --decrypt --aes256 <file.crypt> --output <output> --key <keyfile>\n";
-    std::cout << "  AnuCrypt --encode --base64 <file or text> [--output <file>]\n";
-    std::cout << "  AnuCrypt --decode --base64 <file or text> [--output <file>]\n";
+    std::cout << "  AnuCrypt --encrypt --folder --aes256 <input_dir> --output <output_dir> --key <keyfile> [--jobs N]\n";
+    std::cout << "  AnuCrypt --encrypt --folder --aes256 <input_dir> --output <output_dir> --key <keyfile> --incremental [--state <file>] [--prune]\n";
+    std::cout << "  AnuCrypt --encrypt --folder --aes256 <input_dir> --output <output_dir> --key <keyfile> --io auto [--io-depth N]\n";
+    std::cout << "  AnuCrypt --encrypt --parallel --aes256 <file> --output <output> --key <keyfile> [--jobs N]\n";
+    std::cout << "  AnuCrypt --decrypt --aes256 <file.crypt> --output <output> --key <keyfile> [--jobs N]\n";
+    std::cout << "  AnuCrypt --decrypt --aes256 <file.crypt> --range <offset>:<length> [--output <file>] --key <keyfile>\n";
+    std::cout << "  AnuCrypt --encode --base64 <file, text or - for stdin> [--output <file>] [--nowrap] [--url] [--jobs N]\n";
+    std::cout << "  AnuCrypt --decode --base64 <file, text or - for stdin> [--output <file>] [--url]\n";
     std::cout << "  AnuCrypt --hash --rc2 <file or text> [--output <file>]\n";
-    std::cout << "  AnuCrypt --hash --folder --rc2 <folder> [--output <file>]\n";
+    std::cout << "  AnuCrypt --hash --folder --rc2 <folder> [--output <file>] [--sort] [--jobs N]\n";
+    std::cout << "  AnuCrypt --hash --folder --sha256 <folder> --cache <file> [--rehash] [--spot-check <percent>]\n";
+    std::cout << "  AnuCrypt --hash --folder --sha256 <folder> --io uring [--io-depth N]\n";
+    std::cout << "  AnuCrypt --hash --lines --sha256 <file> [--output <file>]\n";
+    std::cout << "  AnuCrypt --hash --all <file or text> [--jobs N] [--output <file>]\n";
+    std::cout << "  AnuCrypt --archive --pack --aes256 <folder> --output <archive> --key <keyfile>\n";
+    std::cout << "  AnuCrypt --archive --list --aes256 <archive> --key <keyfile>\n";
+    std::cout << "  AnuCrypt --archive --extract --aes256 <archive> [--member <path>] --output <path> --key <keyfile>\n";
     std::cout << "  AnuCrypt --algorithmidentifier <file or text>\n";
+    std::cout << "  AnuCrypt --algorithmidentifier --folder <folder> [--jobs N]\n";
+    std::cout << "  AnuCrypt --backend auto --encrypt --aes256 <file> --output <output> --key <keyfile>\n";
+    std::cout << "  AnuCrypt --batch <jobfile or - for stdin> [--jobs N] [--output <file>]\n";
+    std::cout << "  AnuCrypt --daemon [--socket <path>] [--jobs N]\n";
+    std::cout << "  AnuCrypt --client [--socket <path>] --encrypt --aes256 <file> [--output <output>] [--key <keyfile>]\n";
+    std::cout << "  AnuCrypt --client [--socket <path>] --hash --sha256 <file or text>\n";
+    std::cout << "  AnuCrypt --client [--socket <path>] --shutdown\n";
+    std::cout << "  AnuCrypt --speed [--json] [--sizes 64,16K,64M] [--threads 1,4] [--only sha256,md5] [--time 0.25] [--output <file>]\n";
     std::cout << "  AnuCrypt -e --base64 <file or text> [--output <file>] (short for encode)\n";
     std::cout << "  AnuCrypt -d --base64 <file or text> [--output <file>] (short for decode)\n";
 }
@@ -155,7 +243,10 @@ std::map<std::string, std::string> parseArguments(const std::vector<std::string>
         if (arg == "--128bit" || arg == "--192bit" || arg == "--256bit" ||
             arg == "--aes128" || arg == "--aes256" || arg == "--rc2" ||
             arg == "--md5" || arg == "--sha256" || arg == "--base64" ||
-            arg == "--folder") {
+            arg == "--folder" || arg == "--sort" || arg == "--parallel" ||
+            arg == "--sha1" || arg == "--all" || arg == "--nowrap" || arg == "--url" ||
+            arg == "--json" || arg == "--rehash" || arg == "--incremental" || arg == "--prune" ||
+            arg == "--pack" || arg == "--list" || arg == "--extract" || arg == "--lines") {
             parsedArgs[arg] = "true";
             continue;
         }
@@ -163,6 +254,9 @@ std::map<std::string, std::string> parseArguments(const std::vector<std::string>
         // Handle key-value pairs
         if (arg == "--output" || arg == "-o" ||
             arg == "--key" || arg == "-k" ||
+            arg == "--jobs" || arg == "-j" ||
+            arg == "--cache" || arg == "--spot-check" || arg == "--state" || arg == "--member" ||
+            arg == "--range" || arg == "--io" || arg == "--io-depth" ||
             arg == "--algorithmidentifier" || arg == "-aid") {
             if (i + 1 < args.size()) {
                 parsedArgs[arg] = args[i + 1];
@@ -216,6 +310,28 @@ int main(int argc, char* argv[]) {
         args.push_back(argv[i]);
     }
 
+    // --backend applies to every command, so it is taken out before they parse.
+    for (size_t i = 0; i < args.size(); ++i) {
+        if (args[i] != "--backend") {
+            continue;
+        }
+        if (i + 1 >= args.size()) {
+            std::cerr << "Error: --backend needs cryptopp, openssl or auto." << std::endl;
+            return 1;
+        }
+        std::string error;
+        if (!CryptoBackend::select(args[i + 1], &std::cerr, error)) {
+            std::cerr << "Error: " << error << std::endl;
+            return 1;
+        }
+        args.erase(args.begin() + i, args.begin() + i + 2);
+        break;
+    }
+    if (args.empty()) {
+        printHelp();
+        return 1;
+    }
+
     std::string cmd = args[0];
 
     // Handle version command
@@ -224,6 +340,481 @@ int main(int argc, char* argv[]) {
         return 0;
     }
 
+    // Handle speed command
+    if (cmd == "--speed") {
+        Benchmark::Options options = Benchmark::defaultOptions();
+        bool json = false;
+        std::string output = "";
+
+        auto splitList = [](const std::string& value) {
+            std::vector<std::string> items;
+            std::stringstream stream(value);
+            std::string item;
+            while (std::getline(stream, item, ',')) {
+                if (!item.empty()) {
+                    items.push_back(item);
+                }
+            }
+            return items;
+        };
+
+        for (size_t i = 1; i < args.size(); ++i) {
+            bool hasValue = i + 1 < args.size();
+            if (args[i] == "--json") {
+                json = true;
+            }
+            else if (args[i] == "--sizes" && hasValue) {
+                options.sizes.clear();
+                for (const auto& item : splitList(args[++i])) {
+                    size_t size;
+                    if (!Benchmark::parseSize(item, size)) {
+                        std::cerr << "Invalid size: " << item << std::endl;
+                        return 1;
+                    }
+                    options.sizes.push_back(size);
+                }
+            }
+            else if ((args[i] == "--threads" || args[i] == "--jobs" || args[i] == "-j") && hasValue) {
+                options.threads.clear();
+                for (const auto& item : splitList(args[++i])) {
+                    size_t threads;
+                    if (!parseJobs(item, threads)) {
+                        std::cerr << "Invalid thread count: " << item << std::endl;
+                        return 1;
+                    }
+                    options.threads.push_back(threads);
+                }
+            }
+            else if (args[i] == "--only" && hasValue) {
+                options.primitives = splitList(args[++i]);
+            }
+            else if (args[i] == "--time" && hasValue) {
+                try {
+                    options.seconds = std::stod(args[++i]);
+                }
+                catch (const std::exception&) {
+                    options.seconds = 0;
+                }
+                if (options.seconds <= 0) {
+                    std::cerr << "Invalid time: " << args[i] << std::endl;
+                    return 1;
+                }
+            }
+            else if ((args[i] == "--output" || args[i] == "-o") && hasValue) {
+                output = args[++i];
+            }
+        }
+
+        if (options.sizes.empty() || options.threads.empty()) {
+            std::cerr << "Usage: --speed [--json] [--sizes 64,16K,64M] [--threads 1,4] [--only <primitives>] [--time <seconds>] [--output <file>]\n";
+            return 1;
+        }
+
+        std::vector<Benchmark::Result> results;
+        std::string error;
+        if (!Benchmark::run(options, results, json ? nullptr : &std::cout, error)) {
+            std::cerr << error << std::endl;
+            return 1;
+        }
+
+        if (json) {
+            if (!output.empty()) {
+                std::ofstream outFile(output);
+                if (!outFile.is_open()) {
+                    std::cerr << "Cannot create output file: " << output << std::endl;
+                    return 1;
+                }
+                Benchmark::writeJson(outFile, results, VERSION);
+                std::cout << "Results written to: " << output << std::endl;
+            }
+            else {
+                Benchmark::writeJson(std::cout, results, VERSION);
+            }
+        }
+        return 0;
+    }
+
+    // Handle batch command
+    if (cmd == "--batch") {
+        Batch::Options options;
+        options.jobs = ThreadPool::defaultThreadCount();
+        options.defaultKeyPath = defaultKeyPath;
+        options.defaultOutputPath = generateDefaultOutputPath;
+        std::string input = "";
+        std::string output = "";
+
+        for (size_t i = 1; i < args.size(); ++i) {
+            bool hasValue = i + 1 < args.size();
+            if ((args[i] == "--jobs" || args[i] == "-j") && hasValue) {
+                if (!parseJobs(args[++i], options.jobs)) {
+                    std::cerr << "Invalid job count: " << args[i] << std::endl;
+                    return 1;
+                }
+            }
+            else if ((args[i] == "--output" || args[i] == "-o") && hasValue) {
+                output = args[++i];
+            }
+            else if (input.empty() && (args[i] == "-" || args[i][0] != '-')) {
+                input = args[i];
+            }
+        }
+
+        if (input.empty()) {
+            std::cerr << "Usage: --batch <jobfile or - for stdin> [--jobs N] [--output <file>]\n";
+            return 1;
+        }
+
+        std::ifstream inFile;
+        if (input != "-") {
+            inFile.open(input);
+            if (!inFile.is_open()) {
+                std::cerr << "Cannot open job file: " << input << std::endl;
+                return 1;
+            }
+        }
+        std::istream& in = inFile.is_open() ? static_cast<std::istream&>(inFile) : std::cin;
+
+        std::ofstream outFile;
+        if (!output.empty()) {
+            outFile.open(output, std::ios::binary);
+            if (!outFile.is_open()) {
+                std::cerr << "Cannot create output file: " << output << std::endl;
+                return 1;
+            }
+        }
+        std::ostream& out = outFile.is_open() ? static_cast<std::ostream&>(outFile) : std::cout;
+
+        Batch::Summary summary;
+        std::string error;
+        if (!Batch::run(in, out, options, summary, error)) {
+            std::cerr << "Error: " << error << std::endl;
+            return 1;
+        }
+
+        std::cerr << "Ran " << summary.jobs << " job(s) in " << summary.seconds << " s";
+        if (summary.failed > 0) {
+            std::cerr << ", " << summary.failed << " failed";
+        }
+        std::cerr << std::endl;
+        return summary.failed > 0 ? 1 : 0;
+    }
+
+    // Handle daemon command
+    if (cmd == "--daemon") {
+        Daemon::Options options;
+        options.socketPath = Daemon::defaultSocketPath();
+        options.jobs = ThreadPool::defaultThreadCount();
+
+        for (size_t i = 1; i < args.size(); ++i) {
+            bool hasValue = i + 1 < args.size();
+            if (args[i] == "--socket" && hasValue) {
+                options.socketPath = args[++i];
+            }
+            else if ((args[i] == "--jobs" || args[i] == "-j") && hasValue) {
+                if (!parseJobs(args[++i], options.jobs)) {
+                    std::cerr << "Invalid job count: " << args[i] << std::endl;
+                    return 1;
+                }
+            }
+        }
+
+        std::string error;
+        if (!Daemon::serve(options, &std::cerr, error)) {
+            std::cerr << "Error: " << error << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+
+    // Handle client command: one job, sent to a running daemon
+    if (cmd == "--client") {
+        std::string socketPath = Daemon::defaultSocketPath();
+        std::string action = "";
+        bool is128 = false;
+        bool is256 = false;
+        bool isBase64 = false;
+        std::string input = "";
+        std::string output = "";
+        std::string keyPath = "";
+        Daemon::Request request;
+
+        for (size_t i = 1; i < args.size(); ++i) {
+            bool hasValue = i + 1 < args.size();
+            if (args[i] == "--socket" && hasValue) {
+                socketPath = args[++i];
+            }
+            else if (action.empty() && (args[i] == "-e" || args[i] == "--encrypt" || args[i] == "--encode" ||
+                     args[i] == "-d" || args[i] == "--decrypt" || args[i] == "--decode" || args[i] == "--hash" ||
+                     args[i] == "-aid" || args[i] == "--algorithmidentifier" || args[i] == "--shutdown")) {
+                action = args[i];
+            }
+            else if (args[i] == "--aes128") {
+                is128 = true;
+            }
+            else if (args[i] == "--aes256") {
+                is256 = true;
+            }
+            else if (args[i] == "--base64") {
+                isBase64 = true;
+            }
+            else if (args[i] == "--md5") {
+                request.flags |= Daemon::MD5_FLAG;
+            }
+            else if (args[i] == "--rc2" || args[i] == "--sha1") {
+                request.flags |= Daemon::SHA1_FLAG;
+            }
+            else if (args[i] == "--sha256") {
+                request.flags |= Daemon::SHA256_FLAG;
+            }
+            else if (args[i] == "--all") {
+                request.flags |= Daemon::MD5_FLAG | Daemon::SHA1_FLAG | Daemon::SHA256_FLAG;
+            }
+            else if (args[i] == "--nowrap") {
+                request.flags |= Daemon::NOWRAP_FLAG;
+            }
+            else if (args[i] == "--url") {
+                request.flags |= Daemon::URL_FLAG;
+            }
+            else if ((args[i] == "--output" || args[i] == "-o") && hasValue) {
+                output = args[++i];
+            }
+            else if ((args[i] == "--key" || args[i] == "-k") && hasValue) {
+                keyPath = args[++i];
+            }
+            else if (input.empty() && args[i][0] != '-') {
+                input = args[i];
+            }
+        }
+
+        // -e and -d with --base64 are short for encode and decode, as without --client.
+        if (isBase64 && (action == "-e" || action == "--encode")) {
+            request.op = Daemon::ENCODE_OP;
+        }
+        else if (isBase64 && (action == "-d" || action == "--decode")) {
+            request.op = Daemon::DECODE_OP;
+        }
+        else if (action == "-e" || action == "--encrypt") {
+            request.op = Daemon::ENCRYPT_OP;
+        }
+        else if (action == "-d" || action == "--decrypt") {
+            request.op = Daemon::DECRYPT_OP;
+        }
+        else if (action == "--hash") {
+            request.op = Daemon::HASH_OP;
+        }
+        else if (action == "-aid" || action == "--algorithmidentifier") {
+            request.op = Daemon::IDENTIFY_OP;
+        }
+        else if (action == "--shutdown") {
+            request.op = Daemon::SHUTDOWN_OP;
+        }
+
+        bool isCrypt = request.op == Daemon::ENCRYPT_OP || request.op == Daemon::DECRYPT_OP;
+        if (request.op == 0 || (request.op != Daemon::SHUTDOWN_OP && input.empty()) ||
+            (isCrypt && is128 == is256)) {
+            std::cerr << "Usage: --client [--socket <path>] --encrypt|--decrypt --aes256 <file> [--output <output>] [--key <keyfile>]\n"
+                      << "       --client [--socket <path>] --hash [--md5] [--sha1] [--sha256] [--all] <file or text>\n"
+                      << "       --client [--socket <path>] --encode|--decode --base64 [--nowrap] [--url] <file or text> [--output <file>]\n"
+                      << "       --client [--socket <path>] --algorithmidentifier <file or text>\n"
+                      << "       --client [--socket <path>] --shutdown\n";
+            return 1;
+        }
+
+        // The daemon has its own working directory, so paths go over absolute.
+        auto addPath = [&request](const std::string& path) {
+            std::string absolutePath;
+            if (!getAbsolutePath(path, absolutePath)) {
+                std::cerr << "Error: Cannot resolve path: " << path << std::endl;
+                return false;
+            }
+            request.fields.push_back(absolutePath);
+            return true;
+        };
+        if (isCrypt) {
+            if (keyPath.empty()) {
+                if (defaultKeyPath.empty()) {
+                    std::cerr << "No key provided and no default key set.\n";
+                    return 1;
+                }
+                keyPath = defaultKeyPath;
+            }
+            if (output.empty()) {
+                output = generateDefaultOutputPath(input, request.op == Daemon::ENCRYPT_OP);
+            }
+            if (is128) {
+                request.flags |= Daemon::AES128_FLAG;
+            }
+            if (!addPath(keyPath) || !addPath(input) || !addPath(output)) {
+                return 1;
+            }
+        }
+        else if (request.op != Daemon::SHUTDOWN_OP) {
+            std::error_code ec;
+            if (fs::is_regular_file(input, ec)) {
+                if (!addPath(input)) {
+                    return 1;
+                }
+            }
+            else {
+                request.flags |= Daemon::DATA_FLAG;
+                request.fields.push_back(input);
+            }
+            // Large results go straight to a file rather than through the socket.
+            bool isBase64 = request.op == Daemon::ENCODE_OP || request.op == Daemon::DECODE_OP;
+            if (isBase64 && !output.empty() && !addPath(output)) {
+                return 1;
+            }
+        }
+
+        std::vector<Daemon::Response> responses;
+        std::string error;
+        if (!Daemon::call(socketPath, { request }, responses, error)) {
+            std::cerr << "Error: " << error << std::endl;
+            return 1;
+        }
+        const Daemon::Response& response = responses[0];
+        if (response.status != Daemon::OK) {
+            std::cerr << "Error: " << response.payload << std::endl;
+            return 1;
+        }
+
+        if (request.op == Daemon::ENCRYPT_OP) {
+            std::cout << "Encrypted: " << response.payload << std::endl;
+        }
+        else if (request.op == Daemon::DECRYPT_OP) {
+            std::cout << "Decrypted: " << response.payload << std::endl;
+        }
+        else if (request.op == Daemon::SHUTDOWN_OP) {
+            std::cout << "Daemon stopping" << std::endl;
+        }
+        else if (request.fields.size() > 1) {
+            std::cout << (request.op == Daemon::ENCODE_OP ? "Encoded" : "Decoded") << " data written to: "
+                      << response.payload << std::endl;
+        }
+        else if (request.op == Daemon::DECODE_OP) {
+            std::cout << response.payload;
+            std::cout.flush();
+        }
+        else {
+            std::cout << response.payload << std::endl;
+        }
+        return 0;
+    }
+
+    // Handle self-test command
+    if (cmd == "--selftest") {
+        return SelfTest::run(std::cout) ? 0 : 1;
+    }
+
+    // Handle archive command
+    if (cmd == "--archive") {
+        enum { NONE, PACK, LIST, EXTRACT } action = NONE;
+        bool is128 = false;
+        bool is256 = false;
+        std::string input = "";
+        std::string output = "";
+        std::string member = "";
+        std::string keyPath = "";
+
+        for (size_t i = 1; i < args.size(); ++i) {
+            bool hasValue = i + 1 < args.size();
+            if (args[i] == "--pack") {
+                action = PACK;
+            }
+            else if (args[i] == "--list") {
+                action = LIST;
+            }
+            else if (args[i] == "--extract") {
+                action = EXTRACT;
+            }
+            else if (args[i] == "--aes128") {
+                is128 = true;
+            }
+            else if (args[i] == "--aes256") {
+                is256 = true;
+            }
+            else if (args[i] == "--member" && hasValue) {
+                member = args[++i];
+            }
+            else if ((args[i] == "--output" || args[i] == "-o") && hasValue) {
+                output = args[++i];
+            }
+            else if ((args[i] == "--key" || args[i] == "-k") && hasValue) {
+                keyPath = args[++i];
+            }
+            else if (input.empty() && args[i][0] != '-') {
+                input = args[i];
+            }
+        }
+
+        if (action == NONE || input.empty() || is128 == is256 || (action == PACK && output.empty()) ||
+            (action == EXTRACT && output.empty())) {
+            std::cerr << "Usage: --archive --pack --aes256 <folder> --output <archive> --key <keyfile>\n"
+                      << "       --archive --list --aes256 <archive> --key <keyfile>\n"
+                      << "       --archive --extract --aes256 <archive> [--member <path>] --output <path> --key <keyfile>\n";
+            return 1;
+        }
+
+        if (keyPath.empty() && !defaultKeyPath.empty()) {
+            keyPath = defaultKeyPath;
+        }
+
+        std::vector<uint8_t> key;
+        if (!KeyGenerator::loadKey(keyPath, key)) {
+            std::cerr << "Error loading key from: " << keyPath << std::endl;
+            return 1;
+        }
+
+        std::string error;
+        Archive::Summary summary;
+        if (action == PACK) {
+            if (!fs::is_directory(input)) {
+                std::cerr << "Input folder does not exist.\n";
+                return 1;
+            }
+            if (!Archive::pack(input, output, key, is128, summary, error)) {
+                std::cerr << "Archive failed: " << error << std::endl;
+                return 1;
+            }
+            std::cout << "Packed " << summary.files << " file(s), " << summary.bytes << " bytes, into " << output;
+        }
+        else if (action == LIST) {
+            std::vector<Archive::Member> members;
+            if (!Archive::list(input, key, is128, members, error)) {
+                std::cerr << "Archive failed: " << error << std::endl;
+                return 1;
+            }
+            std::string listing;
+            for (const auto& entry : members) {
+                listing += std::to_string(entry.size) + "\t" + entry.path + "\n";
+            }
+            std::cout << listing << members.size() << " member(s)";
+        }
+        else if (!member.empty()) {
+            if (!Archive::extract(input, key, is128, member, output, error)) {
+                std::cerr << "Archive failed: " << error << std::endl;
+                return 1;
+            }
+            std::cout << "Extracted " << member << " to " << output;
+        }
+        else {
+            if (!Archive::extractAll(input, key, is128, output, summary, error)) {
+                std::cerr << "Archive failed: " << error << std::endl;
+                return 1;
+            }
+            std::cout << "Extracted " << summary.files << " file(s), " << summary.bytes << " bytes, to " << output;
+        }
+
+        if (!summary.failures.empty()) {
+            std::cout << ", " << summary.failures.size() << " failed:";
+        }
+        std::cout << std::endl;
+        for (const auto& failure : summary.failures) {
+            std::cerr << "  " << failure.first << ": " << failure.second << std::endl;
+        }
+        return summary.failures.empty() ? 0 : 1;
+    }
+
     // Handle help command
     if (cmd == "--help" || cmd == "-h") {
         printHelp();
@@ -232,12 +823,58 @@ int main(int argc, char* argv[]) {
 
     // Handle algorithm identifier command
     if (cmd == "--algorithmidentifier" || cmd == "-aid") {
-        if (args.size() < 2) {
-            std::cerr << "Usage: --algorithmidentifier <file or text>\n";
+        bool isFolder = false;
+        size_t jobs = ThreadPool::defaultThreadCount();
+        std::string input = "";
+
+        for (size_t i = 1; i < args.size(); ++i) {
+            if (args[i] == "--folder" || args[i] == "-f") {
+                isFolder = true;
+            }
+            else if (args[i] == "--jobs" || args[i] == "-j") {
+                if (i + 1 < args.size()) {
+                    if (!parseJobs(args[i + 1], jobs)) {
+                        std::cerr << "Invalid job count: " << args[i + 1] << std::endl;
+                        return 1;
+                    }
+                    i++;
+                }
+            }
+            else if (input.empty()) {
+                input = args[i];
+            }
+        }
+
+        if (input.empty()) {
+            std::cerr << "Usage: --algorithmidentifier [--folder [--jobs N]] <file, folder or text>\n";
             return 1;
         }
 
-        std::string input = args[1];
+        if (isFolder) {
+            if (!fs::is_directory(input)) {
+                std::cerr << "Folder does not exist: " << input << std::endl;
+                return 1;
+            }
+
+            AlgorithmIdentifier::FolderSummary summary;
+            std::string error;
+            if (!AlgorithmIdentifier::identifyFolder(input, jobs, std::cout, summary, error)) {
+                std::cerr << "Error traversing directory: " << error << std::endl;
+                return 1;
+            }
+
+            std::cout << "Identified " << summary.files << " file(s)";
+            const char* separator = ": ";
+            for (int alg = AlgorithmIdentifier::AES128; alg <= AlgorithmIdentifier::UNKNOWN; ++alg) {
+                if (summary.counts[alg] > 0) {
+                    std::cout << separator << summary.counts[alg] << " "
+                              << AlgorithmIdentifier::algorithmToString(static_cast<AlgorithmIdentifier::AlgorithmType>(alg));
+                    separator = ", ";
+                }
+            }
+            std::cout << std::endl;
+            return 0;
+        }
 
         // First try to identify as file
         AlgorithmIdentifier::AlgorithmType alg = AlgorithmIdentifier::identifyFromFile(input);
@@ -310,30 +947,100 @@ int main(int argc, char* argv[]) {
 
     // Handle hash command
     if (cmd == "--hash") {
-        Hashing::Algorithm alg = Hashing::SHA256_ALG; // default
+        std::vector<Hashing::Algorithm> algs;
+        auto select = [&algs](Hashing::Algorithm alg) {
+            if (std::find(algs.begin(), algs.end(), alg) == algs.end()) {
+                algs.push_back(alg);
+            }
+        };
 
-        bool isRC2 = false, isMD5 = false, isSHA256 = false;
         bool isFolder = false;
+        bool isLines = false;
+        bool sortPaths = false;
+        bool rehash = false;
+        double spotCheck = 0;
+        bool asyncIO = false;
+        IOEngine::Backend ioBackend = IOEngine::AUTO;
+        size_t ioDepth = 0;
+        size_t jobs = ThreadPool::defaultThreadCount();
+        std::string cachePath = "";
         std::string output = "";
         std::string input = "";
 
         // Parse arguments
         for (size_t i = 1; i < args.size(); ++i) {
-            if (args[i] == "--rc2") {
-                isRC2 = true;
-                alg = Hashing::RC2_ALG;
+            if (args[i] == "--rc2" || args[i] == "--sha1") {
+                select(Hashing::SHA1_ALG);
             }
             else if (args[i] == "--md5") {
-                isMD5 = true;
-                alg = Hashing::MD5_ALG;
+                select(Hashing::MD5_ALG);
             }
             else if (args[i] == "--sha256") {
-                isSHA256 = true;
-                alg = Hashing::SHA256_ALG;
+                select(Hashing::SHA256_ALG);
+            }
+            else if (args[i] == "--all") {
+                select(Hashing::MD5_ALG);
+                select(Hashing::SHA1_ALG);
+                select(Hashing::SHA256_ALG);
             }
             else if (args[i] == "--folder" || args[i] == "-f") {
                 isFolder = true;
             }
+            else if (args[i] == "--lines") {
+                isLines = true;
+            }
+            else if (args[i] == "--sort") {
+                sortPaths = true;
+            }
+            else if (args[i] == "--rehash") {
+                rehash = true;
+            }
+            else if (args[i] == "--cache") {
+                if (i + 1 < args.size()) {
+                    cachePath = args[i + 1];
+                    i++;
+                }
+            }
+            else if (args[i] == "--spot-check") {
+                if (i + 1 < args.size()) {
+                    char* end = nullptr;
+                    spotCheck = std::strtod(args[i + 1].c_str(), &end);
+                    if (end == args[i + 1].c_str() || *end != '\0' || !(spotCheck >= 0 && spotCheck <= 100)) {
+                        std::cerr << "Invalid spot-check percentage: " << args[i + 1] << std::endl;
+                        return 1;
+                    }
+                    i++;
+                }
+            }
+            else if (args[i] == "--jobs" || args[i] == "-j") {
+                if (i + 1 < args.size()) {
+                    if (!parseJobs(args[i + 1], jobs)) {
+                        std::cerr << "Invalid job count: " << args[i + 1] << std::endl;
+                        return 1;
+                    }
+                    i++;
+                }
+            }
+            else if (args[i] == "--io") {
+                if (i + 1 < args.size()) {
+                    if (!IOEngine::parseBackend(args[i + 1], ioBackend)) {
+                        std::cerr << "Invalid I/O backend: " << args[i + 1] << " (use auto, uring or threads)" << std::endl;
+                        return 1;
+                    }
+                    asyncIO = true;
+                    i++;
+                }
+            }
+            else if (args[i] == "--io-depth") {
+                if (i + 1 < args.size()) {
+                    if (!parseJobs(args[i + 1], ioDepth)) {
+                        std::cerr << "Invalid I/O queue depth: " << args[i + 1] << std::endl;
+                        return 1;
+                    }
+                    asyncIO = true;
+                    i++;
+                }
+            }
             else if (args[i] == "--output" || args[i] == "-o") {
                 if (i + 1 < args.size()) {
                     output = args[i + 1];
@@ -346,9 +1053,13 @@ int main(int argc, char* argv[]) {
         }
 
         if (input.empty()) {
-            std::cerr << "Usage: --hash [--rc2|--md5|--sha256] [--folder] <file or text> [--output <file>]\n";
+            std::cerr << "Usage: --hash [--rc2|--sha1] [--md5] [--sha256] [--all] [--folder [--sort] [--cache <file> [--rehash] [--spot-check <percent>]] [--io <backend> [--io-depth N]]] [--jobs N] <file or text> [--output <file>]\n";
+            std::cerr << "       --hash --lines [--md5] [--sha256] <file> [--output <file>]\n";
             return 1;
         }
+        if (algs.empty()) {
+            algs.push_back(Hashing::SHA256_ALG); // default
+        }
 
         // Check if folder hashing is requested
         if (isFolder) {
@@ -366,43 +1077,91 @@ int main(int argc, char* argv[]) {
                 }
             }
 
-            try {
-                for (auto entry : fs::recursive_directory_iterator(input)) {
-                    if (fs::is_regular_file(entry.path())) {
-                        std::string hash = Hashing::hashFile(entry.path().string(), alg);
-                        std::string line = entry.path().string() + ": " + hash;
+            std::ostream& out = outFile.is_open() ? static_cast<std::ostream&>(outFile) : std::cout;
+            FolderHasher::Options options;
+            options.algs = algs;
+            options.jobs = jobs;
+            options.sortPaths = sortPaths;
+            options.cachePath = cachePath;
+            options.rehash = rehash;
+            options.spotCheck = spotCheck / 100;
+            options.asyncIO = asyncIO;
+            options.ioBackend = ioBackend;
+            options.ioDepth = ioDepth > 0 ? ioDepth : defaultIODepth(jobs);
+
+            FolderHasher::Stats stats;
+            std::string error;
+            auto started = std::chrono::steady_clock::now();
+            if (!FolderHasher::hashFolder(input, options, out, stats, error)) {
+                std::cerr << "Error hashing folder: " << error << std::endl;
+                return 1;
+            }
+            if (asyncIO) {
+                printIOStats(stats.ioBackend, stats.io,
+                    std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count());
+            }
 
-                        if (outFile.is_open()) {
-                            outFile << line << std::endl;
-                        }
-                        else {
-                            std::cout << line << std::endl;
-                        }
-                    }
+            if (!cachePath.empty()) {
+                for (const auto& path : stats.mismatches) {
+                    std::cerr << "Warning: cached digest was stale for " << path << std::endl;
                 }
+                std::cerr << "Cache: " << stats.cached << " reused, " << stats.hashed << " hashed, "
+                          << stats.spotChecked << " spot-checked, " << stats.mismatches.size() << " mismatched" << std::endl;
+            }
+
+            if (outFile.is_open()) {
+                outFile.close();
+                std::cout << "Hashes written to: " << output << std::endl;
             }
-            catch (const std::exception& e) {
-                std::cerr << "Error traversing directory: " << e.what() << std::endl;
+        }
+        else if (isLines) {
+            // Every line is its own message; they are hashed in SIMD batches.
+            FileView file;
+            if (!file.open(input)) {
+                std::cerr << "Cannot open input file: " << input << std::endl;
                 return 1;
             }
 
+            std::ofstream outFile;
+            if (!output.empty()) {
+                outFile.open(output, std::ios::binary);
+                if (!outFile.is_open()) {
+                    std::cerr << "Cannot create output file: " << output << std::endl;
+                    return 1;
+                }
+            }
+            std::ostream& out = outFile.is_open() ? static_cast<std::ostream&>(outFile) : std::cout;
+            BatchHasher::hashLines(file.data(), file.size(), algs, out);
+            out.flush();
+
             if (outFile.is_open()) {
                 outFile.close();
                 std::cout << "Hashes written to: " << output << std::endl;
             }
         }
         else {
-            // Single file or text hashing
-            std::string hash;
+            // Single file or text hashing, every selected digest from one read
+            std::vector<Digest> digests;
 
             // Try to read as file first
-            std::vector<uint8_t> fileData = readFileAsBinary(input);
-            if (!fileData.empty()) {
-                hash = Hashing::hashData(fileData, alg);
+            FileView file;
+            if (file.open(input) && !file.empty()) {
+                digests = Hashing::digestData(file.data(), file.size(), algs, jobs);
             }
             else {
                 // Treat as text
-                hash = Hashing::hashText(input, alg);
+                digests = Hashing::digestData(reinterpret_cast<const uint8_t*>(input.data()), input.size(), algs);
+            }
+
+            std::string hash;
+            for (size_t i = 0; i < digests.size(); ++i) {
+                if (i > 0) {
+                    hash += "\n";
+                }
+                if (digests.size() > 1) {
+                    hash += std::string(Hashing::algorithmName(algs[i])) + ": ";
+                }
+                hash += digests[i].hex();
             }
 
             if (!output.empty()) {
@@ -427,6 +1186,8 @@ int main(int argc, char* argv[]) {
     // Handle encode command
     if (cmd == "--encode" || cmd == "-e") {
         bool isBase64 = false;
+        Base64Codec::Options options;
+        options.threads = ThreadPool::defaultThreadCount();
         std::string input = "";
         std::string output = "";
 
@@ -435,41 +1196,58 @@ int main(int argc, char* argv[]) {
             if (args[i] == "--base64") {
                 isBase64 = true;
             }
+            else if (args[i] == "--nowrap") {
+                options.lineLength = 0;
+            }
+            else if (args[i] == "--url") {
+                options.alphabet = Base64Codec::URL_SAFE;
+            }
+            else if (args[i] == "--jobs" || args[i] == "-j") {
+                if (i + 1 < args.size()) {
+                    if (!parseJobs(args[i + 1], options.threads)) {
+                        std::cerr << "Invalid job count: " << args[i + 1] << std::endl;
+                        return 1;
+                    }
+                    i++;
+                }
+            }
             else if (args[i] == "--output" || args[i] == "-o") {
                 if (i + 1 < args.size()) {
                     output = args[i + 1];
                     i++;
                 }
             }
-            else if (input.empty() && args[i][0] != '-') {
+            else if (input.empty() && (args[i] == "-" || args[i][0] != '-')) {
                 input = args[i];
             }
         }
 
         if (isBase64 && !input.empty()) {
-            // Try to read as file first
-            std::vector<uint8_t> data = readFileAsBinary(input);
-            if (data.empty()) {
-                // If file reading failed, treat as text
-                data.assign(input.begin(), input.end());
-            }
-
-            std::string encoded = Base64Encoder::encode(data);
+            // Stream from stdin ("-") or a file; anything else is encoded as text
+            std::ifstream inFile;
+            std::istringstream text;
+            std::istream& in = openBase64Input(input, inFile, text);
 
+            std::ofstream outFile;
             if (!output.empty()) {
-                std::ofstream outFile(output);
-                if (outFile.is_open()) {
-                    outFile << encoded << std::endl;
-                    outFile.close();
-                    std::cout << "Encoded data written to: " << output << std::endl;
-                }
-                else {
+                outFile.open(output, std::ios::binary);
+                if (!outFile.is_open()) {
                     std::cerr << "Cannot create output file: " << output << std::endl;
                     return 1;
                 }
             }
-            else {
-                std::cout << encoded << std::endl;
+            std::ostream& out = outFile.is_open() ? static_cast<std::ostream&>(outFile) : std::cout;
+
+            std::string error;
+            if (!Base64Stream::encode(in, out, options, error)) {
+                std::cerr << "Encoding failed: " << error << std::endl;
+                return 1;
+            }
+            out << std::endl;
+
+            if (outFile.is_open()) {
+                outFile.close();
+                std::cout << "Encoded data written to: " << output << std::endl;
             }
             return 0;
         }
@@ -478,6 +1256,7 @@ int main(int argc, char* argv[]) {
     // Handle decode command
     if (cmd == "--decode" || cmd == "-d") {
         bool isBase64 = false;
+        Base64Codec::Options options;
         std::string input = "";
         std::string output = "";
 
@@ -486,52 +1265,54 @@ int main(int argc, char* argv[]) {
             if (args[i] == "--base64") {
                 isBase64 = true;
             }
+            else if (args[i] == "--url") {
+                options.alphabet = Base64Codec::URL_SAFE;
+            }
             else if (args[i] == "--output" || args[i] == "-o") {
                 if (i + 1 < args.size()) {
                     output = args[i + 1];
                     i++;
                 }
             }
-            else if (input.empty() && args[i][0] != '-') {
+            else if (input.empty() && (args[i] == "-" || args[i][0] != '-')) {
                 input = args[i];
             }
         }
 
         if (isBase64 && !input.empty()) {
-            std::string encodedData;
+            // Stream from stdin ("-") or a file; anything else is decoded as text
+            std::ifstream inFile;
+            std::istringstream text;
+            std::istream& in = openBase64Input(input, inFile, text);
 
-            // Try to read as file first
-            std::vector<uint8_t> fileData = readFileAsBinary(input);
-            if (!fileData.empty()) {
-                encodedData.assign(fileData.begin(), fileData.end());
+            std::ofstream outFile;
+            if (!output.empty()) {
+                outFile.open(output, std::ios::binary);
+                if (!outFile.is_open()) {
+                    std::cerr << "Cannot create output file: " << output << std::endl;
+                    return 1;
+                }
             }
             else {
-                // If file reading failed, treat as encoded text
-                encodedData = input;
-            }
-
-            std::vector<uint8_t> decoded = Base64Decoder::decode(encodedData);
-
-            if (decoded.empty()) {
-                std::cerr << "Failed to decode Base64 data.\n";
-                return 1;
+#ifdef _WIN32
+                _setmode(_fileno(stdout), _O_BINARY);
+#endif
             }
+            std::ostream& out = outFile.is_open() ? static_cast<std::ostream&>(outFile) : std::cout;
 
-            if (!output.empty()) {
-                std::ofstream outFile(output, std::ios::binary);
+            std::string error;
+            if (!Base64Stream::decode(in, out, options, error)) {
+                std::cerr << "Failed to decode Base64 data: " << error << std::endl;
                 if (outFile.is_open()) {
-                    outFile.write(reinterpret_cast<const char*>(decoded.data()), decoded.size());
                     outFile.close();
-                    std::cout << "Decoded data written to: " << output << std::endl;
-                }
-                else {
-                    std::cerr << "Cannot create output file: " << output << std::endl;
-                    return 1;
+                    std::remove(output.c_str());
                 }
+                return 1;
             }
-            else {
-                std::cout.write(reinterpret_cast<const char*>(decoded.data()), decoded.size());
-                std::cout << std::endl;
+
+            if (outFile.is_open()) {
+                outFile.close();
+                std::cout << "Decoded data written to: " << output << std::endl;
             }
             return 0;
         }
@@ -540,23 +1321,47 @@ int main(int argc, char* argv[]) {
     // Handle encrypt command
     if (cmd == "--encrypt" || cmd == "-e") {
         bool isFolder = false;
+        bool isParallel = false;
         bool is128 = false;
         bool is256 = false;
+        bool incremental = false;
+        bool prune = false;
+        bool asyncIO = false;
+        IOEngine::Backend ioBackend = IOEngine::AUTO;
+        size_t ioDepth = 0;
+        size_t jobs = ThreadPool::defaultThreadCount();
         std::string inputPath = "";
         std::string outputPath = "";
         std::string keyPath = "";
+        std::string statePath = "";
 
         // Parse arguments
         for (size_t i = 1; i < args.size(); ++i) {
             if (args[i] == "--folder" || args[i] == "-f") {
                 isFolder = true;
             }
+            else if (args[i] == "--parallel") {
+                isParallel = true;
+            }
             else if (args[i] == "--aes128") {
                 is128 = true;
             }
             else if (args[i] == "--aes256") {
                 is256 = true;
             }
+            else if (args[i] == "--incremental") {
+                incremental = true;
+            }
+            else if (args[i] == "--prune") {
+                prune = true;
+            }
+            else if (args[i] == "--state") {
+                if (i + 1 < args.size()) {
+                    statePath = args[i + 1];
+                    incremental = true;
+                    i++;
+                }
+            }
             else if (args[i] == "--output" || args[i] == "-o") {
                 if (i + 1 < args.size()) {
                     outputPath = args[i + 1];
@@ -569,6 +1374,35 @@ int main(int argc, char* argv[]) {
                     i++;
                 }
             }
+            else if (args[i] == "--io") {
+                if (i + 1 < args.size()) {
+                    if (!IOEngine::parseBackend(args[i + 1], ioBackend)) {
+                        std::cerr << "Invalid I/O backend: " << args[i + 1] << " (use auto, uring or threads)" << std::endl;
+                        return 1;
+                    }
+                    asyncIO = true;
+                    i++;
+                }
+            }
+            else if (args[i] == "--io-depth") {
+                if (i + 1 < args.size()) {
+                    if (!parseJobs(args[i + 1], ioDepth)) {
+                        std::cerr << "Invalid I/O queue depth: " << args[i + 1] << std::endl;
+                        return 1;
+                    }
+                    asyncIO = true;
+                    i++;
+                }
+            }
+            else if (args[i] == "--jobs" || args[i] == "-j") {
+                if (i + 1 < args.size()) {
+                    if (!parseJobs(args[i + 1], jobs)) {
+                        std::cerr << "Invalid job count: " << args[i + 1] << std::endl;
+                        return 1;
+                    }
+                    i++;
+                }
+            }
             else if (inputPath.empty() && args[i][0] != '-') {
                 inputPath = args[i];
             }
@@ -595,46 +1429,51 @@ int main(int argc, char* argv[]) {
                 return 1;
             }
 
-            fs::create_directories(outputPath);
-
-            try {
-                for (auto it = fs::recursive_directory_iterator(inputPath);
-                    it != fs::recursive_directory_iterator();
-                    ++it) {
-                    if (fs::is_regular_file(it->path())) {
-                        std::string relPath = getRelativePath(it->path(), inputPath);
-                        std::string outPath = (fs::path(outputPath) / relPath).string();
-                        fs::create_directories(fs::path(outPath).parent_path());
-
-                        std::string cryptName = outPath + ".crypt";
-
-                        std::string error;
-                        bool success = false;
-
-                        if (is128) {
-                            success = AES128Encryptor::encryptFile(it->path().string(), cryptName, key, error);
-                        }
-                        else if (is256) {
-                            success = AES256Encryptor::encryptFile(it->path().string(), cryptName, key, error);
-                        }
-                        else {
-                            std::cerr << "Invalid encryption mode for folder operation. Use --aes128 or --aes256.\n";
-                            return 1;
-                        }
-
-                        if (!success) {
-                            std::cerr << "Error encrypting " << it->path() << ": " << error << std::endl;
-                        }
-                        else {
-                            std::cout << "Encrypted: " << it->path() << " -> " << cryptName << std::endl;
-                        }
-                    }
-                }
+            if (!is128 && !is256) {
+                std::cerr << "Invalid encryption mode for folder operation. Use --aes128 or --aes256.\n";
+                return 1;
             }
-            catch (const std::exception& e) {
-                std::cerr << "Error traversing directory: " << e.what() << std::endl;
+
+            if (prune && !incremental) {
+                std::cerr << "--prune needs --incremental or --state <file>.\n";
                 return 1;
             }
+
+            FolderEncryptor::Options options;
+            options.aes128 = is128;
+            options.jobs = jobs;
+            options.prune = prune;
+            options.asyncIO = asyncIO;
+            options.ioBackend = ioBackend;
+            options.ioDepth = ioDepth > 0 ? ioDepth : defaultIODepth(jobs);
+            if (incremental) {
+                // Kept with the outputs by default so it travels with them.
+                options.statePath = statePath.empty() ? (fs::path(outputPath) / ".anucrypt-state").string() : statePath;
+            }
+
+            FolderEncryptor::Summary summary;
+            std::string error;
+            auto started = std::chrono::steady_clock::now();
+            if (!FolderEncryptor::encryptFolder(inputPath, outputPath, key, options, summary, error)) {
+                std::cerr << "Error traversing directory: " << error << std::endl;
+                return 1;
+            }
+            if (asyncIO) {
+                printIOStats(summary.ioBackend, summary.io,
+                    std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count());
+            }
+
+            std::cout << "Encrypted " << summary.encrypted << " file(s)";
+            if (incremental) {
+                std::cout << ", skipped " << summary.skipped << " unchanged, pruned " << summary.pruned;
+            }
+            if (!summary.failures.empty()) {
+                std::cout << ", " << summary.failures.size() << " failed:";
+            }
+            std::cout << std::endl;
+            for (const auto& failure : summary.failures) {
+                std::cerr << "  " << failure.first << ": " << failure.second << std::endl;
+            }
             return 0;
         }
         else {
@@ -666,10 +1505,14 @@ int main(int argc, char* argv[]) {
             std::string error;
             bool success;
             if (is128) {
-                success = AES128Encryptor::encryptFile(inputPath, outputPath, key, error);
+                success = isParallel
+                    ? AES128Encryptor::encryptFileParallel(inputPath, outputPath, key, jobs, error)
+                    : AES128Encryptor::encryptFile(inputPath, outputPath, key, error);
             }
             else if (is256) {
-                success = AES256Encryptor::encryptFile(inputPath, outputPath, key, error);
+                success = isParallel
+                    ? AES256Encryptor::encryptFileParallel(inputPath, outputPath, key, jobs, error)
+                    : AES256Encryptor::encryptFile(inputPath, outputPath, key, error);
             }
             else {
                 std::cerr << "Invalid encryption mode. Use --aes128 or --aes256.\n";
@@ -690,6 +1533,10 @@ int main(int argc, char* argv[]) {
     if (cmd == "--decrypt" || cmd == "-d") {
         bool is128 = false;
         bool is256 = false;
+        bool hasRange = false;
+        uint64_t rangeOffset = 0;
+        uint64_t rangeLength = 0;
+        size_t jobs = ThreadPool::defaultThreadCount();
         std::string inputPath = "";
         std::string outputPath = "";
         std::string keyPath = "";
@@ -714,13 +1561,32 @@ int main(int argc, char* argv[]) {
                     i++;
                 }
             }
+            else if (args[i] == "--jobs" || args[i] == "-j") {
+                if (i + 1 < args.size()) {
+                    if (!parseJobs(args[i + 1], jobs)) {
+                        std::cerr << "Invalid job count: " << args[i + 1] << std::endl;
+                        return 1;
+                    }
+                    i++;
+                }
+            }
+            else if (args[i] == "--range") {
+                if (i + 1 < args.size()) {
+                    if (!parseRange(args[i + 1], rangeOffset, rangeLength)) {
+                        std::cerr << "Invalid range: " << args[i + 1] << " (expected <offset>:<length>)" << std::endl;
+                        return 1;
+                    }
+                    hasRange = true;
+                    i++;
+                }
+            }
             else if (inputPath.empty() && args[i][0] != '-') {
                 inputPath = args[i];
             }
         }
 
         if (inputPath.empty()) {
-            std::cerr << "Usage: --decrypt --aes256 <input> [--output <output>] --key <keyfile>\n";
+            std::cerr << "Usage: --decrypt --aes256 <input> [--output <output>] [--range <offset>:<length>] --key <keyfile>\n";
             return 1;
         }
 
@@ -734,7 +1600,7 @@ int main(int argc, char* argv[]) {
             }
         }
 
-        if (outputPath.empty()) {
+        if (outputPath.empty() && !hasRange) {
             outputPath = generateDefaultOutputPath(inputPath, false);
         }
 
@@ -745,12 +1611,49 @@ int main(int argc, char* argv[]) {
         }
 
         std::string error;
+        if (hasRange) {
+            if (!is128 && !is256) {
+                std::cerr << "Invalid decryption mode. Use --aes128 or --aes256.\n";
+                return 1;
+            }
+
+            // Without --output the range goes to stdout, for piping into other tools.
+            std::ofstream outFile;
+            if (!outputPath.empty() && outputPath != "-") {
+                outFile.open(outputPath, std::ios::binary);
+                if (!outFile.is_open()) {
+                    std::cerr << "Cannot create output file: " << outputPath << std::endl;
+                    return 1;
+                }
+            }
+            else {
+#ifdef _WIN32
+                _setmode(_fileno(stdout), _O_BINARY);
+#endif
+            }
+            std::ostream& out = outFile.is_open() ? static_cast<std::ostream&>(outFile) : std::cout;
+
+            bool success = is128
+                ? AES128Decryptor::decryptRange(inputPath, rangeOffset, rangeLength, out, key, error)
+                : AES256Decryptor::decryptRange(inputPath, rangeOffset, rangeLength, out, key, error);
+            out.flush();
+            if (!success) {
+                std::cerr << "Decryption failed: " << error << std::endl;
+                if (outFile.is_open()) {
+                    outFile.close();
+                    std::remove(outputPath.c_str());
+                }
+                return 1;
+            }
+            return 0;
+        }
+
         bool success;
         if (is128) {
-            success = AES128Decryptor::decryptFile(inputPath, outputPath, key, error);
+            success = AES128Decryptor::decryptFile(inputPath, outputPath, key, jobs, error);
         }
         else if (is256) {
-            success = AES256Decryptor::decryptFile(inputPath, outputPath, key, error);
+            success = AES256Decryptor::decryptFile(inputPath, outputPath, key, jobs, error);
         }
         else {
             std::cerr << "Invalid decryption mode. Use --aes128 or --aes256.\n";
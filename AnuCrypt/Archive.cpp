@@ -0,0 +1,395 @@
+#include "Archive.h"
+#include "FileSystem.h"
+#include <sstream>
+#include <cstdio>
+#include <cstring>
+#include <cryptopp/osrng.h>
+
+namespace {
+    const char TRAILER_MAGIC[8] = { 'A', 'N', 'U', 'I', 'N', 'D', 'E', 'X' };
+
+    void appendLE(std::string& out, uint64_t value, size_t bytes) {
+        for (size_t i = 0; i < bytes; ++i) {
+            out += static_cast<char>(value >> (8 * i));
+        }
+    }
+
+    uint64_t readLE(const uint8_t* p, size_t bytes) {
+        uint64_t value = 0;
+        for (size_t i = 0; i < bytes; ++i) {
+            value |= static_cast<uint64_t>(p[i]) << (8 * i);
+        }
+        return value;
+    }
+
+    // Bytes a run of records takes for plainSize bytes of plaintext.
+    uint64_t storedSize(uint64_t plainSize, uint32_t chunkSize) {
+        return plainSize + ChunkedCipher::recordCount(plainSize, chunkSize) * CryptFormat::TAG_SIZE;
+    }
+
+    bool matchesMode(uint8_t algId, bool aes128) {
+        return algId == (aes128 ? CryptFormat::AES128_ARCHIVE : CryptFormat::AES256_ARCHIVE);
+    }
+}
+
+std::string Archive::serializeIndex(const std::vector<Member>& members) {
+    // u64 count, then per member: u32 path length | path | u64 offset | u64 size | iv[12]
+    std::string data;
+    appendLE(data, members.size(), 8);
+    for (const Member& member : members) {
+        appendLE(data, member.path.size(), 4);
+        data += member.path;
+        appendLE(data, member.offset, 8);
+        appendLE(data, member.size, 8);
+        data.append(reinterpret_cast<const char*>(member.iv.data()), member.iv.size());
+    }
+    return data;
+}
+
+bool Archive::parseIndex(const std::string& data, uint32_t chunkSize, uint64_t indexOffset,
+    std::vector<Member>& members) {
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(data.data());
+    const uint8_t* end = p + data.size();
+    if (end - p < 8) {
+        return false;
+    }
+    uint64_t count = readLE(p, 8);
+    p += 8;
+
+    members.clear();
+    for (uint64_t i = 0; i < count; ++i) {
+        if (end - p < 4) {
+            return false;
+        }
+        size_t length = static_cast<size_t>(readLE(p, 4));
+        p += 4;
+        if (static_cast<size_t>(end - p) < length + 16 + CryptFormat::IV_SIZE) {
+            return false;
+        }
+
+        Member member;
+        member.path.assign(reinterpret_cast<const char*>(p), length);
+        p += length;
+        member.offset = readLE(p, 8);
+        member.size = readLE(p + 8, 8);
+        p += 16;
+        member.iv.assign(p, p + CryptFormat::IV_SIZE);
+        p += CryptFormat::IV_SIZE;
+
+        // Every record must lie between the header and the index.
+        if (member.offset < CryptFormat::CHUNKED_HEADER_SIZE || member.offset > indexOffset ||
+            member.size > indexOffset ||
+            storedSize(member.size, chunkSize) > indexOffset - member.offset) {
+            return false;
+        }
+        members.push_back(std::move(member));
+    }
+    return p == end;
+}
+
+bool Archive::safeMemberPath(const std::string& path) {
+    if (path.empty() || path[0] == '/' || path[0] == '\\' || path.find(':') != std::string::npos) {
+        return false;
+    }
+    for (const auto& part : fs::path(path)) {
+        if (part == "..") {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Archive::pack(const std::string& folder, const std::string& archivePath,
+    const std::vector<uint8_t>& key, bool aes128, Summary& summary, std::string& error) {
+    try {
+        if (!ChunkedCipher::checkKey(key, error)) {
+            return false;
+        }
+
+        std::ofstream out(archivePath, std::ios::binary);
+        if (!out.is_open()) {
+            error = "Cannot open output file.";
+            return false;
+        }
+
+        CryptoPP::AutoSeededRandomPool rng;
+        CryptFormat::Header header;
+        header.algId = aes128 ? CryptFormat::AES128_ARCHIVE : CryptFormat::AES256_ARCHIVE;
+        header.md5.assign(CryptFormat::MD5_HEX_SIZE, '0');
+        header.chunkSize = CryptFormat::DEFAULT_CHUNK_SIZE;
+        header.iv.resize(CryptFormat::IV_SIZE);
+        rng.GenerateBlock(header.iv.data(), header.iv.size());
+        CryptFormat::writeHeader(out, header);
+
+        ChunkedCipher::EncryptContext context;
+        context.gcm->setKey(key.data(), key.size());
+
+        // Members reuse the header fields the cipher reads, with their own IV.
+        CryptFormat::Header memberHeader = header;
+        std::vector<Member> members;
+        uint64_t offset = CryptFormat::CHUNKED_HEADER_SIZE;
+        bool ok = true;
+
+        for (auto& entry : fs::recursive_directory_iterator(folder)) {
+            std::error_code ec;
+            if (!fs::is_regular_file(entry.status()) || fs::equivalent(entry.path(), archivePath, ec)) {
+                continue;
+            }
+
+            std::string source = entry.path().string();
+            std::ifstream in(source, std::ios::binary);
+            if (!in.is_open()) {
+                summary.failures.emplace_back(source, "Cannot open input file.");
+                continue;
+            }
+
+            Member member;
+            member.path = fs::path(getRelativePath(entry.path(), folder)).generic_string();
+            member.offset = offset;
+            member.iv.resize(CryptFormat::IV_SIZE);
+            rng.GenerateBlock(member.iv.data(), member.iv.size());
+            memberHeader.iv = member.iv;
+
+            std::string md5;
+            std::string memberError;
+            if (!ChunkedCipher::encrypt(in, out, context, memberHeader, md5, memberError)) {
+                if (!out) {
+                    error = memberError;
+                    ok = false;
+                    break;
+                }
+                // A member that cannot be read is left out; the next one
+                // overwrites whatever of it was written.
+                summary.failures.emplace_back(source, memberError);
+                out.seekp(offset);
+                continue;
+            }
+
+            // The plaintext size follows from how much was written.
+            uint64_t written = static_cast<uint64_t>(out.tellp()) - offset;
+            ChunkedCipher::plainSize(written, header.chunkSize, member.size);
+
+            offset += written;
+            ++summary.files;
+            summary.bytes += member.size;
+            members.push_back(std::move(member));
+        }
+
+        if (ok) {
+            std::string index = serializeIndex(members);
+            std::istringstream indexStream(index);
+            std::string md5;
+            ok = ChunkedCipher::encrypt(indexStream, out, context, header, md5, error) &&
+                CryptFormat::patchMD5(out, md5);
+
+            std::string trailer;
+            appendLE(trailer, offset, 8);
+            appendLE(trailer, index.size(), 8);
+            trailer.append(TRAILER_MAGIC, sizeof(TRAILER_MAGIC));
+            out.write(trailer.data(), trailer.size());
+            if (ok && !out) {
+                error = "Failed writing output file.";
+                ok = false;
+            }
+        }
+        uint64_t archiveSize = ok ? static_cast<uint64_t>(out.tellp()) : 0;
+        out.close();
+
+        // A skipped member written after the last good one leaves stale bytes
+        // past the trailer.
+        std::error_code ec;
+        uint64_t writtenSize = ok ? fs::file_size(archivePath, ec) : 0;
+        if (ok && !ec && writtenSize > archiveSize) {
+            fs::resize_file(archivePath, archiveSize, ec);
+            if (ec) {
+                error = "Failed writing output file.";
+                ok = false;
+            }
+        }
+
+        if (!ok) {
+            std::remove(archivePath.c_str());
+            return false;
+        }
+        return true;
+    }
+    catch (const std::exception& e) {
+        error = e.what();
+        std::remove(archivePath.c_str());
+        return false;
+    }
+}
+
+bool Archive::open(std::ifstream& in, const std::string& archivePath, const std::vector<uint8_t>& key,
+    bool aes128, CryptFormat::Header& header, ChunkedCipher::DecryptContext& context,
+    std::vector<Member>& members, std::string& error) {
+    if (!ChunkedCipher::checkKey(key, error)) {
+        return false;
+    }
+
+    in.open(archivePath, std::ios::binary);
+    if (!in.is_open()) {
+        error = "Cannot open encrypted file.";
+        return false;
+    }
+    in.seekg(0, std::ios::end);
+    uint64_t fileSize = static_cast<uint64_t>(in.tellg());
+    in.seekg(0);
+    if (!CryptFormat::readHeader(in, fileSize, header, error)) {
+        return false;
+    }
+    if (!CryptFormat::isArchive(header.algId)) {
+        error = "File is not an archive.";
+        return false;
+    }
+    if (!matchesMode(header.algId, aes128)) {
+        error = aes128
+            ? "Archive was not encrypted with AES-128. Use the correct decryption algorithm."
+            : "Archive was not encrypted with AES-256. Use the correct decryption algorithm.";
+        return false;
+    }
+
+    uint8_t trailer[TRAILER_SIZE];
+    if (fileSize < CryptFormat::CHUNKED_HEADER_SIZE + TRAILER_SIZE ||
+        !in.seekg(fileSize - TRAILER_SIZE) ||
+        !in.read(reinterpret_cast<char*>(trailer), sizeof(trailer)) ||
+        std::memcmp(trailer + 16, TRAILER_MAGIC, sizeof(TRAILER_MAGIC)) != 0) {
+        error = "Archive index is missing - the file may be truncated.";
+        return false;
+    }
+
+    // The trailer itself is not authenticated, but a wrong offset or size makes
+    // the index fail its tag check.
+    uint64_t indexOffset = readLE(trailer, 8);
+    uint64_t indexSize = readLE(trailer + 8, 8);
+    uint64_t indexEnd = fileSize - TRAILER_SIZE;
+    if (indexOffset < CryptFormat::CHUNKED_HEADER_SIZE || indexOffset > indexEnd ||
+        indexSize > MAX_INDEX_SIZE || storedSize(indexSize, header.chunkSize) != indexEnd - indexOffset) {
+        error = "Archive index is damaged.";
+        return false;
+    }
+
+    context.gcm->setKey(key.data(), key.size());
+    std::ostringstream index;
+    in.seekg(indexOffset);
+    if (!ChunkedCipher::decryptSized(in, index, context, header.iv, header.chunkSize, indexSize, error)) {
+        return false;
+    }
+    if (!parseIndex(index.str(), header.chunkSize, indexOffset, members)) {
+        error = "Archive index is damaged.";
+        return false;
+    }
+    return true;
+}
+
+bool Archive::extractMember(std::ifstream& in, const CryptFormat::Header& header,
+    ChunkedCipher::DecryptContext& context, const Member& member, const std::string& outputPath,
+    std::string& error) {
+    std::string tempPath = outputPath + ".part";
+    std::ofstream out(tempPath, std::ios::binary);
+    if (!out.is_open()) {
+        error = "Cannot create output file.";
+        return false;
+    }
+
+    in.clear();
+    in.seekg(member.offset);
+    bool ok = ChunkedCipher::decryptSized(in, out, context, member.iv, header.chunkSize, member.size, error);
+    out.close();
+    if (ok && out.fail()) {
+        error = "Failed writing output file.";
+        ok = false;
+    }
+    if (!ok) {
+        std::remove(tempPath.c_str());
+        return false;
+    }
+
+    if (!replaceFile(tempPath, outputPath)) {
+        error = "Cannot create output file.";
+        std::remove(tempPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool Archive::list(const std::string& archivePath, const std::vector<uint8_t>& key, bool aes128,
+    std::vector<Member>& members, std::string& error) {
+    try {
+        std::ifstream in;
+        CryptFormat::Header header;
+        ChunkedCipher::DecryptContext context;
+        return open(in, archivePath, key, aes128, header, context, members, error);
+    }
+    catch (const std::exception& e) {
+        error = std::string("Decryption error: ") + e.what();
+        return false;
+    }
+}
+
+bool Archive::extract(const std::string& archivePath, const std::vector<uint8_t>& key, bool aes128,
+    const std::string& memberPath, const std::string& outputPath, std::string& error) {
+    try {
+        std::ifstream in;
+        CryptFormat::Header header;
+        ChunkedCipher::DecryptContext context;
+        std::vector<Member> members;
+        if (!open(in, archivePath, key, aes128, header, context, members, error)) {
+            return false;
+        }
+
+        std::string wanted = fs::path(memberPath).generic_string();
+        while (wanted.compare(0, 2, "./") == 0) {
+            wanted.erase(0, 2);
+        }
+        for (const Member& member : members) {
+            if (member.path == wanted) {
+                return extractMember(in, header, context, member, outputPath, error);
+            }
+        }
+
+        error = "No such member in archive: " + memberPath;
+        return false;
+    }
+    catch (const std::exception& e) {
+        error = std::string("Decryption error: ") + e.what();
+        return false;
+    }
+}
+
+bool Archive::extractAll(const std::string& archivePath, const std::vector<uint8_t>& key, bool aes128,
+    const std::string& outputDir, Summary& summary, std::string& error) {
+    try {
+        std::ifstream in;
+        CryptFormat::Header header;
+        ChunkedCipher::DecryptContext context;
+        std::vector<Member> members;
+        if (!open(in, archivePath, key, aes128, header, context, members, error)) {
+            return false;
+        }
+
+        for (const Member& member : members) {
+            if (!safeMemberPath(member.path)) {
+                summary.failures.emplace_back(member.path, "Refusing to write outside the output folder.");
+                continue;
+            }
+
+            fs::path target = fs::path(outputDir) / fs::path(member.path);
+            fs::create_directories(target.parent_path());
+
+            std::string memberError;
+            if (extractMember(in, header, context, member, target.string(), memberError)) {
+                ++summary.files;
+                summary.bytes += member.size;
+            }
+            else {
+                summary.failures.emplace_back(member.path, memberError);
+            }
+        }
+        return true;
+    }
+    catch (const std::exception& e) {
+        error = std::string("Decryption error: ") + e.what();
+        return false;
+    }
+}
\ No newline at end of file
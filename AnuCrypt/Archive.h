@@ -0,0 +1,57 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <utility>
+#include <fstream>
+#include <cstdint>
+#include "ChunkedCipher.h"
+
+// Packs a folder into one encrypted file (see CryptFormat for the layout), so
+// a tree of many small files costs one output file instead of one per source.
+// Packing streams each member straight through; only the index is held in
+// memory. A single member can be extracted without decrypting the others.
+class Archive {
+public:
+    struct Member {
+        std::string path;    // relative, '/' separated
+        uint64_t offset;     // of its first record
+        uint64_t size;       // plaintext bytes
+        std::vector<uint8_t> iv;
+    };
+
+    struct Summary {
+        size_t files = 0;
+        uint64_t bytes = 0;
+        std::vector<std::pair<std::string, std::string>> failures;
+    };
+
+    static bool pack(const std::string& folder, const std::string& archivePath,
+                     const std::vector<uint8_t>& key, bool aes128, Summary& summary, std::string& error);
+
+    static bool list(const std::string& archivePath, const std::vector<uint8_t>& key, bool aes128,
+                     std::vector<Member>& members, std::string& error);
+
+    // Writes one member to outputPath; the output only appears once verified.
+    static bool extract(const std::string& archivePath, const std::vector<uint8_t>& key, bool aes128,
+                        const std::string& memberPath, const std::string& outputPath, std::string& error);
+
+    // Recreates every member under outputDir. Members whose path would leave
+    // outputDir are refused.
+    static bool extractAll(const std::string& archivePath, const std::vector<uint8_t>& key, bool aes128,
+                           const std::string& outputDir, Summary& summary, std::string& error);
+
+private:
+    static const size_t TRAILER_SIZE = 24;
+    static const uint64_t MAX_INDEX_SIZE = 1ULL << 32;
+
+    static bool open(std::ifstream& in, const std::string& archivePath, const std::vector<uint8_t>& key,
+                     bool aes128, CryptFormat::Header& header, ChunkedCipher::DecryptContext& context,
+                     std::vector<Member>& members, std::string& error);
+    static bool extractMember(std::ifstream& in, const CryptFormat::Header& header,
+                              ChunkedCipher::DecryptContext& context, const Member& member,
+                              const std::string& outputPath, std::string& error);
+    static bool safeMemberPath(const std::string& path);
+    static std::string serializeIndex(const std::vector<Member>& members);
+    static bool parseIndex(const std::string& data, uint32_t chunkSize, uint64_t indexOffset,
+                           std::vector<Member>& members);
+};
\ No newline at end of file
@@ -0,0 +1,591 @@
+#include "Base64Codec.h"
+#include "CpuFeatures.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <atomic>
+#include <bitset>
+#ifdef ANUCRYPT_X86
+#include <immintrin.h>
+#endif
+
+namespace {
+    struct AlphabetTables {
+        char encode[65];
+        int8_t decode[256];
+    };
+
+    AlphabetTables makeTables(char c62, char c63) {
+        AlphabetTables tables;
+        const char* letters = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789";
+        std::copy(letters, letters + 62, tables.encode);
+        tables.encode[62] = c62;
+        tables.encode[63] = c63;
+        tables.encode[64] = '\0';
+
+        std::fill(tables.decode, tables.decode + 256, static_cast<int8_t>(-1));
+        for (int i = 0; i < 64; ++i) {
+            tables.decode[static_cast<uint8_t>(tables.encode[i])] = static_cast<int8_t>(i);
+        }
+        return tables;
+    }
+
+    const AlphabetTables& tablesFor(Base64Codec::Alphabet alphabet) {
+        static const AlphabetTables standard = makeTables('+', '/');
+        static const AlphabetTables urlSafe = makeTables('-', '_');
+        return alphabet == Base64Codec::URL_SAFE ? urlSafe : standard;
+    }
+
+    // Kernels only handle whole blocks from the front of their input and return
+    // how many input bytes they consumed; scalar code finishes the rest. Decode
+    // kernels stop at the first block holding a character outside the alphabet.
+    typedef size_t (*EncodeKernel)(const uint8_t* src, size_t length, char* out, const AlphabetTables& tables);
+    typedef size_t (*DecodeKernel)(const char* src, size_t length, uint8_t* out, const AlphabetTables& tables);
+    typedef size_t (*CountKernel)(const char* src, size_t length, const AlphabetTables& tables, size_t& valid);
+
+    size_t encodeScalarBlocks(const uint8_t*, size_t, char*, const AlphabetTables&) {
+        return 0;
+    }
+
+    size_t decodeScalarBlocks(const char*, size_t, uint8_t*, const AlphabetTables&) {
+        return 0;
+    }
+
+    size_t countScalarBlocks(const char*, size_t, const AlphabetTables&, size_t& valid) {
+        valid = 0;
+        return 0;
+    }
+
+#ifdef ANUCRYPT_X86
+    // Encoding follows Mula's method: shuffle each 3-byte group into a 32-bit
+    // lane, isolate the four 6-bit fields with multiplies, then turn indices into
+    // characters by adding a per-range offset looked up with pshufb.
+    ANUCRYPT_TARGET("ssse3")
+    inline __m128i encodeShiftLutSsse3(const AlphabetTables& tables) {
+        return _mm_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+            '0' - 52, '0' - 52, '0' - 52, static_cast<char>(tables.encode[62] - 62),
+            static_cast<char>(tables.encode[63] - 63), 'A', 0, 0);
+    }
+
+    ANUCRYPT_TARGET("ssse3")
+    size_t encodeSsse3(const uint8_t* src, size_t length, char* out, const AlphabetTables& tables) {
+        const __m128i shuffle = _mm_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10);
+        const __m128i shiftLut = encodeShiftLutSsse3(tables);
+        size_t done = 0;
+
+        // Each step loads 16 bytes and uses 12 of them.
+        while (length - done >= 16) {
+            __m128i in = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + done)), shuffle);
+            __m128i t0 = _mm_mulhi_epu16(_mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00)), _mm_set1_epi32(0x04000040));
+            __m128i t1 = _mm_mullo_epi16(_mm_and_si128(in, _mm_set1_epi32(0x003f03f0)), _mm_set1_epi32(0x01000010));
+            __m128i indices = _mm_or_si128(t0, t1);
+
+            __m128i range = _mm_subs_epu8(indices, _mm_set1_epi8(51));
+            range = _mm_or_si128(range, _mm_and_si128(_mm_cmpgt_epi8(_mm_set1_epi8(26), indices), _mm_set1_epi8(13)));
+            __m128i chars = _mm_add_epi8(_mm_shuffle_epi8(shiftLut, range), indices);
+
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out), chars);
+            done += 12;
+            out += 16;
+        }
+        return done;
+    }
+
+    ANUCRYPT_TARGET("avx2")
+    size_t encodeAvx2(const uint8_t* src, size_t length, char* out, const AlphabetTables& tables) {
+        const __m256i shuffle = _mm256_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10,
+            1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10);
+        const __m256i shiftLut = _mm256_broadcastsi128_si256(encodeShiftLutSsse3(tables));
+        size_t done = 0;
+
+        // Each step loads 12 bytes into each 128-bit lane (28 bytes read) and
+        // produces 32 characters.
+        while (length - done >= 28) {
+            __m256i in = _mm256_inserti128_si256(
+                _mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + done))),
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + done + 12)), 1);
+            in = _mm256_shuffle_epi8(in, shuffle);
+            __m256i t0 = _mm256_mulhi_epu16(_mm256_and_si256(in, _mm256_set1_epi32(0x0fc0fc00)),
+                _mm256_set1_epi32(0x04000040));
+            __m256i t1 = _mm256_mullo_epi16(_mm256_and_si256(in, _mm256_set1_epi32(0x003f03f0)),
+                _mm256_set1_epi32(0x01000010));
+            __m256i indices = _mm256_or_si256(t0, t1);
+
+            __m256i range = _mm256_subs_epu8(indices, _mm256_set1_epi8(51));
+            range = _mm256_or_si256(range,
+                _mm256_and_si256(_mm256_cmpgt_epi8(_mm256_set1_epi8(26), indices), _mm256_set1_epi8(13)));
+            __m256i chars = _mm256_add_epi8(_mm256_shuffle_epi8(shiftLut, range), indices);
+
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), chars);
+            done += 24;
+            out += 32;
+        }
+        return done;
+    }
+
+    // Decoding classifies every character by range (bytes >= 0x80 compare as
+    // negative and fall outside all of them), adds the range's offset to get the
+    // 6-bit value, and packs four values into three bytes with two multiply-adds.
+    ANUCRYPT_TARGET("ssse3")
+    inline __m128i inRangeSsse3(__m128i in, char lo, char hi) {
+        return _mm_and_si128(_mm_cmpgt_epi8(in, _mm_set1_epi8(static_cast<char>(lo - 1))),
+            _mm_cmpgt_epi8(_mm_set1_epi8(static_cast<char>(hi + 1)), in));
+    }
+
+    ANUCRYPT_TARGET("ssse3")
+    inline __m128i sextetsSsse3(__m128i in, const AlphabetTables& tables, int& validMask) {
+        const char c62 = tables.encode[62];
+        const char c63 = tables.encode[63];
+        __m128i upper = inRangeSsse3(in, 'A', 'Z');
+        __m128i lower = inRangeSsse3(in, 'a', 'z');
+        __m128i digit = inRangeSsse3(in, '0', '9');
+        __m128i is62 = _mm_cmpeq_epi8(in, _mm_set1_epi8(c62));
+        __m128i is63 = _mm_cmpeq_epi8(in, _mm_set1_epi8(c63));
+        validMask = _mm_movemask_epi8(_mm_or_si128(_mm_or_si128(upper, lower), _mm_or_si128(digit, _mm_or_si128(is62, is63))));
+
+        __m128i shift = _mm_or_si128(_mm_and_si128(upper, _mm_set1_epi8(-'A')),
+            _mm_and_si128(lower, _mm_set1_epi8(static_cast<char>(26 - 'a'))));
+        shift = _mm_or_si128(shift, _mm_and_si128(digit, _mm_set1_epi8(52 - '0')));
+        shift = _mm_or_si128(shift, _mm_and_si128(is62, _mm_set1_epi8(static_cast<char>(62 - c62))));
+        shift = _mm_or_si128(shift, _mm_and_si128(is63, _mm_set1_epi8(static_cast<char>(63 - c63))));
+        return _mm_add_epi8(in, shift);
+    }
+
+    ANUCRYPT_TARGET("ssse3")
+    size_t decodeSsse3(const char* src, size_t length, uint8_t* out, const AlphabetTables& tables) {
+        const __m128i pack = _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+        size_t done = 0;
+
+        while (length - done >= 16) {
+            int validMask;
+            __m128i values = sextetsSsse3(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + done)), tables, validMask);
+            if (validMask != 0xFFFF) {
+                break;
+            }
+
+            __m128i merged = _mm_maddubs_epi16(values, _mm_set1_epi32(0x01400140));
+            merged = _mm_madd_epi16(merged, _mm_set1_epi32(0x00011000));
+            merged = _mm_shuffle_epi8(merged, pack);
+
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(out), merged);
+            int tail = _mm_cvtsi128_si32(_mm_srli_si128(merged, 8));
+            std::copy(reinterpret_cast<const uint8_t*>(&tail), reinterpret_cast<const uint8_t*>(&tail) + 4, out + 8);
+            done += 16;
+            out += 12;
+        }
+        return done;
+    }
+
+    ANUCRYPT_TARGET("ssse3")
+    size_t countSsse3(const char* src, size_t length, const AlphabetTables& tables, size_t& valid) {
+        size_t done = 0;
+        valid = 0;
+        while (length - done >= 16) {
+            int validMask;
+            sextetsSsse3(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + done)), tables, validMask);
+            valid += std::bitset<16>(static_cast<unsigned>(validMask)).count();
+            done += 16;
+        }
+        return done;
+    }
+
+    ANUCRYPT_TARGET("avx2")
+    inline __m256i inRangeAvx2(__m256i in, char lo, char hi) {
+        return _mm256_and_si256(_mm256_cmpgt_epi8(in, _mm256_set1_epi8(static_cast<char>(lo - 1))),
+            _mm256_cmpgt_epi8(_mm256_set1_epi8(static_cast<char>(hi + 1)), in));
+    }
+
+    ANUCRYPT_TARGET("avx2")
+    inline __m256i sextetsAvx2(__m256i in, const AlphabetTables& tables, unsigned& validMask) {
+        const char c62 = tables.encode[62];
+        const char c63 = tables.encode[63];
+        __m256i upper = inRangeAvx2(in, 'A', 'Z');
+        __m256i lower = inRangeAvx2(in, 'a', 'z');
+        __m256i digit = inRangeAvx2(in, '0', '9');
+        __m256i is62 = _mm256_cmpeq_epi8(in, _mm256_set1_epi8(c62));
+        __m256i is63 = _mm256_cmpeq_epi8(in, _mm256_set1_epi8(c63));
+        validMask = static_cast<unsigned>(_mm256_movemask_epi8(
+            _mm256_or_si256(_mm256_or_si256(upper, lower), _mm256_or_si256(digit, _mm256_or_si256(is62, is63)))));
+
+        __m256i shift = _mm256_or_si256(_mm256_and_si256(upper, _mm256_set1_epi8(-'A')),
+            _mm256_and_si256(lower, _mm256_set1_epi8(static_cast<char>(26 - 'a'))));
+        shift = _mm256_or_si256(shift, _mm256_and_si256(digit, _mm256_set1_epi8(52 - '0')));
+        shift = _mm256_or_si256(shift, _mm256_and_si256(is62, _mm256_set1_epi8(static_cast<char>(62 - c62))));
+        shift = _mm256_or_si256(shift, _mm256_and_si256(is63, _mm256_set1_epi8(static_cast<char>(63 - c63))));
+        return _mm256_add_epi8(in, shift);
+    }
+
+    ANUCRYPT_TARGET("avx2")
+    size_t decodeAvx2(const char* src, size_t length, uint8_t* out, const AlphabetTables& tables) {
+        const __m256i pack = _mm256_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+            2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+        const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7);
+        size_t done = 0;
+
+        while (length - done >= 32) {
+            unsigned validMask;
+            __m256i values = sextetsAvx2(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + done)), tables, validMask);
+            if (validMask != 0xFFFFFFFFu) {
+                break;
+            }
+
+            __m256i merged = _mm256_maddubs_epi16(values, _mm256_set1_epi32(0x01400140));
+            merged = _mm256_madd_epi16(merged, _mm256_set1_epi32(0x00011000));
+            merged = _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(merged, pack), lanes);
+
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm256_castsi256_si128(merged));
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(out + 16), _mm256_extracti128_si256(merged, 1));
+            done += 32;
+            out += 24;
+        }
+        return done;
+    }
+
+    ANUCRYPT_TARGET("avx2")
+    size_t countAvx2(const char* src, size_t length, const AlphabetTables& tables, size_t& valid) {
+        size_t done = 0;
+        valid = 0;
+        while (length - done >= 32) {
+            unsigned validMask;
+            sextetsAvx2(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + done)), tables, validMask);
+            valid += std::bitset<32>(validMask).count();
+            done += 32;
+        }
+        return done;
+    }
+#endif
+
+    struct Kernels {
+        EncodeKernel encode;
+        DecodeKernel decode;
+        CountKernel count;
+    };
+
+    bool isSupported(Base64Codec::Implementation impl) {
+        switch (impl) {
+        case Base64Codec::AUTO:
+        case Base64Codec::SCALAR:
+            return true;
+#ifdef ANUCRYPT_X86
+        case Base64Codec::SSSE3:
+            return CpuFeatures::hasSSSE3();
+        case Base64Codec::AVX2:
+            return CpuFeatures::hasAVX2();
+#endif
+        default:
+            return false;
+        }
+    }
+
+    Base64Codec::Implementation bestImplementation() {
+        if (isSupported(Base64Codec::AVX2)) {
+            return Base64Codec::AVX2;
+        }
+        if (isSupported(Base64Codec::SSSE3)) {
+            return Base64Codec::SSSE3;
+        }
+        return Base64Codec::SCALAR;
+    }
+
+    std::atomic<int> selectedImplementation(Base64Codec::AUTO);
+
+    Kernels kernels() {
+        switch (Base64Codec::implementation()) {
+#ifdef ANUCRYPT_X86
+        case Base64Codec::AVX2:
+            return Kernels{ encodeAvx2, decodeAvx2, countAvx2 };
+        case Base64Codec::SSSE3:
+            return Kernels{ encodeSsse3, decodeSsse3, countSsse3 };
+#endif
+        default:
+            return Kernels{ encodeScalarBlocks, decodeScalarBlocks, countScalarBlocks };
+        }
+    }
+
+    size_t effectiveLineLength(const Base64Codec::Options& options) {
+        if (options.lineLength == 0) {
+            return 0;
+        }
+        return std::max<size_t>(4, options.lineLength / 4 * 4);
+    }
+
+    // Encodes one unbroken run; only the last run of a message may end in a
+    // partial group.
+    size_t encodeRun(const uint8_t* src, size_t length, char* out, const Kernels& kernels,
+        const AlphabetTables& tables, bool padding) {
+        size_t done = kernels.encode(src, length, out, tables);
+        char* p = out + done / 3 * 4;
+
+        for (; length - done >= 3; done += 3) {
+            uint32_t v = (static_cast<uint32_t>(src[done]) << 16) | (src[done + 1] << 8) | src[done + 2];
+            p[0] = tables.encode[v >> 18];
+            p[1] = tables.encode[(v >> 12) & 0x3F];
+            p[2] = tables.encode[(v >> 6) & 0x3F];
+            p[3] = tables.encode[v & 0x3F];
+            p += 4;
+        }
+
+        size_t rest = length - done;
+        if (rest > 0) {
+            uint32_t v = static_cast<uint32_t>(src[done]) << 16;
+            if (rest == 2) {
+                v |= src[done + 1] << 8;
+            }
+            *p++ = tables.encode[v >> 18];
+            *p++ = tables.encode[(v >> 12) & 0x3F];
+            if (rest == 2) {
+                *p++ = tables.encode[(v >> 6) & 0x3F];
+            }
+            else if (padding) {
+                *p++ = '=';
+            }
+            if (padding) {
+                *p++ = '=';
+            }
+        }
+        return static_cast<size_t>(p - out);
+    }
+
+    // Encodes whole lines; src must start on a line boundary.
+    size_t encodeLines(const uint8_t* src, size_t length, char* out, size_t lineLength, const Kernels& kernels,
+        const AlphabetTables& tables, bool padding) {
+        if (lineLength == 0) {
+            return encodeRun(src, length, out, kernels, tables, padding);
+        }
+
+        const size_t lineBytes = lineLength / 4 * 3;
+        char* p = out;
+        for (size_t offset = 0; offset < length; offset += lineBytes) {
+            if (offset > 0) {
+                *p++ = '\n';
+            }
+            p += encodeRun(src + offset, std::min(lineBytes, length - offset), p, kernels, tables, padding);
+        }
+        return static_cast<size_t>(p - out);
+    }
+
+    // Characters outside the alphabet (line breaks, padding, anything else) are
+    // skipped, and a trailing partial group yields as many whole bytes as its
+    // bits cover, exactly like the Crypto++ decoder.
+    size_t decodeRun(const char* src, size_t length, uint8_t* out, const Kernels& kernels,
+        const AlphabetTables& tables) {
+        uint8_t* p = out;
+        uint32_t bits = 0;
+        unsigned count = 0;
+        size_t i = 0;
+
+        while (i < length) {
+            if (count == 0) {
+                size_t used = kernels.decode(src + i, length - i, p, tables);
+                i += used;
+                p += used / 4 * 3;
+
+                while (length - i >= 4) {
+                    int a = tables.decode[static_cast<uint8_t>(src[i])];
+                    int b = tables.decode[static_cast<uint8_t>(src[i + 1])];
+                    int c = tables.decode[static_cast<uint8_t>(src[i + 2])];
+                    int d = tables.decode[static_cast<uint8_t>(src[i + 3])];
+                    if ((a | b | c | d) < 0) {
+                        break;
+                    }
+                    uint32_t v = (a << 18) | (b << 12) | (c << 6) | d;
+                    p[0] = static_cast<uint8_t>(v >> 16);
+                    p[1] = static_cast<uint8_t>(v >> 8);
+                    p[2] = static_cast<uint8_t>(v);
+                    p += 3;
+                    i += 4;
+                }
+                if (i == length) {
+                    break;
+                }
+            }
+
+            int value = tables.decode[static_cast<uint8_t>(src[i++])];
+            if (value < 0) {
+                continue;
+            }
+            bits = (bits << 6) | static_cast<uint32_t>(value);
+            if (++count == 4) {
+                p[0] = static_cast<uint8_t>(bits >> 16);
+                p[1] = static_cast<uint8_t>(bits >> 8);
+                p[2] = static_cast<uint8_t>(bits);
+                p += 3;
+                bits = 0;
+                count = 0;
+            }
+        }
+
+        if (count == 2) {
+            *p++ = static_cast<uint8_t>(bits >> 4);
+        }
+        else if (count == 3) {
+            *p++ = static_cast<uint8_t>(bits >> 10);
+            *p++ = static_cast<uint8_t>(bits >> 2);
+        }
+        return static_cast<size_t>(p - out);
+    }
+
+    size_t countValid(const char* src, size_t length, const Kernels& kernels, const AlphabetTables& tables) {
+        size_t valid;
+        size_t done = kernels.count(src, length, tables, valid);
+        for (; done < length; ++done) {
+            if (tables.decode[static_cast<uint8_t>(src[done])] >= 0) {
+                ++valid;
+            }
+        }
+        return valid;
+    }
+
+    size_t partCount(size_t length, size_t threads, size_t minPart) {
+        if (threads < 2 || length < 2 * minPart) {
+            return 1;
+        }
+        return std::min(threads, length / minPart);
+    }
+}
+
+size_t Base64Codec::encodedSize(size_t length, const Options& options) {
+    size_t chars = length / 3 * 4;
+    if (length % 3 != 0) {
+        chars += options.padding ? 4 : length % 3 + 1;
+    }
+
+    size_t lineLength = effectiveLineLength(options);
+    if (lineLength > 0 && chars > 0) {
+        chars += (chars - 1) / lineLength;
+    }
+    return chars;
+}
+
+const char* Base64Codec::characters(Alphabet alphabet) {
+    return tablesFor(alphabet).encode;
+}
+
+size_t Base64Codec::lineInputSize(const Options& options) {
+    return effectiveLineLength(options) / 4 * 3;
+}
+
+size_t Base64Codec::maxDecodedSize(size_t length) {
+    return length / 4 * 3 + 2;
+}
+
+size_t Base64Codec::encode(const uint8_t* data, size_t length, char* out, const Options& options) {
+    const Kernels active = kernels();
+    const AlphabetTables& tables = tablesFor(options.alphabet);
+    const size_t lineLength = effectiveLineLength(options);
+
+    size_t parts = partCount(length, options.threads, MIN_PARALLEL_PART);
+    if (parts == 1) {
+        return encodeLines(data, length, out, lineLength, active, tables, options.padding);
+    }
+
+    // Split on line boundaries (or 3-byte groups without line breaks) so every
+    // part knows exactly where its output starts.
+    const size_t unit = lineLength > 0 ? lineLength / 4 * 3 : 3;
+    const size_t partBytes = (length / parts + unit - 1) / unit * unit;
+    {
+        ThreadPool pool(parts);
+        for (size_t offset = 0; offset < length; offset += partBytes) {
+            pool.submit([=, &tables] {
+                size_t outOffset = lineLength > 0 ? offset / unit * (lineLength + 1) : offset / 3 * 4;
+                if (offset > 0 && lineLength > 0) {
+                    out[outOffset - 1] = '\n';
+                }
+                encodeLines(data + offset, std::min(partBytes, length - offset), out + outOffset, lineLength,
+                    active, tables, options.padding);
+            });
+        }
+        pool.wait();
+    }
+    return encodedSize(length, options);
+}
+
+size_t Base64Codec::decode(const char* encoded, size_t length, uint8_t* out, const Options& options) {
+    const Kernels active = kernels();
+    const AlphabetTables& tables = tablesFor(options.alphabet);
+
+    size_t parts = partCount(length, options.threads, MIN_PARALLEL_PART);
+    if (parts == 1) {
+        return decodeRun(encoded, length, out, active, tables);
+    }
+
+    // Output positions depend on how many alphabet characters precede each
+    // part, so count those first, then start every part on a 4-character group.
+    const size_t partChars = (length + parts - 1) / parts;
+    std::vector<size_t> valid(parts, 0);
+    std::vector<const char*> begin(parts + 1, encoded + length);
+    std::vector<size_t> outOffset(parts, 0);
+    std::vector<size_t> written(parts, 0);
+
+    ThreadPool pool(parts);
+    for (size_t i = 0; i < parts; ++i) {
+        pool.submit([&, i] {
+            size_t offset = std::min(length, i * partChars);
+            valid[i] = countValid(encoded + offset, std::min(partChars, length - offset), active, tables);
+        });
+    }
+    pool.wait();
+
+    size_t before = 0;
+    for (size_t i = 0; i < parts; ++i) {
+        const char* p = encoded + std::min(length, i * partChars);
+        size_t skip = (4 - before % 4) % 4;
+        while (skip > 0 && p < encoded + length) {
+            if (tables.decode[static_cast<uint8_t>(*p++)] >= 0) {
+                --skip;
+            }
+        }
+        begin[i] = std::max(p, i > 0 ? begin[i - 1] : encoded);
+        outOffset[i] = (before + 3) / 4 * 3;
+        before += valid[i];
+    }
+
+    for (size_t i = 0; i < parts; ++i) {
+        pool.submit([&, i] {
+            written[i] = decodeRun(begin[i], static_cast<size_t>(begin[i + 1] - begin[i]), out + outOffset[i],
+                active, tables);
+        });
+    }
+    pool.wait();
+
+    return outOffset[parts - 1] + written[parts - 1];
+}
+
+std::string Base64Codec::encode(const uint8_t* data, size_t length, const Options& options) {
+    std::string encoded(encodedSize(length, options), '\0');
+    if (!encoded.empty()) {
+        encode(data, length, &encoded[0], options);
+    }
+    return encoded;
+}
+
+std::vector<uint8_t> Base64Codec::decode(const char* encoded, size_t length, const Options& options) {
+    std::vector<uint8_t> decoded(maxDecodedSize(length));
+    decoded.resize(decode(encoded, length, decoded.data(), options));
+    return decoded;
+}
+
+Base64Codec::Implementation Base64Codec::implementation() {
+    Implementation impl = static_cast<Implementation>(selectedImplementation.load());
+    return impl == AUTO ? bestImplementation() : impl;
+}
+
+bool Base64Codec::setImplementation(Implementation impl) {
+    if (!isSupported(impl)) {
+        return false;
+    }
+    selectedImplementation = impl;
+    return true;
+}
+
+const char* Base64Codec::implementationName(Implementation impl) {
+    switch (impl) {
+    case SCALAR:
+        return "scalar";
+    case SSSE3:
+        return "SSSE3";
+    case AVX2:
+        return "AVX2";
+    default:
+        return "auto";
+    }
+}
\ No newline at end of file
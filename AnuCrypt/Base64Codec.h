@@ -0,0 +1,58 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <cstdint>
+
+// Base64 encoder/decoder with SSSE3 and AVX2 kernels picked at runtime and a
+// scalar fallback. With default options the output is byte-for-byte what the
+// Crypto++ Base64Encoder produced (72-column lines, no trailing newline), and
+// decoding skips characters outside the alphabet the same way.
+class Base64Codec {
+public:
+    enum Alphabet {
+        STANDARD,   // RFC 4648 section 4: '+' and '/'
+        URL_SAFE    // RFC 4648 section 5: '-' and '_'
+    };
+
+    enum Implementation {
+        AUTO,
+        SCALAR,
+        SSSE3,
+        AVX2
+    };
+
+    struct Options {
+        Alphabet alphabet = STANDARD;
+        size_t lineLength = DEFAULT_LINE_LENGTH; // 0 disables line breaks; rounded down to a multiple of 4
+        bool padding = true;
+        size_t threads = 1;
+    };
+
+    static const size_t DEFAULT_LINE_LENGTH = 72;
+
+    // The 64 characters of an alphabet in value order, NUL-terminated.
+    static const char* characters(Alphabet alphabet);
+
+    static size_t encodedSize(size_t length, const Options& options);
+    // Input bytes that make up one full output line, or 0 without line breaks.
+    static size_t lineInputSize(const Options& options);
+    static size_t maxDecodedSize(size_t length);
+
+    // out must hold encodedSize() / maxDecodedSize() bytes; both return the
+    // number of bytes written.
+    static size_t encode(const uint8_t* data, size_t length, char* out, const Options& options);
+    static size_t decode(const char* encoded, size_t length, uint8_t* out, const Options& options);
+
+    static std::string encode(const uint8_t* data, size_t length, const Options& options);
+    static std::vector<uint8_t> decode(const char* encoded, size_t length, const Options& options);
+
+    // The kernel in use. setImplementation() lets benchmarks and checks force a
+    // specific one; it fails if this CPU does not support it.
+    static Implementation implementation();
+    static bool setImplementation(Implementation impl);
+    static const char* implementationName(Implementation impl);
+
+private:
+    // Inputs are only split across threads in parts at least this large.
+    static const size_t MIN_PARALLEL_PART = 1 << 20;
+};
\ No newline at end of file
@@ -1,18 +1,13 @@
 #include "Base64Decoder.h"
-#include <cryptopp/base64.h>
-#include <cryptopp/filters.h>
 
 std::vector<uint8_t> Base64Decoder::decode(const std::string& encoded) {
-    std::vector<uint8_t> decoded;
-    CryptoPP::Base64Decoder decoder;
-    decoder.Put(reinterpret_cast<const CryptoPP::byte*>(encoded.data()), encoded.size());
-    decoder.MessageEnd();
+    return decode(encoded.data(), encoded.size());
+}
 
-    CryptoPP::word64 size = decoder.MaxRetrievable();
-    if (size) {
-        decoded.resize(size);
-        decoder.Get(reinterpret_cast<CryptoPP::byte*>(decoded.data()), decoded.size());
-    }
+std::vector<uint8_t> Base64Decoder::decode(const char* encoded, size_t length) {
+    return decode(encoded, length, Base64Codec::Options());
+}
 
-    return decoded;
+std::vector<uint8_t> Base64Decoder::decode(const char* encoded, size_t length, const Base64Codec::Options& options) {
+    return Base64Codec::decode(encoded, length, options);
 }
\ No newline at end of file
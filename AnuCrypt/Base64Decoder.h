@@ -1,10 +1,11 @@
 #pragma once
 #include <string>
 #include <vector>
-#include <cryptopp/base64.h>
-#include <cryptopp/filters.h>
+#include "Base64Codec.h"
 
 class Base64Decoder {
 public:
     static std::vector<uint8_t> decode(const std::string& encoded);
+    static std::vector<uint8_t> decode(const char* encoded, size_t length);
+    static std::vector<uint8_t> decode(const char* encoded, size_t length, const Base64Codec::Options& options);
 };
\ No newline at end of file
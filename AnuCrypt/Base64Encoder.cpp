@@ -1,26 +1,13 @@
 #include "Base64Encoder.h"
-#include "Base64Encoder.h"
-#include <cryptopp/base64.h>
-#include <cryptopp/filters.h>
 
 std::string Base64Encoder::encode(const std::vector<uint8_t>& data) {
-    std::string encoded;
-    CryptoPP::Base64Encoder encoder;
-    encoder.Put(data.data(), data.size());
-    encoder.MessageEnd();
-
-    CryptoPP::word64 size = encoder.MaxRetrievable();
-    if (size) {
-        encoded.resize(size);
-        encoder.Get(reinterpret_cast<CryptoPP::byte*>(&encoded[0]), encoded.size());
-    }
+    return encode(data.data(), data.size());
+}
 
-    if (!encoded.empty() && encoded.back() == '\n') {
-        encoded.pop_back();
-    }
-    if (!encoded.empty() && encoded.back() == '\r') {
-        encoded.pop_back();
-    }
+std::string Base64Encoder::encode(const uint8_t* data, size_t length) {
+    return encode(data, length, Base64Codec::Options());
+}
 
-    return encoded;
+std::string Base64Encoder::encode(const uint8_t* data, size_t length, const Base64Codec::Options& options) {
+    return Base64Codec::encode(data, length, options);
 }
\ No newline at end of file
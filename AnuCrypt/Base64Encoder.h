@@ -1,10 +1,11 @@
 #pragma once
 #include <string>
 #include <vector>
-#include <cryptopp/base64.h>
-#include <cryptopp/filters.h>
+#include "Base64Codec.h"
 
 class Base64Encoder {
 public:
     static std::string encode(const std::vector<uint8_t>& data);
+    static std::string encode(const uint8_t* data, size_t length);
+    static std::string encode(const uint8_t* data, size_t length, const Base64Codec::Options& options);
 };
\ No newline at end of file
@@ -0,0 +1,184 @@
+#include "Base64Stream.h"
+#include <vector>
+#include <algorithm>
+
+namespace {
+    enum CharClass : uint8_t {
+        ALPHABET,
+        WHITESPACE,
+        PADDING,
+        INVALID
+    };
+
+    struct ClassTable {
+        uint8_t classes[256];
+    };
+
+    ClassTable makeClassTable(Base64Codec::Alphabet alphabet) {
+        ClassTable table;
+        std::fill(table.classes, table.classes + 256, static_cast<uint8_t>(INVALID));
+        for (const char* c = Base64Codec::characters(alphabet); *c; ++c) {
+            table.classes[static_cast<uint8_t>(*c)] = ALPHABET;
+        }
+        for (char c : { ' ', '\t', '\r', '\n', '\v', '\f' }) {
+            table.classes[static_cast<uint8_t>(c)] = WHITESPACE;
+        }
+        table.classes[static_cast<uint8_t>('=')] = PADDING;
+        return table;
+    }
+
+    std::string offsetError(const char* what, uint64_t offset) {
+        return std::string(what) + " at offset " + std::to_string(offset) + ".";
+    }
+}
+
+bool Base64Stream::encode(std::istream& in, std::ostream& out, const Base64Codec::Options& options,
+    std::string& error) {
+    try {
+        // Blocks hold whole output lines (or whole 3-byte groups without line
+        // breaks), so only the final block can need padding. Each thread gets a
+        // block's worth so the codec can split it.
+        size_t unit = Base64Codec::lineInputSize(options);
+        if (unit == 0) {
+            unit = 3;
+        }
+        const size_t blockSize = BLOCK_SIZE * std::max<size_t>(1, options.threads) / unit * unit;
+
+        std::vector<uint8_t> input(blockSize);
+        std::vector<char> encoded(Base64Codec::encodedSize(blockSize, options));
+        bool first = true;
+
+        while (true) {
+            in.read(reinterpret_cast<char*>(input.data()), input.size());
+            size_t got = static_cast<size_t>(in.gcount());
+            if (in.bad()) {
+                error = "Failed reading input.";
+                return false;
+            }
+            if (got == 0) {
+                break;
+            }
+
+            if (!first && options.lineLength > 0) {
+                out.put('\n');
+            }
+            size_t length = Base64Codec::encode(input.data(), got, encoded.data(), options);
+            out.write(encoded.data(), length);
+            if (!out) {
+                error = "Failed writing output.";
+                return false;
+            }
+            first = false;
+
+            if (got < input.size()) {
+                break;
+            }
+        }
+
+        out.flush();
+        return true;
+    }
+    catch (const std::exception& e) {
+        error = e.what();
+        return false;
+    }
+}
+
+bool Base64Stream::decode(std::istream& in, std::ostream& out, const Base64Codec::Options& options,
+    std::string& error) {
+    try {
+        const ClassTable table = makeClassTable(options.alphabet);
+        Base64Codec::Options blockOptions = options;
+        blockOptions.threads = 1;
+
+        // clean holds the alphabet characters of one block plus up to three
+        // carried over from the previous one.
+        std::vector<char> input(BLOCK_SIZE);
+        std::vector<char> clean(BLOCK_SIZE + 3);
+        std::vector<uint8_t> decoded(Base64Codec::maxDecodedSize(clean.size()));
+
+        uint64_t offset = 0;
+        uint64_t lastCharOffset = 0;
+        size_t pending = 0;
+        size_t padding = 0;
+
+        while (true) {
+            in.read(input.data(), input.size());
+            size_t got = static_cast<size_t>(in.gcount());
+            if (in.bad()) {
+                error = "Failed reading input.";
+                return false;
+            }
+            if (got == 0) {
+                break;
+            }
+
+            size_t count = pending;
+            for (size_t i = 0; i < got; ++i) {
+                switch (table.classes[static_cast<uint8_t>(input[i])]) {
+                case ALPHABET:
+                    if (padding > 0) {
+                        error = offsetError("Unexpected data after padding", offset + i);
+                        return false;
+                    }
+                    clean[count++] = input[i];
+                    lastCharOffset = offset + i;
+                    break;
+                case WHITESPACE:
+                    break;
+                case PADDING:
+                    // Only the last group may be padded, to exactly four characters.
+                    if (count % 4 < 2 || count % 4 + padding >= 4) {
+                        error = offsetError("Unexpected padding", offset + i);
+                        return false;
+                    }
+                    ++padding;
+                    break;
+                default:
+                    error = offsetError("Invalid Base64 character", offset + i);
+                    return false;
+                }
+            }
+
+            size_t whole = count / 4 * 4;
+            size_t length = Base64Codec::decode(clean.data(), whole, decoded.data(), blockOptions);
+            out.write(reinterpret_cast<const char*>(decoded.data()), length);
+            if (!out) {
+                error = "Failed writing output.";
+                return false;
+            }
+
+            pending = count - whole;
+            std::copy(clean.begin() + whole, clean.begin() + count, clean.begin());
+            offset += got;
+
+            if (got < input.size()) {
+                break;
+            }
+        }
+
+        if (padding > 0 && pending + padding != 4) {
+            error = offsetError("Incomplete padding", offset);
+            return false;
+        }
+        if (pending == 1) {
+            error = offsetError("Truncated Base64 group", lastCharOffset);
+            return false;
+        }
+        if (pending > 0) {
+            size_t length = Base64Codec::decode(clean.data(), pending, decoded.data(), blockOptions);
+            out.write(reinterpret_cast<const char*>(decoded.data()), length);
+        }
+
+        out.flush();
+        if (!out) {
+            error = "Failed writing output.";
+            return false;
+        }
+        return true;
+    }
+    catch (const std::exception& e) {
+        error = e.what();
+        return false;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,20 @@
+#pragma once
+#include <string>
+#include <iostream>
+#include "Base64Codec.h"
+
+// Base64 over streams in fixed-size blocks, so memory use does not depend on
+// the input size. Encoding reads whole output lines at a time, one block per
+// thread in options.threads; decoding carries an incomplete 4-character group
+// over to the next block.
+//
+// Decoding is strict: whitespace is skipped, '=' is only accepted as padding at
+// the end, and anything else fails with the byte offset of the bad character.
+class Base64Stream {
+public:
+    static bool encode(std::istream& in, std::ostream& out, const Base64Codec::Options& options, std::string& error);
+    static bool decode(std::istream& in, std::ostream& out, const Base64Codec::Options& options, std::string& error);
+
+private:
+    static const size_t BLOCK_SIZE = 1 << 20;
+};
\ No newline at end of file
@@ -0,0 +1,361 @@
+#include "Batch.h"
+#include "Daemon.h"
+#include "KeyCache.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <vector>
+
+namespace {
+    struct Job {
+        size_t line = 0;
+        std::string op;
+        std::string input;
+        std::string output;
+        bool writesOutput = false;  // hash and identify write their result to output here
+        Daemon::Request request;
+        std::string error;          // set when the line itself is invalid
+    };
+
+    std::vector<std::string> splitFields(const std::string& line) {
+        std::vector<std::string> fields;
+        if (line.find('\t') != std::string::npos) {
+            std::stringstream stream(line);
+            std::string field;
+            while (std::getline(stream, field, '\t')) {
+                fields.push_back(field);
+            }
+        }
+        else {
+            std::istringstream stream(line);
+            std::string field;
+            while (stream >> field) {
+                fields.push_back(field);
+            }
+        }
+        for (auto& field : fields) {
+            if (field == "-") {
+                field.clear();
+            }
+        }
+        return fields;
+    }
+
+    std::vector<std::string> splitList(const std::string& value) {
+        std::vector<std::string> items;
+        std::stringstream stream(value);
+        std::string item;
+        while (std::getline(stream, item, ',')) {
+            std::transform(item.begin(), item.end(), item.begin(),
+                [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+            if (!item.empty()) {
+                items.push_back(item);
+            }
+        }
+        return items;
+    }
+
+    bool parseHashAlgorithms(const std::string& algorithm, uint8_t& flags) {
+        for (const auto& name : splitList(algorithm)) {
+            if (name == "md5") {
+                flags |= Daemon::MD5_FLAG;
+            }
+            else if (name == "sha1" || name == "rc2") {
+                flags |= Daemon::SHA1_FLAG;
+            }
+            else if (name == "sha256") {
+                flags |= Daemon::SHA256_FLAG;
+            }
+            else if (name == "all") {
+                flags |= Daemon::MD5_FLAG | Daemon::SHA1_FLAG | Daemon::SHA256_FLAG;
+            }
+            else {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool parseBase64Options(const std::string& algorithm, bool encoding, uint8_t& flags) {
+        std::vector<std::string> names = splitList(algorithm);
+        if (names.empty() || names[0] != "base64") {
+            return false;
+        }
+        for (size_t i = 1; i < names.size(); ++i) {
+            if (names[i] == "url") {
+                flags |= Daemon::URL_FLAG;
+            }
+            else if (names[i] == "nowrap" && encoding) {
+                flags |= Daemon::NOWRAP_FLAG;
+            }
+            else {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Turns one job line into a request; problems go into job.error.
+    void parseJob(const std::string& line, const Batch::Options& options, Job& job) {
+        std::vector<std::string> fields = splitFields(line);
+        if (fields.size() < 3 || fields.size() > 5 || fields[2].empty()) {
+            job.error = "Expected: operation algorithm input [output] [key]";
+            return;
+        }
+        fields.resize(5);
+        job.op = fields[0];
+        job.input = fields[2];
+        job.output = fields[3];
+        const std::string& algorithm = fields[1];
+        std::string keyPath = fields[4].empty() ? options.defaultKeyPath : fields[4];
+        Daemon::Request& request = job.request;
+
+        if (job.op == "encrypt" || job.op == "decrypt") {
+            bool encrypting = job.op == "encrypt";
+            request.op = encrypting ? Daemon::ENCRYPT_OP : Daemon::DECRYPT_OP;
+            if (algorithm == "aes128") {
+                request.flags |= Daemon::AES128_FLAG;
+            }
+            else if (algorithm != "aes256") {
+                job.error = "Invalid algorithm for " + job.op + ": " + algorithm + " (aes128 or aes256)";
+                return;
+            }
+            if (keyPath.empty()) {
+                job.error = "No key provided and no default key set.";
+                return;
+            }
+            if (job.output.empty() && options.defaultOutputPath) {
+                job.output = options.defaultOutputPath(job.input, encrypting);
+            }
+            if (job.output.empty()) {
+                job.error = "No output path.";
+                return;
+            }
+            request.fields = { keyPath, job.input, job.output };
+            return;
+        }
+
+        if (job.op == "hash") {
+            request.op = Daemon::HASH_OP;
+            if (!parseHashAlgorithms(algorithm, request.flags)) {
+                job.error = "Invalid algorithm for hash: " + algorithm + " (md5, sha1, sha256 or all)";
+                return;
+            }
+        }
+        else if (job.op == "encode" || job.op == "decode") {
+            bool encoding = job.op == "encode";
+            request.op = encoding ? Daemon::ENCODE_OP : Daemon::DECODE_OP;
+            if (!parseBase64Options(algorithm, encoding, request.flags)) {
+                job.error = "Invalid algorithm for " + job.op + ": " + algorithm +
+                    (encoding ? " (base64[,url][,nowrap])" : " (base64[,url])");
+                return;
+            }
+            if (!encoding && job.output.empty()) {
+                job.error = "decode needs an output path.";
+                return;
+            }
+        }
+        else if (job.op == "identify") {
+            request.op = Daemon::IDENTIFY_OP;
+        }
+        else {
+            job.error = "Unknown operation: " + job.op;
+            return;
+        }
+        request.fields = { job.input };
+        if (!job.output.empty()) {
+            if (request.op == Daemon::HASH_OP || request.op == Daemon::IDENTIFY_OP) {
+                job.writesOutput = true;
+            }
+            else {
+                request.fields.push_back(job.output);
+            }
+        }
+    }
+
+    bool writeFile(const std::string& path, const std::string& data, std::string& error) {
+        std::ofstream file(path, std::ios::binary);
+        if (!file.is_open()) {
+            error = "Cannot create output file: " + path;
+            return false;
+        }
+        file.write(data.data(), data.size());
+        file.close();
+        if (!file) {
+            error = "Failed to write output file: " + path;
+            std::remove(path.c_str());
+            return false;
+        }
+        return true;
+    }
+
+    // Length of the well-formed UTF-8 sequence starting at text[i], or 0.
+    size_t utf8Length(const std::string& text, size_t i) {
+        uint8_t lead = static_cast<uint8_t>(text[i]);
+        size_t length;
+        uint8_t low = 0x80;
+        uint8_t high = 0xbf;
+        if (lead >= 0xc2 && lead <= 0xdf) {
+            length = 2;
+        }
+        else if (lead >= 0xe0 && lead <= 0xef) {
+            length = 3;
+            low = lead == 0xe0 ? 0xa0 : 0x80;   // no overlong forms
+            high = lead == 0xed ? 0x9f : 0xbf;  // no surrogates
+        }
+        else if (lead >= 0xf0 && lead <= 0xf4) {
+            length = 4;
+            low = lead == 0xf0 ? 0x90 : 0x80;
+            high = lead == 0xf4 ? 0x8f : 0xbf;  // nothing past U+10FFFF
+        }
+        else {
+            return 0;
+        }
+        if (text.size() - i < length) {
+            return 0;
+        }
+        for (size_t k = 1; k < length; ++k) {
+            uint8_t c = static_cast<uint8_t>(text[i + k]);
+            if (c < (k == 1 ? low : 0x80) || c > (k == 1 ? high : 0xbf)) {
+                return 0;
+            }
+        }
+        return length;
+    }
+
+    // Paths need not be UTF-8; a byte that is not part of a valid sequence is
+    // written as \u00XX so every line stays valid JSON.
+    void writeString(std::ostream& out, const std::string& text) {
+        static const char HEX[] = "0123456789abcdef";
+        out << '"';
+        for (size_t i = 0; i < text.size(); ++i) {
+            char c = text[i];
+            uint8_t byte = static_cast<uint8_t>(c);
+            switch (c) {
+            case '"': out << "\\\""; break;
+            case '\\': out << "\\\\"; break;
+            case '\n': out << "\\n"; break;
+            case '\r': out << "\\r"; break;
+            case '\t': out << "\\t"; break;
+            default:
+                if (byte < 0x20 || byte == 0x7f) {
+                    out << "\\u00" << HEX[byte >> 4] << HEX[byte & 0xf];
+                }
+                else if (byte < 0x80) {
+                    out << c;
+                }
+                else if (size_t length = utf8Length(text, i)) {
+                    out.write(text.data() + i, length);
+                    i += length - 1;
+                }
+                else {
+                    out << "\\u00" << HEX[byte >> 4] << HEX[byte & 0xf];
+                }
+            }
+        }
+        out << '"';
+    }
+
+    std::string resultLine(const Job& job, bool ok, const std::string& payload, double seconds) {
+        std::ostringstream line;
+        line << "{\"line\": " << job.line << ", \"op\": ";
+        writeString(line, job.op);
+        line << ", \"input\": ";
+        writeString(line, job.input);
+        if (ok && !job.output.empty()) {
+            line << ", \"output\": ";
+            writeString(line, job.output);
+        }
+        line << ", \"status\": \"" << (ok ? "ok" : "error") << "\"";
+        if (!ok) {
+            line << ", \"error\": ";
+            writeString(line, payload);
+        }
+        else if (job.request.op == Daemon::HASH_OP || job.request.op == Daemon::IDENTIFY_OP ||
+                 (job.request.op == Daemon::ENCODE_OP && job.output.empty())) {
+            line << ", \"result\": ";
+            writeString(line, payload);
+        }
+        line << std::fixed << std::setprecision(6) << ", \"seconds\": " << seconds << "}\n";
+        return line.str();
+    }
+}
+
+bool Batch::run(std::istream& jobs, std::ostream& results, const Options& options, Summary& summary,
+    std::string& error) {
+    auto start = std::chrono::steady_clock::now();
+    size_t threads = std::max<size_t>(1, options.jobs);
+    KeyCache keys;
+    ThreadPool pool(threads, threads * QUEUED_PER_WORKER);
+    std::mutex resultsMutex;
+    summary = Summary();
+
+    auto report = [&](const Job& job, bool ok, const std::string& payload, double seconds) {
+        std::string line = resultLine(job, ok, payload, seconds);
+        std::lock_guard<std::mutex> lock(resultsMutex);
+        results << line;
+        results.flush();
+        if (!ok) {
+            ++summary.failed;
+        }
+    };
+
+    std::string text;
+    size_t lineNumber = 0;
+    while (std::getline(jobs, text)) {
+        ++lineNumber;
+        if (!text.empty() && text.back() == '\r') {
+            text.pop_back();
+        }
+        size_t first = text.find_first_not_of(" \t");
+        if (first == std::string::npos || text[first] == '#') {
+            continue;
+        }
+
+        std::shared_ptr<Job> job = std::make_shared<Job>();
+        job->line = lineNumber;
+        parseJob(text, options, *job);
+        {
+            std::lock_guard<std::mutex> lock(resultsMutex);
+            ++summary.jobs;
+        }
+        if (!job->error.empty()) {
+            report(*job, false, job->error, 0);
+            continue;
+        }
+
+        pool.submit([&keys, &report, job] {
+            auto jobStart = std::chrono::steady_clock::now();
+            std::string payload;
+            std::string jobError;
+            bool ok;
+            try {
+                ok = Daemon::execute(job->request, keys, payload, jobError);
+                if (ok && job->writesOutput) {
+                    ok = writeFile(job->output, payload + "\n", jobError);
+                }
+            }
+            catch (const std::exception& e) {
+                jobError = e.what();
+                ok = false;
+            }
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - jobStart).count();
+            report(*job, ok, ok ? payload : jobError, seconds);
+        });
+    }
+    pool.wait();
+
+    summary.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (!results) {
+        error = "Failed to write results.";
+        return false;
+    }
+    return true;
+}
\ No newline at end of file
@@ -0,0 +1,46 @@
+#pragma once
+#include <string>
+#include <iostream>
+#include <cstddef>
+
+// Runs a list of jobs in one process, on a shared pool with keys cached by
+// path. One job per line, fields separated by tabs (or by spaces when the line
+// has no tab), "-" for an empty field; blank lines and lines starting with '#'
+// are skipped:
+//
+//   operation  algorithm  input  [output]  [key]
+//
+//   encrypt|decrypt  aes128|aes256          output defaults as on the command line
+//   hash             md5,sha1,sha256 or all output, if given, receives the digests too
+//   encode           base64[,url][,nowrap]
+//   decode           base64[,url]           output is required
+//   identify         -
+//
+// Jobs run concurrently, so one job must not read another's output.
+//
+// Every job produces one JSON object on its own line, in the order jobs finish:
+//   {"line": 3, "op": "hash", "input": "a.txt", "status": "ok", "result": "...", "seconds": 0.000412}
+// with "output" for jobs that wrote a file and "error" in place of "result" on failure.
+class Batch {
+public:
+    struct Options {
+        size_t jobs = 1;
+        std::string defaultKeyPath;
+        std::string (*defaultOutputPath)(const std::string& input, bool encrypting) = nullptr;
+    };
+
+    struct Summary {
+        size_t jobs = 0;
+        size_t failed = 0;
+        double seconds = 0;
+    };
+
+    // Jobs start as lines are read, so a pipe can feed work while earlier jobs
+    // run. Returns false only when the results cannot be written.
+    static bool run(std::istream& jobs, std::ostream& results, const Options& options, Summary& summary,
+                    std::string& error);
+
+private:
+    // At most this many jobs per worker wait in the pool while reading continues.
+    static const size_t QUEUED_PER_WORKER = 4;
+};
\ No newline at end of file
@@ -0,0 +1,471 @@
+#include "BatchHasher.h"
+#include "Hasher.h"
+#include "CpuFeatures.h"
+#include <cstring>
+#include <string>
+
+#ifdef ANUCRYPT_X86
+#include <immintrin.h>
+#endif
+
+// The round loops must be unrolled for the message schedule to stay in
+// registers; GCC and Clang only do that at -O2 when asked.
+#if defined(__GNUC__) || defined(__clang__)
+#define ANUCRYPT_UNROLL _Pragma("GCC unroll 64")
+#else
+#define ANUCRYPT_UNROLL
+#endif
+
+namespace {
+#ifdef ANUCRYPT_X86
+    const uint32_t SHA256_IV[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+    };
+
+    const uint32_t SHA256_K[64] = {
+        0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+        0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+        0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+        0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+        0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+        0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+        0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+        0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+    };
+
+    const uint32_t MD5_IV[4] = { 0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476 };
+
+    const uint32_t MD5_K[64] = {
+        0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee, 0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
+        0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be, 0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821,
+        0xf61e2562, 0xc040b340, 0x265e5a51, 0xe9b6c7aa, 0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+        0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed, 0xa9e3e905, 0xfcefa3f8, 0x676f02d9, 0x8d2a4c8a,
+        0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c, 0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70,
+        0x289b7ec6, 0xeaa127fa, 0xd4ef3085, 0x04881d05, 0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+        0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039, 0x655b59c3, 0x8f0ccc92, 0xffeff47d, 0x85845dd1,
+        0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1, 0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391
+    };
+
+    const int MD5_SHIFT[64] = {
+        7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22,
+        5, 9, 14, 20, 5, 9, 14, 20, 5, 9, 14, 20, 5, 9, 14, 20,
+        4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23,
+        6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21
+    };
+
+    // Message word used by MD5 step i.
+    inline int md5Word(int i) {
+        return i < 16 ? i : i < 32 ? (5 * i + 1) & 15 : i < 48 ? (3 * i + 5) & 15 : (7 * i) & 15;
+    }
+
+    // State is laid out word-major: word w of lane l is state[w * lanes + l], and
+    // likewise the block words, so each row loads straight into one register.
+    typedef void (*Kernel)(uint32_t* state, const uint32_t* words);
+
+    struct Layout {
+        size_t stateWords;
+        const uint32_t* iv;
+        size_t digestSize;
+    };
+
+    const Layout SHA256_LAYOUT = { 8, SHA256_IV, 32 };
+    const Layout MD5_LAYOUT = { 4, MD5_IV, 16 };
+
+    struct Lane {
+        const uint8_t* data;
+        uint64_t fullBlocks;
+        uint64_t block;
+        uint64_t blocks;
+        size_t message;
+        bool active;
+        uint8_t tail[128];  // the last partial block, padding and length
+
+        const uint8_t* blockData() const {
+            return block < fullBlocks ? data + block * 64 : tail + (block - fullBlocks) * 64;
+        }
+    };
+
+    // Only used on x86, so the host is little endian.
+    inline uint32_t loadWord(const uint8_t* p, bool bigEndian) {
+        uint32_t value;
+        std::memcpy(&value, p, sizeof(value));
+        return bigEndian
+            ? (value >> 24) | ((value >> 8) & 0xff00) | ((value << 8) & 0xff0000) | (value << 24)
+            : value;
+    }
+
+    inline void storeWord(uint8_t* p, uint32_t value, bool bigEndian) {
+        for (int i = 0; i < 4; ++i) {
+            p[i] = static_cast<uint8_t>(value >> (bigEndian ? 24 - 8 * i : 8 * i));
+        }
+    }
+
+    void startMessage(Lane& lane, const BatchHasher::Message& message, size_t index, bool bigEndian) {
+        const size_t size = message.size;
+        const size_t remainder = size % 64;
+        lane.data = message.data;
+        lane.fullBlocks = size / 64;
+        lane.block = 0;
+        lane.message = index;
+        lane.active = true;
+
+        size_t tailBlocks = remainder + 9 <= 64 ? 1 : 2;
+        std::memset(lane.tail, 0, sizeof(lane.tail));
+        if (remainder > 0) {
+            std::memcpy(lane.tail, message.data + lane.fullBlocks * 64, remainder);
+        }
+        lane.tail[remainder] = 0x80;
+        uint64_t bits = static_cast<uint64_t>(size) * 8;
+        uint8_t* length = lane.tail + tailBlocks * 64 - 8;
+        for (int i = 0; i < 8; ++i) {
+            length[i] = static_cast<uint8_t>(bits >> (bigEndian ? 56 - 8 * i : 8 * i));
+        }
+        lane.blocks = lane.fullBlocks + tailBlocks;
+    }
+
+    template <size_t L, bool BigEndian>
+    void runLanes(const Layout& layout, Kernel kernel, const BatchHasher::Message* messages, size_t count,
+        uint8_t* out) {
+        alignas(64) uint32_t state[8 * L];
+        alignas(64) uint32_t words[16 * L];
+        Lane lanes[L];
+        size_t next = 0;
+        size_t active = 0;
+
+        auto refill = [&](size_t l) {
+            lanes[l].active = next < count;
+            if (lanes[l].active) {
+                startMessage(lanes[l], messages[next], next, BigEndian);
+                for (size_t w = 0; w < layout.stateWords; ++w) {
+                    state[w * L + l] = layout.iv[w];
+                }
+                ++next;
+                ++active;
+            }
+        };
+        for (size_t l = 0; l < L; ++l) {
+            refill(l);
+        }
+
+        // Idle lanes hash zeros once the batch runs dry; their results are dropped.
+        while (active > 0) {
+            for (size_t l = 0; l < L; ++l) {
+                if (lanes[l].active) {
+                    const uint8_t* block = lanes[l].blockData();
+                    for (size_t t = 0; t < 16; ++t) {
+                        words[t * L + l] = loadWord(block + 4 * t, BigEndian);
+                    }
+                }
+                else {
+                    for (size_t t = 0; t < 16; ++t) {
+                        words[t * L + l] = 0;
+                    }
+                }
+            }
+
+            kernel(state, words);
+
+            for (size_t l = 0; l < L; ++l) {
+                Lane& lane = lanes[l];
+                if (lane.active && ++lane.block == lane.blocks) {
+                    uint8_t* digest = out + lane.message * layout.digestSize;
+                    for (size_t w = 0; w < layout.stateWords; ++w) {
+                        storeWord(digest + 4 * w, state[w * L + l], BigEndian);
+                    }
+                    --active;
+                    refill(l);
+                }
+            }
+        }
+    }
+
+    // AVX2: eight lanes of 32-bit words.
+    template <int N>
+    ANUCRYPT_TARGET("avx2")
+    inline __m256i rotr8(__m256i x) {
+        return _mm256_or_si256(_mm256_srli_epi32(x, N), _mm256_slli_epi32(x, 32 - N));
+    }
+
+    ANUCRYPT_TARGET("avx2")
+    inline __m256i add8(__m256i a, __m256i b) {
+        return _mm256_add_epi32(a, b);
+    }
+
+    ANUCRYPT_TARGET("avx2")
+    void sha256x8(uint32_t* state, const uint32_t* words) {
+        __m256i w[16];
+        for (int t = 0; t < 16; ++t) {
+            w[t] = _mm256_load_si256(reinterpret_cast<const __m256i*>(words + 8 * t));
+        }
+        __m256i s[8];
+        for (int i = 0; i < 8; ++i) {
+            s[i] = _mm256_load_si256(reinterpret_cast<const __m256i*>(state + 8 * i));
+        }
+        __m256i a = s[0], b = s[1], c = s[2], d = s[3], e = s[4], f = s[5], g = s[6], h = s[7];
+
+        ANUCRYPT_UNROLL
+        for (int t = 0; t < 64; ++t) {
+            if (t >= 16) {
+                __m256i w15 = w[(t - 15) & 15];
+                __m256i w2 = w[(t - 2) & 15];
+                __m256i s0 = _mm256_xor_si256(_mm256_xor_si256(rotr8<7>(w15), rotr8<18>(w15)), _mm256_srli_epi32(w15, 3));
+                __m256i s1 = _mm256_xor_si256(_mm256_xor_si256(rotr8<17>(w2), rotr8<19>(w2)), _mm256_srli_epi32(w2, 10));
+                w[t & 15] = add8(add8(w[t & 15], s0), add8(w[(t - 7) & 15], s1));
+            }
+            __m256i sigma1 = _mm256_xor_si256(_mm256_xor_si256(rotr8<6>(e), rotr8<11>(e)), rotr8<25>(e));
+            __m256i ch = _mm256_xor_si256(_mm256_and_si256(e, f), _mm256_andnot_si256(e, g));
+            __m256i t1 = add8(add8(add8(h, sigma1), add8(ch, _mm256_set1_epi32(static_cast<int>(SHA256_K[t])))), w[t & 15]);
+            __m256i sigma0 = _mm256_xor_si256(_mm256_xor_si256(rotr8<2>(a), rotr8<13>(a)), rotr8<22>(a));
+            __m256i maj = _mm256_or_si256(_mm256_and_si256(a, b), _mm256_and_si256(c, _mm256_or_si256(a, b)));
+            h = g;
+            g = f;
+            f = e;
+            e = add8(d, t1);
+            d = c;
+            c = b;
+            b = a;
+            a = add8(t1, add8(sigma0, maj));
+        }
+
+        __m256i result[8] = { a, b, c, d, e, f, g, h };
+        for (int i = 0; i < 8; ++i) {
+            _mm256_store_si256(reinterpret_cast<__m256i*>(state + 8 * i), add8(s[i], result[i]));
+        }
+    }
+
+    ANUCRYPT_TARGET("avx2")
+    void md5x8(uint32_t* state, const uint32_t* words) {
+        __m256i m[16];
+        for (int t = 0; t < 16; ++t) {
+            m[t] = _mm256_load_si256(reinterpret_cast<const __m256i*>(words + 8 * t));
+        }
+        const __m256i ones = _mm256_set1_epi32(-1);
+        __m256i a0 = _mm256_load_si256(reinterpret_cast<const __m256i*>(state));
+        __m256i b0 = _mm256_load_si256(reinterpret_cast<const __m256i*>(state + 8));
+        __m256i c0 = _mm256_load_si256(reinterpret_cast<const __m256i*>(state + 16));
+        __m256i d0 = _mm256_load_si256(reinterpret_cast<const __m256i*>(state + 24));
+        __m256i a = a0, b = b0, c = c0, d = d0;
+
+        ANUCRYPT_UNROLL
+        for (int i = 0; i < 64; ++i) {
+            __m256i f;
+            if (i < 16) {
+                f = _mm256_or_si256(_mm256_and_si256(b, c), _mm256_andnot_si256(b, d));
+            }
+            else if (i < 32) {
+                f = _mm256_or_si256(_mm256_and_si256(d, b), _mm256_andnot_si256(d, c));
+            }
+            else if (i < 48) {
+                f = _mm256_xor_si256(_mm256_xor_si256(b, c), d);
+            }
+            else {
+                f = _mm256_xor_si256(c, _mm256_or_si256(b, _mm256_xor_si256(d, ones)));
+            }
+            __m256i sum = add8(add8(a, f), add8(_mm256_set1_epi32(static_cast<int>(MD5_K[i])), m[md5Word(i)]));
+            __m128i left = _mm_cvtsi32_si128(MD5_SHIFT[i]);
+            __m128i right = _mm_cvtsi32_si128(32 - MD5_SHIFT[i]);
+            __m256i rotated = _mm256_or_si256(_mm256_sll_epi32(sum, left), _mm256_srl_epi32(sum, right));
+            a = d;
+            d = c;
+            c = b;
+            b = add8(b, rotated);
+        }
+
+        _mm256_store_si256(reinterpret_cast<__m256i*>(state), add8(a0, a));
+        _mm256_store_si256(reinterpret_cast<__m256i*>(state + 8), add8(b0, b));
+        _mm256_store_si256(reinterpret_cast<__m256i*>(state + 16), add8(c0, c));
+        _mm256_store_si256(reinterpret_cast<__m256i*>(state + 24), add8(d0, d));
+    }
+
+    // AVX-512: sixteen lanes, with native rotates and three-input logic.
+    ANUCRYPT_TARGET("avx512f")
+    inline __m512i add16(__m512i a, __m512i b) {
+        return _mm512_add_epi32(a, b);
+    }
+
+    ANUCRYPT_TARGET("avx512f")
+    void sha256x16(uint32_t* state, const uint32_t* words) {
+        __m512i w[16];
+        for (int t = 0; t < 16; ++t) {
+            w[t] = _mm512_load_si512(words + 16 * t);
+        }
+        __m512i s[8];
+        for (int i = 0; i < 8; ++i) {
+            s[i] = _mm512_load_si512(state + 16 * i);
+        }
+        __m512i a = s[0], b = s[1], c = s[2], d = s[3], e = s[4], f = s[5], g = s[6], h = s[7];
+
+        ANUCRYPT_UNROLL
+        for (int t = 0; t < 64; ++t) {
+            if (t >= 16) {
+                __m512i w15 = w[(t - 15) & 15];
+                __m512i w2 = w[(t - 2) & 15];
+                __m512i s0 = _mm512_ternarylogic_epi32(_mm512_ror_epi32(w15, 7), _mm512_ror_epi32(w15, 18),
+                    _mm512_srli_epi32(w15, 3), 0x96);
+                __m512i s1 = _mm512_ternarylogic_epi32(_mm512_ror_epi32(w2, 17), _mm512_ror_epi32(w2, 19),
+                    _mm512_srli_epi32(w2, 10), 0x96);
+                w[t & 15] = add16(add16(w[t & 15], s0), add16(w[(t - 7) & 15], s1));
+            }
+            __m512i sigma1 = _mm512_ternarylogic_epi32(_mm512_ror_epi32(e, 6), _mm512_ror_epi32(e, 11),
+                _mm512_ror_epi32(e, 25), 0x96);
+            __m512i ch = _mm512_ternarylogic_epi32(e, f, g, 0xCA);
+            __m512i t1 = add16(add16(add16(h, sigma1), add16(ch, _mm512_set1_epi32(static_cast<int>(SHA256_K[t])))), w[t & 15]);
+            __m512i sigma0 = _mm512_ternarylogic_epi32(_mm512_ror_epi32(a, 2), _mm512_ror_epi32(a, 13),
+                _mm512_ror_epi32(a, 22), 0x96);
+            __m512i maj = _mm512_ternarylogic_epi32(a, b, c, 0xE8);
+            h = g;
+            g = f;
+            f = e;
+            e = add16(d, t1);
+            d = c;
+            c = b;
+            b = a;
+            a = add16(t1, add16(sigma0, maj));
+        }
+
+        __m512i result[8] = { a, b, c, d, e, f, g, h };
+        for (int i = 0; i < 8; ++i) {
+            _mm512_store_si512(state + 16 * i, add16(s[i], result[i]));
+        }
+    }
+
+    ANUCRYPT_TARGET("avx512f")
+    void md5x16(uint32_t* state, const uint32_t* words) {
+        __m512i m[16];
+        for (int t = 0; t < 16; ++t) {
+            m[t] = _mm512_load_si512(words + 16 * t);
+        }
+        __m512i a0 = _mm512_load_si512(state);
+        __m512i b0 = _mm512_load_si512(state + 16);
+        __m512i c0 = _mm512_load_si512(state + 32);
+        __m512i d0 = _mm512_load_si512(state + 48);
+        __m512i a = a0, b = b0, c = c0, d = d0;
+
+        ANUCRYPT_UNROLL
+        for (int i = 0; i < 64; ++i) {
+            // Truth tables of F, G, H and I over (b, c, d).
+            __m512i f;
+            if (i < 16) {
+                f = _mm512_ternarylogic_epi32(b, c, d, 0xCA);
+            }
+            else if (i < 32) {
+                f = _mm512_ternarylogic_epi32(b, c, d, 0xE4);
+            }
+            else if (i < 48) {
+                f = _mm512_ternarylogic_epi32(b, c, d, 0x96);
+            }
+            else {
+                f = _mm512_ternarylogic_epi32(b, c, d, 0x39);
+            }
+            __m512i sum = add16(add16(a, f), add16(_mm512_set1_epi32(static_cast<int>(MD5_K[i])), m[md5Word(i)]));
+            a = d;
+            d = c;
+            c = b;
+            b = add16(b, _mm512_rolv_epi32(sum, _mm512_set1_epi32(MD5_SHIFT[i])));
+        }
+
+        _mm512_store_si512(state, add16(a0, a));
+        _mm512_store_si512(state + 16, add16(b0, b));
+        _mm512_store_si512(state + 32, add16(c0, c));
+        _mm512_store_si512(state + 48, add16(d0, d));
+    }
+
+    bool vectorized(Hashing::Algorithm alg) {
+        return alg == Hashing::SHA256_ALG || alg == Hashing::MD5_ALG;
+    }
+#endif
+}
+
+size_t BatchHasher::lanes(Hashing::Algorithm alg) {
+#ifdef ANUCRYPT_X86
+    static const bool avx512 = CpuFeatures::hasAVX512F();
+    static const bool avx2 = CpuFeatures::hasAVX2();
+    static const bool sha = CpuFeatures::hasSHA();
+    // With SHA extensions one message at a time beats eight AVX2 lanes.
+    if (alg == Hashing::SHA256_ALG && sha && !avx512) {
+        return 1;
+    }
+    if (vectorized(alg)) {
+        return avx512 ? 16 : avx2 ? 8 : 1;
+    }
+#endif
+    return 1;
+}
+
+void BatchHasher::hash(Hashing::Algorithm alg, const Message* messages, size_t count, uint8_t* out) {
+    const size_t laneCount = lanes(alg);
+#ifdef ANUCRYPT_X86
+    // A single message gains nothing from idle lanes.
+    if (laneCount > 1 && count > 1) {
+        if (alg == Hashing::SHA256_ALG) {
+            laneCount == 16
+                ? runLanes<16, true>(SHA256_LAYOUT, sha256x16, messages, count, out)
+                : runLanes<8, true>(SHA256_LAYOUT, sha256x8, messages, count, out);
+        }
+        else {
+            laneCount == 16
+                ? runLanes<16, false>(MD5_LAYOUT, md5x16, messages, count, out)
+                : runLanes<8, false>(MD5_LAYOUT, md5x8, messages, count, out);
+        }
+        return;
+    }
+#endif
+
+    Hasher hasher(alg);
+    const size_t digestSize = Hasher::digestSize(alg);
+    for (size_t i = 0; i < count; ++i) {
+        hasher.init();
+        hasher.update(messages[i].data, messages[i].size);
+        Digest digest = hasher.final();
+        std::memcpy(out + i * digestSize, digest.data(), digestSize);
+    }
+}
+
+void BatchHasher::hashLines(const uint8_t* data, size_t size, const std::vector<Hashing::Algorithm>& algs,
+    std::ostream& out) {
+    std::vector<Message> lines;
+    std::vector<std::vector<uint8_t>> digests(algs.size());
+    std::string buffer;
+    char hex[Digest::HEX_CAPACITY];
+
+    auto flushBatch = [&] {
+        for (size_t a = 0; a < algs.size(); ++a) {
+            digests[a].resize(lines.size() * Hasher::digestSize(algs[a]));
+            hash(algs[a], lines.data(), lines.size(), digests[a].data());
+        }
+        for (size_t i = 0; i < lines.size(); ++i) {
+            for (size_t a = 0; a < algs.size(); ++a) {
+                const size_t digestSize = Hasher::digestSize(algs[a]);
+                if (algs.size() > 1) {
+                    buffer += a > 0 ? " " : "";
+                    buffer += Hashing::algorithmName(algs[a]);
+                    buffer += '=';
+                }
+                buffer.append(hex, Digest::toHex(digests[a].data() + i * digestSize, digestSize, hex));
+            }
+            buffer += '\n';
+            if (buffer.size() >= OUTPUT_BUFFER_SIZE) {
+                out.write(buffer.data(), buffer.size());
+                buffer.clear();
+            }
+        }
+        lines.clear();
+    };
+
+    size_t start = 0;
+    while (start < size) {
+        const uint8_t* newline = static_cast<const uint8_t*>(std::memchr(data + start, '\n', size - start));
+        size_t end = newline ? static_cast<size_t>(newline - data) : size;
+        size_t length = end - start;
+        if (length > 0 && data[end - 1] == '\r') {
+            --length;
+        }
+        lines.push_back(Message{ data + start, length });
+        if (lines.size() == LINE_BATCH) {
+            flushBatch();
+        }
+        start = end + 1;
+    }
+    flushBatch();
+    out.write(buffer.data(), buffer.size());
+}
\ No newline at end of file
@@ -0,0 +1,35 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <iostream>
+#include <vector>
+#include "Hashing.h"
+
+// Hashes many short, independent messages at once. SHA-256 and MD5 run one
+// message per SIMD lane (8 with AVX2, 16 with AVX-512), so a block of every
+// lane is compressed per pass; lanes pick up the next message as soon as theirs
+// is done. SHA-1, CPUs without AVX2, and SHA-256 on CPUs with SHA extensions
+// but no AVX-512 fall back to one reused Hasher.
+class BatchHasher {
+public:
+    struct Message {
+        const uint8_t* data;
+        size_t size;
+    };
+
+    // Writes count digests of Hasher::digestSize(alg) bytes back to back into
+    // out, in the order of messages.
+    static void hash(Hashing::Algorithm alg, const Message* messages, size_t count, uint8_t* out);
+
+    // Lanes hash() uses for alg on this CPU; 1 means the scalar path.
+    static size_t lanes(Hashing::Algorithm alg);
+
+    // One output line per input line (without its "\n" or "\r\n"): the hex
+    // digest, or "MD5=... SHA256=..." when several algorithms are selected.
+    static void hashLines(const uint8_t* data, size_t size, const std::vector<Hashing::Algorithm>& algs,
+                          std::ostream& out);
+
+private:
+    static const size_t LINE_BATCH = 4096;
+    static const size_t OUTPUT_BUFFER_SIZE = 64 * 1024;
+};
\ No newline at end of file
@@ -0,0 +1,375 @@
+#include "Benchmark.h"
+#include "Base64Codec.h"
+#include "CpuFeatures.h"
+#include "CryptoBackend.h"
+#include "Hasher.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <iomanip>
+#include <memory>
+#include <thread>
+#ifdef ANUCRYPT_X86
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#endif
+
+namespace {
+    // One thread's state for a primitive; run() processes the whole buffer once.
+    class Workload {
+    public:
+        virtual ~Workload() {}
+        virtual bool run() = 0;
+    };
+
+    typedef std::function<std::unique_ptr<Workload>(size_t size)> WorkloadFactory;
+
+    void fillPattern(uint8_t* data, size_t size) {
+        uint32_t state = 0x9E3779B9u;
+        for (size_t i = 0; i < size; ++i) {
+            state = state * 1664525u + 1013904223u;
+            data[i] = static_cast<uint8_t>(state >> 24);
+        }
+    }
+
+    class GcmEncrypt : public Workload {
+    public:
+        GcmEncrypt(size_t keySize, size_t size) : m_plaintext(size), m_ciphertext(size) {
+            std::vector<uint8_t> key(keySize, 0x42);
+            std::fill(m_nonce, m_nonce + sizeof(m_nonce), static_cast<uint8_t>(0x24));
+            fillPattern(m_plaintext.data(), size);
+            m_enc = CryptoBackend::current(CryptoBackend::GCM_PRIMITIVE).newGcm();
+            m_enc->setKey(key.data(), key.size());
+        }
+
+        bool run() override {
+            m_enc->seal(m_nonce, sizeof(m_nonce), nullptr, 0, m_plaintext.data(), m_plaintext.size(),
+                m_ciphertext.data(), m_tag, sizeof(m_tag));
+            return true;
+        }
+
+    private:
+        std::unique_ptr<GcmCipher> m_enc;
+        std::vector<uint8_t> m_plaintext;
+        std::vector<uint8_t> m_ciphertext;
+        uint8_t m_nonce[12];
+        uint8_t m_tag[16];
+    };
+
+    class GcmDecrypt : public Workload {
+    public:
+        GcmDecrypt(size_t keySize, size_t size) : m_plaintext(size), m_ciphertext(size) {
+            std::vector<uint8_t> key(keySize, 0x42);
+            std::fill(m_nonce, m_nonce + sizeof(m_nonce), static_cast<uint8_t>(0x24));
+            fillPattern(m_plaintext.data(), size);
+
+            m_dec = CryptoBackend::current(CryptoBackend::GCM_PRIMITIVE).newGcm();
+            m_dec->setKey(key.data(), key.size());
+            m_dec->seal(m_nonce, sizeof(m_nonce), nullptr, 0, m_plaintext.data(), m_plaintext.size(),
+                m_ciphertext.data(), m_tag, sizeof(m_tag));
+        }
+
+        bool run() override {
+            return m_dec->open(m_nonce, sizeof(m_nonce), nullptr, 0, m_ciphertext.data(), m_ciphertext.size(),
+                m_tag, sizeof(m_tag), m_plaintext.data());
+        }
+
+    private:
+        std::unique_ptr<GcmCipher> m_dec;
+        std::vector<uint8_t> m_plaintext;
+        std::vector<uint8_t> m_ciphertext;
+        uint8_t m_nonce[12];
+        uint8_t m_tag[16];
+    };
+
+    class HashWorkload : public Workload {
+    public:
+        HashWorkload(Hashing::Algorithm alg, size_t size) : m_hasher(alg), m_data(size) {
+            fillPattern(m_data.data(), size);
+        }
+
+        bool run() override {
+            m_hasher.update(m_data.data(), m_data.size());
+            m_digest = m_hasher.final();
+            return true;
+        }
+
+    private:
+        Hasher m_hasher;
+        std::vector<uint8_t> m_data;
+        Digest m_digest;
+    };
+
+    class Base64Encode : public Workload {
+    public:
+        explicit Base64Encode(size_t size) : m_data(size), m_encoded(Base64Codec::encodedSize(size, m_options)) {
+            fillPattern(m_data.data(), size);
+        }
+
+        bool run() override {
+            Base64Codec::encode(m_data.data(), m_data.size(), m_encoded.data(), m_options);
+            return true;
+        }
+
+    private:
+        Base64Codec::Options m_options;
+        std::vector<uint8_t> m_data;
+        std::vector<char> m_encoded;
+    };
+
+    // Measured per decoded byte so the figures line up with encoding.
+    class Base64Decode : public Workload {
+    public:
+        explicit Base64Decode(size_t size) : m_decoded(size + 2) {
+            std::vector<uint8_t> data(size);
+            fillPattern(data.data(), size);
+            m_encoded = Base64Codec::encode(data.data(), data.size(), m_options);
+        }
+
+        bool run() override {
+            Base64Codec::decode(m_encoded.data(), m_encoded.size(), m_decoded.data(), m_options);
+            return true;
+        }
+
+    private:
+        Base64Codec::Options m_options;
+        std::string m_encoded;
+        std::vector<uint8_t> m_decoded;
+    };
+
+    struct Primitive {
+        const char* name;
+        WorkloadFactory make;
+    };
+
+    const std::vector<Primitive>& allPrimitives() {
+        static const std::vector<Primitive> list = {
+            { "aes128-gcm-encrypt", [](size_t size) { return std::unique_ptr<Workload>(new GcmEncrypt(16, size)); } },
+            { "aes128-gcm-decrypt", [](size_t size) { return std::unique_ptr<Workload>(new GcmDecrypt(16, size)); } },
+            { "aes256-gcm-encrypt", [](size_t size) { return std::unique_ptr<Workload>(new GcmEncrypt(32, size)); } },
+            { "aes256-gcm-decrypt", [](size_t size) { return std::unique_ptr<Workload>(new GcmDecrypt(32, size)); } },
+            { "md5", [](size_t size) { return std::unique_ptr<Workload>(new HashWorkload(Hashing::MD5_ALG, size)); } },
+            { "sha1", [](size_t size) { return std::unique_ptr<Workload>(new HashWorkload(Hashing::SHA1_ALG, size)); } },
+            { "sha256", [](size_t size) { return std::unique_ptr<Workload>(new HashWorkload(Hashing::SHA256_ALG, size)); } },
+            { "base64-encode", [](size_t size) { return std::unique_ptr<Workload>(new Base64Encode(size)); } },
+            { "base64-decode", [](size_t size) { return std::unique_ptr<Workload>(new Base64Decode(size)); } },
+        };
+        return list;
+    }
+
+    uint64_t timestamp() {
+#ifdef ANUCRYPT_X86
+        return __rdtsc();
+#else
+        return 0;
+#endif
+    }
+
+    // Times threadCount threads, each running its own workload until the
+    // deadline. Workloads are built before the clock starts.
+    bool measure(const Primitive& primitive, size_t size, size_t threadCount, double seconds,
+        Benchmark::Result& result, std::string& error) {
+        std::atomic<size_t> ready(0);
+        std::atomic<bool> go(false);
+        std::atomic<bool> failed(false);
+        std::vector<uint64_t> bytes(threadCount, 0);
+        std::chrono::steady_clock::time_point deadline;
+
+        // Check the clock roughly every megabyte, not after every small buffer.
+        const uint64_t batch = std::max<uint64_t>(1, (1 << 20) / std::max<size_t>(1, size));
+
+        std::vector<std::thread> threads;
+        for (size_t t = 0; t < threadCount; ++t) {
+            threads.emplace_back([&, t] {
+                std::unique_ptr<Workload> workload;
+                try {
+                    workload = primitive.make(size);
+                    workload->run();
+                }
+                catch (...) {
+                    failed = true;
+                }
+                ++ready;
+                while (!go) {
+                    std::this_thread::yield();
+                }
+                if (failed) {
+                    return;
+                }
+
+                uint64_t done = 0;
+                do {
+                    for (uint64_t i = 0; i < batch; ++i) {
+                        if (!workload->run()) {
+                            failed = true;
+                            return;
+                        }
+                    }
+                    done += batch;
+                } while (std::chrono::steady_clock::now() < deadline);
+                bytes[t] = done * size;
+            });
+        }
+
+        while (ready < threadCount) {
+            std::this_thread::yield();
+        }
+        auto start = std::chrono::steady_clock::now();
+        uint64_t startTsc = timestamp();
+        deadline = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double>(seconds));
+        go = true;
+
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        uint64_t elapsedTsc = timestamp() - startTsc;
+        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        if (failed) {
+            error = std::string("Benchmark of ") + primitive.name + " failed.";
+            return false;
+        }
+
+        result.primitive = primitive.name;
+        result.size = size;
+        result.threads = threadCount;
+        result.bytes = 0;
+        for (uint64_t count : bytes) {
+            result.bytes += count;
+        }
+        result.seconds = elapsed;
+        result.megabytesPerSecond = elapsed > 0 ? result.bytes / elapsed / 1e6 : 0;
+        result.cyclesPerByte = result.bytes > 0 ? static_cast<double>(elapsedTsc) * threadCount / result.bytes : 0;
+        return true;
+    }
+
+    std::string sizeLabel(size_t size) {
+        if (size >= (1 << 20) && size % (1 << 20) == 0) {
+            return std::to_string(size >> 20) + "M";
+        }
+        if (size >= 1024 && size % 1024 == 0) {
+            return std::to_string(size >> 10) + "K";
+        }
+        return std::to_string(size);
+    }
+}
+
+Benchmark::Options Benchmark::defaultOptions() {
+    Options options;
+    options.sizes = { 64, 1024, 16 * 1024, 256 * 1024, 1 << 20, 16 << 20, 64 << 20 };
+    options.threads.push_back(1);
+    size_t cores = ThreadPool::defaultThreadCount();
+    if (cores > 1) {
+        options.threads.push_back(cores);
+    }
+    return options;
+}
+
+std::vector<std::string> Benchmark::primitives() {
+    std::vector<std::string> names;
+    for (const auto& primitive : allPrimitives()) {
+        names.push_back(primitive.name);
+    }
+    return names;
+}
+
+bool Benchmark::run(const Options& options, std::vector<Result>& results, std::ostream* progress, std::string& error) {
+    const std::vector<std::string> known = primitives();
+    for (const auto& name : options.primitives) {
+        if (std::find(known.begin(), known.end(), name) == known.end()) {
+            error = "Unknown primitive: " + name;
+            return false;
+        }
+    }
+
+    std::vector<const Primitive*> selected;
+    for (const auto& primitive : allPrimitives()) {
+        if (options.primitives.empty() ||
+            std::find(options.primitives.begin(), options.primitives.end(), primitive.name) != options.primitives.end()) {
+            selected.push_back(&primitive);
+        }
+    }
+
+    if (progress) {
+        *progress << std::left << std::setw(20) << "primitive" << std::right << std::setw(8) << "size"
+                  << std::setw(9) << "threads" << std::setw(12) << "MB/s" << std::setw(14) << "cycles/byte" << "\n";
+    }
+
+    for (const Primitive* primitive : selected) {
+        for (size_t threads : options.threads) {
+            for (size_t size : options.sizes) {
+                Result result;
+                if (!measure(*primitive, size, threads, options.seconds, result, error)) {
+                    return false;
+                }
+                results.push_back(result);
+
+                if (progress) {
+                    *progress << std::left << std::setw(20) << result.primitive << std::right << std::setw(8)
+                              << sizeLabel(result.size) << std::setw(9) << result.threads << std::fixed
+                              << std::setprecision(1) << std::setw(12) << result.megabytesPerSecond
+                              << std::setprecision(2) << std::setw(14) << result.cyclesPerByte << std::endl;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+void Benchmark::writeJson(std::ostream& out, const std::vector<Result>& results, const std::string& version) {
+    out << "{\n";
+    out << "  \"version\": \"" << version << "\",\n";
+    out << "  \"cpu\": { \"ssse3\": " << (CpuFeatures::hasSSSE3() ? "true" : "false")
+        << ", \"avx2\": " << (CpuFeatures::hasAVX2() ? "true" : "false") << " },\n";
+    out << "  \"base64\": \"" << Base64Codec::implementationName(Base64Codec::implementation()) << "\",\n";
+    out << "  \"backends\": {";
+    for (int p = 0; p < CryptoBackend::PRIMITIVE_COUNT; ++p) {
+        CryptoBackend::Primitive primitive = static_cast<CryptoBackend::Primitive>(p);
+        out << (p ? ", " : " ") << "\"" << CryptoBackend::primitiveName(primitive) << "\": \""
+            << CryptoBackend::current(primitive).name() << "\"";
+    }
+    out << " },\n";
+    out << "  \"results\": [\n";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const Result& r = results[i];
+        out << "    { \"primitive\": \"" << r.primitive << "\", \"size\": " << r.size
+            << ", \"threads\": " << r.threads << ", \"bytes\": " << r.bytes
+            << std::fixed << std::setprecision(6) << ", \"seconds\": " << r.seconds
+            << std::setprecision(2) << ", \"mb_per_s\": " << r.megabytesPerSecond
+            << ", \"cycles_per_byte\": " << r.cyclesPerByte << " }"
+            << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n";
+    out << "}" << std::endl;
+}
+
+bool Benchmark::parseSize(const std::string& text, size_t& size) {
+    try {
+        size_t pos = 0;
+        unsigned long long value = std::stoull(text, &pos);
+        std::string suffix = text.substr(pos);
+        if (suffix == "K" || suffix == "k") {
+            value <<= 10;
+        }
+        else if (suffix == "M" || suffix == "m") {
+            value <<= 20;
+        }
+        else if (!suffix.empty()) {
+            return false;
+        }
+        if (value == 0) {
+            return false;
+        }
+        size = static_cast<size_t>(value);
+        return true;
+    }
+    catch (const std::exception&) {
+        return false;
+    }
+}
\ No newline at end of file
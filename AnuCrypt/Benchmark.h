@@ -0,0 +1,42 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <iostream>
+#include <cstdint>
+
+// Throughput of each primitive at a range of buffer sizes and thread counts.
+// Every thread repeatedly processes its own buffer for a fixed time; MB/s is
+// the combined rate (1 MB = 10^6 bytes) and cycles/byte is per core, measured
+// with the time-stamp counter where one is available. Ciphers and hashes run
+// on the current CryptoBackend for each.
+class Benchmark {
+public:
+    struct Options {
+        std::vector<size_t> sizes;
+        std::vector<size_t> threads;
+        std::vector<std::string> primitives; // empty runs all of them
+        double seconds = 0.25;               // per measurement
+    };
+
+    struct Result {
+        std::string primitive;
+        size_t size;
+        size_t threads;
+        uint64_t bytes;
+        double seconds;
+        double megabytesPerSecond;
+        double cyclesPerByte;                // 0 without a time-stamp counter
+    };
+
+    static Options defaultOptions();
+    static std::vector<std::string> primitives();
+
+    // Runs every combination, printing a table row per result to progress when
+    // it is not null.
+    static bool run(const Options& options, std::vector<Result>& results, std::ostream* progress, std::string& error);
+
+    static void writeJson(std::ostream& out, const std::vector<Result>& results, const std::string& version);
+
+    // Accepts plain byte counts or K/M suffixes ("64", "16K", "64M").
+    static bool parseSize(const std::string& text, size_t& size);
+};
\ No newline at end of file
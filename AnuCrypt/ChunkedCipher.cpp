@@ -0,0 +1,469 @@
+#include "ChunkedCipher.h"
+#include "FileValidator.h"
+#include "Pipeline.h"
+#include <algorithm>
+
+ChunkedCipher::EncryptContext::EncryptContext()
+    : gcm(CryptoBackend::current(CryptoBackend::GCM_PRIMITIVE).newGcm()),
+      digest(CryptoBackend::current(CryptoBackend::MD5_PRIMITIVE).newHash(Hashing::MD5_ALG)) {
+}
+
+ChunkedCipher::DecryptContext::DecryptContext()
+    : gcm(CryptoBackend::current(CryptoBackend::GCM_PRIMITIVE).newGcm()),
+      digest(CryptoBackend::current(CryptoBackend::MD5_PRIMITIVE).newHash(Hashing::MD5_ALG)) {
+}
+
+bool ChunkedCipher::checkKey(const std::vector<uint8_t>& key, std::string& error) {
+    if (key.size() != 16 && key.size() != 24 && key.size() != 32) {
+        error = "Invalid key length.";
+        return false;
+    }
+    return true;
+}
+
+size_t ChunkedCipher::readFully(std::istream& in, uint8_t* buffer, size_t size) {
+    in.read(reinterpret_cast<char*>(buffer), size);
+    return static_cast<size_t>(in.gcount());
+}
+
+bool ChunkedCipher::encrypt(std::istream& in, std::ostream& out, const std::vector<uint8_t>& key,
+    const CryptFormat::Header& header, std::string& md5, std::string& error) {
+    if (!checkKey(key, error)) {
+        return false;
+    }
+
+    EncryptContext context;
+    context.gcm->setKey(key.data(), key.size());
+    return encrypt(in, out, context, header, md5, error);
+}
+
+void ChunkedCipher::sealRecord(EncryptContext& context, const std::vector<uint8_t>& iv, uint64_t index, bool last,
+    const uint8_t* plaintext, size_t size, uint8_t* record) {
+    uint8_t nonce[CryptFormat::IV_SIZE];
+    uint8_t finalFlag = last ? 1 : 0;
+    CryptFormat::chunkNonce(iv, index, nonce);
+    context.gcm->seal(nonce, sizeof(nonce), &finalFlag, sizeof(finalFlag), plaintext, size,
+        record, record + size, CryptFormat::TAG_SIZE);
+}
+
+bool ChunkedCipher::encrypt(std::istream& in, std::ostream& out, EncryptContext& context,
+    const CryptFormat::Header& header, std::string& md5, std::string& error) {
+    const size_t chunkSize = header.chunkSize;
+    if (context.plaintext.size() < chunkSize) {
+        context.plaintext.resize(chunkSize);
+        context.ciphertext.resize(chunkSize + CryptFormat::TAG_SIZE);
+    }
+    uint8_t* plaintext = context.plaintext.data();
+    uint8_t* ciphertext = context.ciphertext.data();
+
+    HashContext& digest = *context.digest;
+    digest.init(); // a failed file may have left it part way through
+
+    uint64_t index = 0;
+    size_t got = readFully(in, plaintext, chunkSize);
+    while (true) {
+        // A short read is only the end of the input if nothing went wrong.
+        if (in.bad()) {
+            error = "Failed reading input file.";
+            return false;
+        }
+        bool last = got < chunkSize || in.peek() == std::char_traits<char>::eof();
+
+        digest.update(plaintext, got);
+        sealRecord(context, header.iv, index, last, plaintext, got, ciphertext);
+
+        out.write(reinterpret_cast<const char*>(ciphertext), got + CryptFormat::TAG_SIZE);
+        if (!out) {
+            error = "Failed writing output file.";
+            return false;
+        }
+
+        if (last) {
+            break;
+        }
+        ++index;
+        got = readFully(in, plaintext, chunkSize);
+    }
+
+    uint8_t hash[CryptFormat::MD5_SIZE];
+    digest.final(hash);
+    md5 = FileValidator::toHex(hash, sizeof(hash));
+
+    return true;
+}
+
+bool ChunkedCipher::encryptPipelined(std::istream& in, std::ostream& out, EncryptContext& context,
+    const CryptFormat::Header& header, std::string& md5, std::string& error) {
+    const size_t chunkSize = header.chunkSize;
+    context.digest->init();
+
+    bool ok = Pipeline::run(chunkSize, chunkSize + CryptFormat::TAG_SIZE, Pipeline::DEFAULT_DEPTH,
+        [&](Pipeline::Block& block, std::string& err) {
+            block.size = readFully(in, block.data.data(), chunkSize);
+            if (in.bad()) {
+                err = "Failed reading input file.";
+                return false;
+            }
+            block.last = block.size < chunkSize || in.peek() == std::char_traits<char>::eof();
+            return true;
+        },
+        [&](const Pipeline::Block& input, Pipeline::Block& output, std::string&) {
+            context.digest->update(input.data.data(), input.size);
+            sealRecord(context, header.iv, input.index, input.last, input.data.data(), input.size,
+                output.data.data());
+            output.size = input.size + CryptFormat::TAG_SIZE;
+            return true;
+        },
+        [&](const Pipeline::Block& block, std::string& err) {
+            out.write(reinterpret_cast<const char*>(block.data.data()), block.size);
+            if (!out) {
+                err = "Failed writing output file.";
+                return false;
+            }
+            return true;
+        }, error);
+    if (!ok) {
+        return false;
+    }
+
+    uint8_t hash[CryptFormat::MD5_SIZE];
+    context.digest->final(hash);
+    md5 = FileValidator::toHex(hash, sizeof(hash));
+    return true;
+}
+
+bool ChunkedCipher::decryptPipelined(std::istream& in, std::ostream& out, DecryptContext& context,
+    const CryptFormat::Header& header, std::string& md5, std::string& error) {
+    const size_t recordSize = header.chunkSize + CryptFormat::TAG_SIZE;
+    context.digest->init();
+
+    bool ok = Pipeline::run(recordSize, header.chunkSize, Pipeline::DEFAULT_DEPTH,
+        [&](Pipeline::Block& block, std::string& err) {
+            block.size = readFully(in, block.data.data(), recordSize);
+            if (block.size < CryptFormat::TAG_SIZE) {
+                err = "Encrypted file is truncated.";
+                return false;
+            }
+            block.last = block.size < recordSize || in.peek() == std::char_traits<char>::eof();
+            return true;
+        },
+        [&](const Pipeline::Block& input, Pipeline::Block& output, std::string& err) {
+            uint8_t nonce[CryptFormat::IV_SIZE];
+            uint8_t finalFlag = input.last ? 1 : 0;
+            size_t dataSize = input.size - CryptFormat::TAG_SIZE;
+            const uint8_t* ciphertext = input.data.data();
+
+            CryptFormat::chunkNonce(header.iv, input.index, nonce);
+            if (!context.gcm->open(nonce, sizeof(nonce), &finalFlag, sizeof(finalFlag), ciphertext, dataSize,
+                ciphertext + dataSize, CryptFormat::TAG_SIZE, output.data.data())) {
+                err = "Authentication failed - invalid key or corrupted file.";
+                return false;
+            }
+            context.digest->update(output.data.data(), dataSize);
+            output.size = dataSize;
+            return true;
+        },
+        [&](const Pipeline::Block& block, std::string& err) {
+            out.write(reinterpret_cast<const char*>(block.data.data()), block.size);
+            if (!out) {
+                err = "Failed writing output file.";
+                return false;
+            }
+            return true;
+        }, error);
+    if (!ok) {
+        return false;
+    }
+
+    uint8_t hash[CryptFormat::MD5_SIZE];
+    context.digest->final(hash);
+    md5 = FileValidator::toHex(hash, sizeof(hash));
+    return true;
+}
+
+bool ChunkedCipher::decrypt(std::istream& in, std::ostream& out, const std::vector<uint8_t>& key,
+    const CryptFormat::Header& header, std::string& md5, std::string& error) {
+    if (!checkKey(key, error)) {
+        return false;
+    }
+
+    DecryptContext context;
+    context.gcm->setKey(key.data(), key.size());
+    return decrypt(in, out, context, header, md5, error);
+}
+
+bool ChunkedCipher::decrypt(std::istream& in, std::ostream& out, DecryptContext& context,
+    const CryptFormat::Header& header, std::string& md5, std::string& error) {
+    const size_t recordSize = header.chunkSize + CryptFormat::TAG_SIZE;
+    if (context.ciphertext.size() < recordSize) {
+        context.ciphertext.resize(recordSize);
+        context.plaintext.resize(header.chunkSize);
+    }
+    uint8_t* ciphertext = context.ciphertext.data();
+    uint8_t* plaintext = context.plaintext.data();
+    uint8_t nonce[CryptFormat::IV_SIZE];
+
+    GcmCipher& dec = *context.gcm;
+    HashContext& digest = *context.digest;
+    digest.init();
+
+    uint64_t index = 0;
+    size_t got = readFully(in, ciphertext, recordSize);
+    while (true) {
+        if (got < CryptFormat::TAG_SIZE) {
+            error = "Encrypted file is truncated.";
+            return false;
+        }
+
+        bool last = got < recordSize || in.peek() == std::char_traits<char>::eof();
+        uint8_t finalFlag = last ? 1 : 0;
+        size_t dataSize = got - CryptFormat::TAG_SIZE;
+
+        CryptFormat::chunkNonce(header.iv, index, nonce);
+        if (!dec.open(nonce, sizeof(nonce), &finalFlag, sizeof(finalFlag), ciphertext, dataSize,
+            ciphertext + dataSize, CryptFormat::TAG_SIZE, plaintext)) {
+            error = "Authentication failed - invalid key or corrupted file.";
+            return false;
+        }
+
+        digest.update(plaintext, dataSize);
+        out.write(reinterpret_cast<const char*>(plaintext), dataSize);
+        if (!out) {
+            error = "Failed writing output file.";
+            return false;
+        }
+
+        if (last) {
+            break;
+        }
+        ++index;
+        got = readFully(in, ciphertext, recordSize);
+    }
+
+    uint8_t hash[CryptFormat::MD5_SIZE];
+    digest.final(hash);
+    md5 = FileValidator::toHex(hash, sizeof(hash));
+
+    return true;
+}
+
+uint64_t ChunkedCipher::recordCount(uint64_t plainSize, uint32_t chunkSize) {
+    // Empty input still gets one (empty) final record.
+    return plainSize == 0 ? 1 : (plainSize + chunkSize - 1) / chunkSize;
+}
+
+uint64_t ChunkedCipher::recordBytes(uint64_t plainSize, uint32_t chunkSize) {
+    return plainSize + recordCount(plainSize, chunkSize) * CryptFormat::TAG_SIZE;
+}
+
+void ChunkedCipher::encryptBuffer(const uint8_t* in, uint64_t size, uint8_t* out, EncryptContext& context,
+    const std::vector<uint8_t>& iv, uint32_t chunkSize, std::string& md5) {
+    const uint64_t records = recordCount(size, chunkSize);
+    context.digest->init();
+
+    for (uint64_t index = 0; index < records; ++index) {
+        const uint64_t offset = index * chunkSize;
+        size_t dataSize = static_cast<size_t>(std::min<uint64_t>(chunkSize, size - offset));
+        context.digest->update(in + offset, dataSize);
+        sealRecord(context, iv, index, index + 1 == records, in + offset, dataSize,
+            out + index * (chunkSize + CryptFormat::TAG_SIZE));
+    }
+
+    uint8_t hash[CryptFormat::MD5_SIZE];
+    context.digest->final(hash);
+    md5 = FileValidator::toHex(hash, sizeof(hash));
+}
+
+bool ChunkedCipher::decryptBuffer(const uint8_t* in, uint64_t recordBytes, uint8_t* out, DecryptContext& context,
+    const std::vector<uint8_t>& iv, uint32_t chunkSize, std::string& md5, std::string& error) {
+    uint64_t size;
+    if (!plainSize(recordBytes, chunkSize, size)) {
+        error = "Encrypted file is truncated.";
+        return false;
+    }
+
+    const uint64_t records = recordCount(size, chunkSize);
+    uint8_t nonce[CryptFormat::IV_SIZE];
+    context.digest->init();
+
+    for (uint64_t index = 0; index < records; ++index) {
+        const uint64_t offset = index * chunkSize;
+        const uint8_t* ciphertext = in + index * (chunkSize + CryptFormat::TAG_SIZE);
+        size_t dataSize = static_cast<size_t>(std::min<uint64_t>(chunkSize, size - offset));
+        uint8_t finalFlag = index + 1 == records ? 1 : 0;
+
+        CryptFormat::chunkNonce(iv, index, nonce);
+        if (!context.gcm->open(nonce, sizeof(nonce), &finalFlag, sizeof(finalFlag), ciphertext, dataSize,
+            ciphertext + dataSize, CryptFormat::TAG_SIZE, out + offset)) {
+            error = "Authentication failed - invalid key or corrupted file.";
+            return false;
+        }
+        context.digest->update(out + offset, dataSize);
+    }
+
+    uint8_t hash[CryptFormat::MD5_SIZE];
+    context.digest->final(hash);
+    md5 = FileValidator::toHex(hash, sizeof(hash));
+    return true;
+}
+
+bool ChunkedCipher::decryptSized(std::istream& in, std::ostream& out, DecryptContext& context,
+    const std::vector<uint8_t>& iv, uint32_t chunkSize, uint64_t plainSize, std::string& error) {
+    const size_t recordSize = chunkSize + CryptFormat::TAG_SIZE;
+    if (context.ciphertext.size() < recordSize) {
+        context.ciphertext.resize(recordSize);
+        context.plaintext.resize(chunkSize);
+    }
+    uint8_t* ciphertext = context.ciphertext.data();
+    uint8_t* plaintext = context.plaintext.data();
+    uint8_t nonce[CryptFormat::IV_SIZE];
+
+    const uint64_t records = recordCount(plainSize, chunkSize);
+    uint64_t remaining = plainSize;
+    for (uint64_t index = 0; index < records; ++index) {
+        size_t dataSize = remaining < chunkSize ? static_cast<size_t>(remaining) : chunkSize;
+        if (readFully(in, ciphertext, dataSize + CryptFormat::TAG_SIZE) != dataSize + CryptFormat::TAG_SIZE) {
+            error = "Encrypted file is truncated.";
+            return false;
+        }
+
+        uint8_t finalFlag = index + 1 == records ? 1 : 0;
+        CryptFormat::chunkNonce(iv, index, nonce);
+        if (!context.gcm->open(nonce, sizeof(nonce), &finalFlag, sizeof(finalFlag), ciphertext, dataSize,
+            ciphertext + dataSize, CryptFormat::TAG_SIZE, plaintext)) {
+            error = "Authentication failed - invalid key or corrupted file.";
+            return false;
+        }
+
+        out.write(reinterpret_cast<const char*>(plaintext), dataSize);
+        if (!out) {
+            error = "Failed writing output file.";
+            return false;
+        }
+        remaining -= dataSize;
+    }
+
+    return true;
+}
+
+bool ChunkedCipher::plainSize(uint64_t recordBytes, uint32_t chunkSize, uint64_t& size) {
+    // Every record but the last is full and the last holds at least its tag.
+    const uint64_t recordSize = static_cast<uint64_t>(chunkSize) + CryptFormat::TAG_SIZE;
+    uint64_t records = (recordBytes + recordSize - 1) / recordSize;
+    if (records == 0 || recordBytes - (records - 1) * recordSize < CryptFormat::TAG_SIZE) {
+        return false;
+    }
+    size = recordBytes - records * CryptFormat::TAG_SIZE;
+    return true;
+}
+
+bool ChunkedCipher::decryptRange(std::istream& in, std::ostream& out, DecryptContext& context,
+    const CryptFormat::Header& header, uint64_t dataStart, uint64_t recordBytes, uint64_t offset,
+    uint64_t length, std::string& error) {
+    uint64_t totalSize;
+    if (!plainSize(recordBytes, header.chunkSize, totalSize)) {
+        error = "Encrypted file is truncated.";
+        return false;
+    }
+    if (offset > totalSize || length > totalSize - offset) {
+        error = "Range is past the end of the data (" + std::to_string(totalSize) + " bytes).";
+        return false;
+    }
+    if (length == 0) {
+        return true;
+    }
+
+    const uint64_t chunkSize = header.chunkSize;
+    const uint64_t recordSize = chunkSize + CryptFormat::TAG_SIZE;
+    const uint64_t records = recordCount(totalSize, header.chunkSize);
+    const uint64_t first = offset / chunkSize;
+    const uint64_t last = (offset + length - 1) / chunkSize;
+
+    if (context.ciphertext.size() < recordSize) {
+        context.ciphertext.resize(static_cast<size_t>(recordSize));
+        context.plaintext.resize(header.chunkSize);
+    }
+    uint8_t* ciphertext = context.ciphertext.data();
+    uint8_t* plaintext = context.plaintext.data();
+    uint8_t nonce[CryptFormat::IV_SIZE];
+
+    in.clear();
+    in.seekg(static_cast<std::streamoff>(dataStart + first * recordSize));
+    for (uint64_t index = first; index <= last; ++index) {
+        size_t dataSize = static_cast<size_t>(std::min(chunkSize, totalSize - index * chunkSize));
+        if (readFully(in, ciphertext, dataSize + CryptFormat::TAG_SIZE) != dataSize + CryptFormat::TAG_SIZE) {
+            error = "Encrypted file is truncated.";
+            return false;
+        }
+
+        uint8_t finalFlag = index + 1 == records ? 1 : 0;
+        CryptFormat::chunkNonce(header.iv, index, nonce);
+        if (!context.gcm->open(nonce, sizeof(nonce), &finalFlag, sizeof(finalFlag), ciphertext, dataSize,
+            ciphertext + dataSize, CryptFormat::TAG_SIZE, plaintext)) {
+            error = "Authentication failed - invalid key or corrupted file.";
+            return false;
+        }
+
+        uint64_t chunkStart = index * chunkSize;
+        uint64_t from = std::max(offset, chunkStart) - chunkStart;
+        uint64_t to = std::min(offset + length, chunkStart + dataSize) - chunkStart;
+        out.write(reinterpret_cast<const char*>(plaintext + from), static_cast<std::streamsize>(to - from));
+        if (!out) {
+            error = "Failed writing output file.";
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool ChunkedCipher::decryptLegacy(std::istream& in, std::ostream& out, const std::vector<uint8_t>& key,
+    const CryptFormat::Header& header, uint64_t ciphertextSize, std::string& md5, std::string& error) {
+    if (!checkKey(key, error)) {
+        return false;
+    }
+
+    if (ciphertextSize < CryptFormat::TAG_SIZE) {
+        error = "Encrypted file is truncated.";
+        return false;
+    }
+
+    std::vector<uint8_t> ciphertext(LEGACY_BLOCK_SIZE);
+    std::vector<uint8_t> plaintext(LEGACY_BLOCK_SIZE);
+
+    std::unique_ptr<GcmCipher> dec = CryptoBackend::current(CryptoBackend::GCM_PRIMITIVE).newGcm();
+    dec->setKey(key.data(), key.size());
+    dec->start(header.iv.data(), header.iv.size());
+    std::unique_ptr<HashContext> digest = CryptoBackend::current(CryptoBackend::MD5_PRIMITIVE).newHash(Hashing::MD5_ALG);
+
+    uint64_t remaining = ciphertextSize - CryptFormat::TAG_SIZE;
+    while (remaining > 0) {
+        size_t want = remaining < LEGACY_BLOCK_SIZE ? static_cast<size_t>(remaining) : LEGACY_BLOCK_SIZE;
+        size_t got = readFully(in, ciphertext.data(), want);
+        if (got != want) {
+            error = "Encrypted file is truncated.";
+            return false;
+        }
+
+        dec->decrypt(ciphertext.data(), got, plaintext.data());
+        digest->update(plaintext.data(), got);
+        out.write(reinterpret_cast<const char*>(plaintext.data()), got);
+        if (!out) {
+            error = "Failed writing output file.";
+            return false;
+        }
+        remaining -= got;
+    }
+
+    uint8_t tag[CryptFormat::TAG_SIZE];
+    if (readFully(in, tag, sizeof(tag)) != sizeof(tag) || !dec->verify(tag, sizeof(tag))) {
+        error = "Authentication failed - invalid key or corrupted file.";
+        return false;
+    }
+
+    uint8_t hash[CryptFormat::MD5_SIZE];
+    digest->final(hash);
+    md5 = FileValidator::toHex(hash, sizeof(hash));
+
+    return true;
+}
\ No newline at end of file
@@ -0,0 +1,97 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <iostream>
+#include <memory>
+#include "CryptFormat.h"
+#include "CryptoBackend.h"
+
+// Streams data through the chunked GCM format one record at a time, so memory
+// use is bounded by the chunk size regardless of the input length. Plaintext is
+// hashed as it passes through and the MD5 is returned for the header check.
+class ChunkedCipher {
+public:
+    // Keyed cipher, digest and record buffers that can be reused from one file to
+    // the next. The buffers grow to the chunk size on first use. The cipher and
+    // digest come from the backends current when the context is made.
+    struct EncryptContext {
+        EncryptContext();
+
+        std::unique_ptr<GcmCipher> gcm;
+        std::unique_ptr<HashContext> digest;
+        std::vector<uint8_t> plaintext;
+        std::vector<uint8_t> ciphertext;
+    };
+
+    struct DecryptContext {
+        DecryptContext();
+
+        std::unique_ptr<GcmCipher> gcm;
+        std::unique_ptr<HashContext> digest;
+        std::vector<uint8_t> plaintext;
+        std::vector<uint8_t> ciphertext;
+    };
+
+    static bool checkKey(const std::vector<uint8_t>& key, std::string& error);
+
+    // Encrypts one chunk into a record (ciphertext then tag) at `record`, which
+    // must hold size + TAG_SIZE bytes. The context's digest is not touched.
+    static void sealRecord(EncryptContext& context, const std::vector<uint8_t>& iv, uint64_t index, bool last,
+                           const uint8_t* plaintext, size_t size, uint8_t* record);
+
+    static bool encrypt(std::istream& in, std::ostream& out, EncryptContext& context,
+                        const CryptFormat::Header& header, std::string& md5, std::string& error);
+    static bool decrypt(std::istream& in, std::ostream& out, DecryptContext& context,
+                        const CryptFormat::Header& header, std::string& md5, std::string& error);
+
+    // The same formats with reading, crypto and writing on three threads, so a
+    // single file is limited by the slower of the disk and AES-GCM rather than
+    // by both in turn. The context supplies the key and digest only.
+    static bool encryptPipelined(std::istream& in, std::ostream& out, EncryptContext& context,
+                                 const CryptFormat::Header& header, std::string& md5, std::string& error);
+    static bool decryptPipelined(std::istream& in, std::ostream& out, DecryptContext& context,
+                                 const CryptFormat::Header& header, std::string& md5, std::string& error);
+
+    // Records straight between memory buffers. encryptBuffer writes
+    // recordBytes(size) bytes; decryptBuffer writes the plainSize() of its input.
+    static void encryptBuffer(const uint8_t* in, uint64_t size, uint8_t* out, EncryptContext& context,
+                              const std::vector<uint8_t>& iv, uint32_t chunkSize, std::string& md5);
+    static bool decryptBuffer(const uint8_t* in, uint64_t recordBytes, uint8_t* out, DecryptContext& context,
+                              const std::vector<uint8_t>& iv, uint32_t chunkSize, std::string& md5,
+                              std::string& error);
+    static uint64_t recordBytes(uint64_t plainSize, uint32_t chunkSize);
+
+    // Decrypts exactly the records holding plainSize bytes, for record runs that
+    // are followed by other data rather than the end of the stream.
+    static bool decryptSized(std::istream& in, std::ostream& out, DecryptContext& context,
+                             const std::vector<uint8_t>& iv, uint32_t chunkSize, uint64_t plainSize,
+                             std::string& error);
+    static uint64_t recordCount(uint64_t plainSize, uint32_t chunkSize);
+
+    // Plaintext length of recordBytes bytes of records; false if that many
+    // bytes cannot be a valid run.
+    static bool plainSize(uint64_t recordBytes, uint32_t chunkSize, uint64_t& size);
+
+    // Records sit at fixed offsets, so the ones covering [offset, offset + length)
+    // can be read and authenticated without touching the rest. `in` must hold
+    // recordBytes bytes of records starting at dataStart.
+    static bool decryptRange(std::istream& in, std::ostream& out, DecryptContext& context,
+                             const CryptFormat::Header& header, uint64_t dataStart, uint64_t recordBytes,
+                             uint64_t offset, uint64_t length, std::string& error);
+
+    static bool encrypt(std::istream& in, std::ostream& out, const std::vector<uint8_t>& key,
+                        const CryptFormat::Header& header, std::string& md5, std::string& error);
+    static bool decrypt(std::istream& in, std::ostream& out, const std::vector<uint8_t>& key,
+                        const CryptFormat::Header& header, std::string& md5, std::string& error);
+
+    // Legacy files are a single GCM message; plaintext is released before the tag
+    // is checked, so callers must write to a temporary file.
+    static bool decryptLegacy(std::istream& in, std::ostream& out, const std::vector<uint8_t>& key,
+                              const CryptFormat::Header& header, uint64_t ciphertextSize,
+                              std::string& md5, std::string& error);
+
+private:
+    static const size_t LEGACY_BLOCK_SIZE = 1 << 20;
+
+    static size_t readFully(std::istream& in, uint8_t* buffer, size_t size);
+};
\ No newline at end of file
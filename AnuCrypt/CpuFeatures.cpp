@@ -0,0 +1,93 @@
+#include "CpuFeatures.h"
+
+#ifdef ANUCRYPT_X86
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+namespace {
+    struct Features {
+        bool ssse3 = false;
+        bool avx2 = false;
+        bool avx512f = false;
+        bool sha = false;
+    };
+
+#ifdef ANUCRYPT_X86
+    void cpuid(unsigned leaf, unsigned subleaf, unsigned regs[4]) {
+#ifdef _MSC_VER
+        int values[4];
+        __cpuidex(values, static_cast<int>(leaf), static_cast<int>(subleaf));
+        for (int i = 0; i < 4; ++i) {
+            regs[i] = static_cast<unsigned>(values[i]);
+        }
+#else
+        __cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+    }
+
+    unsigned long long xgetbv0() {
+#ifdef _MSC_VER
+        return _xgetbv(0);
+#else
+        unsigned eax, edx;
+        __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+        return (static_cast<unsigned long long>(edx) << 32) | eax;
+#endif
+    }
+#endif
+
+    Features detect() {
+        Features features;
+#ifdef ANUCRYPT_X86
+        unsigned regs[4];
+        cpuid(0, 0, regs);
+        unsigned maxLeaf = regs[0];
+        if (maxLeaf < 1) {
+            return features;
+        }
+
+        cpuid(1, 0, regs);
+        features.ssse3 = (regs[2] & (1u << 9)) != 0;
+        bool osxsave = (regs[2] & (1u << 27)) != 0;
+        bool avx = (regs[2] & (1u << 28)) != 0;
+
+        unsigned long long xcr0 = osxsave ? xgetbv0() : 0;
+        if (maxLeaf < 7) {
+            return features;
+        }
+
+        cpuid(7, 0, regs);
+        features.sha = (regs[1] & (1u << 29)) != 0;
+        if (avx && (xcr0 & 0x6) == 0x6) {
+            features.avx2 = (regs[1] & (1u << 5)) != 0;
+            features.avx512f = (regs[1] & (1u << 16)) != 0 && (xcr0 & 0xE6) == 0xE6;
+        }
+#endif
+        return features;
+    }
+
+    const Features& features() {
+        static const Features detected = detect();
+        return detected;
+    }
+}
+
+bool CpuFeatures::hasSSSE3() {
+    return features().ssse3;
+}
+
+bool CpuFeatures::hasAVX2() {
+    return features().avx2;
+}
+
+bool CpuFeatures::hasAVX512F() {
+    return features().avx512f;
+}
+
+bool CpuFeatures::hasSHA() {
+    return features().sha;
+}
\ No newline at end of file
@@ -0,0 +1,24 @@
+#pragma once
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define ANUCRYPT_X86 1
+#endif
+
+// Lets a single function use instructions beyond the build's baseline; callers
+// must check CpuFeatures first. MSVC accepts the intrinsics without it.
+#if defined(__GNUC__) || defined(__clang__)
+#define ANUCRYPT_TARGET(features) __attribute__((target(features)))
+#else
+#define ANUCRYPT_TARGET(features)
+#endif
+
+// Instruction set extensions usable on this machine, detected once with cpuid.
+// AVX2 additionally requires the OS to save YMM state, and AVX-512 the opmask
+// and ZMM state as well. SHA covers the SHA-1 and SHA-256 instructions.
+class CpuFeatures {
+public:
+    static bool hasSSSE3();
+    static bool hasAVX2();
+    static bool hasAVX512F();
+    static bool hasSHA();
+};
\ No newline at end of file
@@ -0,0 +1,155 @@
+#include "CryptFormat.h"
+#include <cstring>
+#include <streambuf>
+
+namespace {
+    void writeU32(std::ostream& out, uint32_t value) {
+        uint8_t bytes[4];
+        for (int i = 0; i < 4; ++i) {
+            bytes[i] = static_cast<uint8_t>(value >> (8 * i));
+        }
+        out.write(reinterpret_cast<const char*>(bytes), sizeof(bytes));
+    }
+
+    uint32_t readU32(std::istream& in) {
+        uint8_t bytes[4] = {};
+        in.read(reinterpret_cast<char*>(bytes), sizeof(bytes));
+        uint32_t value = 0;
+        for (int i = 0; i < 4; ++i) {
+            value |= static_cast<uint32_t>(bytes[i]) << (8 * i);
+        }
+        return value;
+    }
+
+    // Streams over a caller's buffer, so headers in memory are parsed and
+    // written by the same code as headers in files.
+    class MemoryBuffer : public std::streambuf {
+    public:
+        MemoryBuffer(uint8_t* data, size_t size) {
+            char* begin = reinterpret_cast<char*>(data);
+            setg(begin, begin, begin + size);
+            setp(begin, begin + size);
+        }
+    };
+}
+
+bool CryptFormat::isLegacy(uint8_t algId) {
+    return algId == AES128_LEGACY || algId == AES256_LEGACY;
+}
+
+bool CryptFormat::isChunked(uint8_t algId) {
+    return algId == AES128_CHUNKED || algId == AES256_CHUNKED;
+}
+
+bool CryptFormat::isSegmented(uint8_t algId) {
+    return algId == AES128_SEGMENTED || algId == AES256_SEGMENTED;
+}
+
+bool CryptFormat::isArchive(uint8_t algId) {
+    return algId == AES128_ARCHIVE || algId == AES256_ARCHIVE;
+}
+
+uint64_t CryptFormat::dataOffset(const Header& header) {
+    if (isSegmented(header.algId)) {
+        return SEGMENTED_HEADER_SIZE + header.segmentTable.size();
+    }
+    return isChunked(header.algId) || isArchive(header.algId) ? CHUNKED_HEADER_SIZE : LEGACY_HEADER_SIZE;
+}
+
+void CryptFormat::writeHeader(std::ostream& out, const Header& header) {
+    out.write(reinterpret_cast<const char*>(&header.algId), sizeof(header.algId));
+    out.write(reinterpret_cast<const char*>(header.iv.data()), IV_SIZE);
+
+    std::string md5 = header.md5;
+    md5.resize(MD5_HEX_SIZE, '\0');
+    out.write(md5.data(), MD5_HEX_SIZE);
+
+    if (isChunked(header.algId) || isSegmented(header.algId) || isArchive(header.algId)) {
+        writeU32(out, header.chunkSize);
+    }
+
+    if (isSegmented(header.algId)) {
+        writeU32(out, header.segmentChunks);
+        writeU32(out, static_cast<uint32_t>(header.segmentTable.size() / MD5_SIZE));
+        out.write(reinterpret_cast<const char*>(header.segmentTable.data()), header.segmentTable.size());
+    }
+}
+
+bool CryptFormat::readHeader(std::istream& in, uint64_t size, Header& header, std::string& error) {
+    if (!in.read(reinterpret_cast<char*>(&header.algId), sizeof(header.algId))) {
+        error = "Encrypted file is empty.";
+        return false;
+    }
+
+    if (!isLegacy(header.algId) && !isChunked(header.algId) && !isSegmented(header.algId) &&
+        !isArchive(header.algId)) {
+        error = "Unknown encrypted file format.";
+        return false;
+    }
+
+    header.iv.resize(IV_SIZE);
+    header.md5.assign(MD5_HEX_SIZE, '\0');
+    in.read(reinterpret_cast<char*>(header.iv.data()), IV_SIZE);
+    in.read(&header.md5[0], MD5_HEX_SIZE);
+    header.chunkSize = 0;
+    header.segmentChunks = 0;
+    header.segmentTable.clear();
+
+    if (isChunked(header.algId) || isSegmented(header.algId) || isArchive(header.algId)) {
+        header.chunkSize = readU32(in);
+        if (in && (header.chunkSize == 0 || header.chunkSize > MAX_CHUNK_SIZE)) {
+            error = "Invalid chunk size in header.";
+            return false;
+        }
+    }
+
+    if (isSegmented(header.algId)) {
+        header.segmentChunks = readU32(in);
+        uint32_t segmentCount = readU32(in);
+        // Each segment has an MD5 in the table and at least one record.
+        uint64_t available = size > SEGMENTED_HEADER_SIZE ? size - SEGMENTED_HEADER_SIZE : 0;
+        if (in && (header.segmentChunks == 0 || segmentCount == 0 || segmentCount > MAX_SEGMENT_COUNT ||
+                   segmentCount > available / (MD5_SIZE + TAG_SIZE))) {
+            error = "Invalid segment table in header.";
+            return false;
+        }
+        if (in) {
+            header.segmentTable.resize(static_cast<size_t>(segmentCount) * MD5_SIZE);
+            in.read(reinterpret_cast<char*>(header.segmentTable.data()), header.segmentTable.size());
+        }
+    }
+
+    if (!in) {
+        error = "Encrypted file header is truncated.";
+        return false;
+    }
+    return true;
+}
+
+bool CryptFormat::patchMD5(std::ostream& out, const std::string& md5) {
+    std::streampos end = out.tellp();
+    out.seekp(1 + IV_SIZE);
+    out.write(md5.data(), MD5_HEX_SIZE);
+    out.seekp(end);
+    return static_cast<bool>(out);
+}
+
+void CryptFormat::chunkNonce(const std::vector<uint8_t>& iv, uint64_t index, uint8_t* nonce) {
+    std::memcpy(nonce, iv.data(), IV_SIZE);
+    for (int i = 0; i < 8; ++i) {
+        nonce[IV_SIZE - 1 - i] ^= static_cast<uint8_t>(index >> (8 * i));
+    }
+}
+
+void CryptFormat::writeHeader(uint8_t* out, const Header& header) {
+    MemoryBuffer buffer(out, static_cast<size_t>(dataOffset(header)));
+    std::ostream stream(&buffer);
+    writeHeader(stream, header);
+}
+
+bool CryptFormat::readHeader(const uint8_t* data, size_t size, Header& header, std::string& error) {
+    // Only read from; the buffer type is shared with writeHeader.
+    MemoryBuffer buffer(const_cast<uint8_t*>(data), size);
+    std::istream stream(&buffer);
+    return readHeader(stream, size, header, error);
+}
\ No newline at end of file
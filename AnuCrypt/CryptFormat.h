@@ -0,0 +1,79 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <iostream>
+#include <cstdint>
+
+// On-disk layout of .crypt files.
+//
+// Legacy (0x01/0x02):    algId | iv[12] | md5hex[32] | ciphertext | tag[16]
+// Chunked (0x03/0x04):   algId | iv[12] | md5hex[32] | chunkSize (u32 LE) | records...
+// Segmented (0x05/0x06): algId | iv[12] | md5hex[32] | chunkSize | segmentChunks (u32 LE)
+//                        | segmentCount (u32 LE) | md5[16] per segment | records...
+// Archive (0x07/0x08):   algId | iv[12] | md5hex[32] | chunkSize | member records...
+//                        | index records | indexOffset (u64 LE) | indexSize (u64 LE) | "ANUINDEX"
+//
+// Each record is one GCM message of up to chunkSize bytes followed by its 16-byte
+// tag. The nonce of record i is the header IV with i XORed into its last 8 bytes,
+// and the single AAD byte is 1 for the final record and 0 otherwise, so
+// reordering, dropping or truncating records fails authentication.
+//
+// Segmented files group segmentChunks consecutive records into a segment that is
+// encrypted and hashed independently, so segments can be processed in parallel.
+// The header MD5 of a segmented file is the MD5 of its segment table.
+//
+// An archive holds many files. Each member is a run of records under its own
+// random IV, so it can be decrypted alone; the index listing every member's
+// path, offset, size and IV is encrypted the same way under the header IV.
+// The header MD5 of an archive is the MD5 of its index.
+class CryptFormat {
+public:
+    static const uint8_t AES128_LEGACY = 0x01;
+    static const uint8_t AES256_LEGACY = 0x02;
+    static const uint8_t AES128_CHUNKED = 0x03;
+    static const uint8_t AES256_CHUNKED = 0x04;
+    static const uint8_t AES128_SEGMENTED = 0x05;
+    static const uint8_t AES256_SEGMENTED = 0x06;
+    static const uint8_t AES128_ARCHIVE = 0x07;
+    static const uint8_t AES256_ARCHIVE = 0x08;
+
+    static const size_t IV_SIZE = 12;
+    static const size_t MD5_HEX_SIZE = 32;
+    static const size_t MD5_SIZE = 16;
+    static const size_t TAG_SIZE = 16;
+    static const size_t LEGACY_HEADER_SIZE = 1 + IV_SIZE + MD5_HEX_SIZE;
+    static const size_t CHUNKED_HEADER_SIZE = LEGACY_HEADER_SIZE + 4;
+    static const size_t SEGMENTED_HEADER_SIZE = CHUNKED_HEADER_SIZE + 8;
+
+    static const uint32_t DEFAULT_CHUNK_SIZE = 1 << 20;
+    static const uint32_t MAX_CHUNK_SIZE = 64 << 20;
+    static const uint32_t DEFAULT_SEGMENT_CHUNKS = 64;
+    static const uint32_t MAX_SEGMENT_COUNT = 1 << 22;
+
+    struct Header {
+        uint8_t algId = 0;
+        std::vector<uint8_t> iv;
+        std::string md5;
+        uint32_t chunkSize = 0;
+        uint32_t segmentChunks = 0;
+        std::vector<uint8_t> segmentTable;
+    };
+
+    static bool isLegacy(uint8_t algId);
+    static bool isChunked(uint8_t algId);
+    static bool isSegmented(uint8_t algId);
+    static bool isArchive(uint8_t algId);
+    static uint64_t dataOffset(const Header& header);
+
+    static void writeHeader(std::ostream& out, const Header& header);
+    // size is the length of the whole file, header included; counts in the
+    // header that it cannot hold are rejected before anything is allocated.
+    static bool readHeader(std::istream& in, uint64_t size, Header& header, std::string& error);
+    static bool patchMD5(std::ostream& out, const std::string& md5);
+
+    // The same headers in memory; writeHeader needs dataOffset(header) bytes.
+    static void writeHeader(uint8_t* out, const Header& header);
+    static bool readHeader(const uint8_t* data, size_t size, Header& header, std::string& error);
+
+    static void chunkNonce(const std::vector<uint8_t>& iv, uint64_t index, uint8_t* nonce);
+};
\ No newline at end of file
@@ -0,0 +1,436 @@
+#include "CryptoBackend.h"
+#include <algorithm>
+#include <chrono>
+#include <sstream>
+#include <stdexcept>
+#include <cryptopp/aes.h>
+#include <cryptopp/gcm.h>
+#include <cryptopp/md5.h>
+#include <cryptopp/sha.h>
+#ifdef ANUCRYPT_WITH_OPENSSL
+#include <climits>
+#include <openssl/evp.h>
+#endif
+
+namespace {
+    class CryptoPPGcm : public GcmCipher {
+    public:
+        void setKey(const uint8_t* key, size_t size) override {
+            m_enc.SetKey(key, size);
+            m_dec.SetKey(key, size);
+        }
+
+        void seal(const uint8_t* nonce, size_t nonceSize, const uint8_t* aad, size_t aadSize,
+            const uint8_t* plaintext, size_t size, uint8_t* ciphertext, uint8_t* tag, size_t tagSize) override {
+            m_enc.EncryptAndAuthenticate(ciphertext, tag, tagSize, nonce, static_cast<int>(nonceSize),
+                aad, aadSize, plaintext, size);
+        }
+
+        bool open(const uint8_t* nonce, size_t nonceSize, const uint8_t* aad, size_t aadSize,
+            const uint8_t* ciphertext, size_t size, const uint8_t* tag, size_t tagSize, uint8_t* plaintext) override {
+            return m_dec.DecryptAndVerify(plaintext, tag, tagSize, nonce, static_cast<int>(nonceSize),
+                aad, aadSize, ciphertext, size);
+        }
+
+        void start(const uint8_t* nonce, size_t nonceSize) override {
+            m_dec.Resynchronize(nonce, static_cast<int>(nonceSize));
+        }
+
+        void decrypt(const uint8_t* ciphertext, size_t size, uint8_t* plaintext) override {
+            m_dec.ProcessData(plaintext, ciphertext, size);
+        }
+
+        bool verify(const uint8_t* tag, size_t tagSize) override {
+            return m_dec.TruncatedVerify(tag, tagSize);
+        }
+
+    private:
+        CryptoPP::GCM<CryptoPP::AES>::Encryption m_enc;
+        CryptoPP::GCM<CryptoPP::AES>::Decryption m_dec;
+    };
+
+    template <typename Hash>
+    class CryptoPPHash : public HashContext {
+    public:
+        void init() override {
+            m_hash.Restart();
+        }
+
+        void update(const uint8_t* data, size_t size) override {
+            m_hash.Update(data, size);
+        }
+
+        void final(uint8_t* digest) override {
+            m_hash.Final(digest);
+        }
+
+    private:
+        Hash m_hash;
+    };
+
+    class CryptoPPBackend : public CryptoBackend {
+    public:
+        const char* name() const override {
+            return "cryptopp";
+        }
+
+        std::unique_ptr<GcmCipher> newGcm() const override {
+            return std::unique_ptr<GcmCipher>(new CryptoPPGcm);
+        }
+
+        std::unique_ptr<HashContext> newHash(Hashing::Algorithm alg) const override {
+            switch (alg) {
+            case Hashing::RC2_ALG:
+                return std::unique_ptr<HashContext>(new CryptoPPHash<CryptoPP::SHA1>);
+            case Hashing::MD5_ALG:
+                return std::unique_ptr<HashContext>(new CryptoPPHash<CryptoPP::MD5>);
+            case Hashing::SHA256_ALG:
+            default:
+                return std::unique_ptr<HashContext>(new CryptoPPHash<CryptoPP::SHA256>);
+            }
+        }
+    };
+
+#ifdef ANUCRYPT_WITH_OPENSSL
+    void check(int result) {
+        if (result != 1) {
+            throw std::runtime_error("OpenSSL operation failed.");
+        }
+    }
+
+    // The key schedule is set up once per context; each message only resets
+    // the nonce, where Crypto++'s GCM re-keys on every resynchronisation.
+    class OpenSSLGcm : public GcmCipher {
+    public:
+        OpenSSLGcm() : m_enc(EVP_CIPHER_CTX_new()), m_dec(EVP_CIPHER_CTX_new()), m_nonceSize(0) {
+            if (!m_enc || !m_dec) {
+                EVP_CIPHER_CTX_free(m_enc);
+                EVP_CIPHER_CTX_free(m_dec);
+                throw std::bad_alloc();
+            }
+        }
+
+        ~OpenSSLGcm() {
+            EVP_CIPHER_CTX_free(m_enc);
+            EVP_CIPHER_CTX_free(m_dec);
+        }
+
+        OpenSSLGcm(const OpenSSLGcm&) = delete;
+        OpenSSLGcm& operator=(const OpenSSLGcm&) = delete;
+
+        void setKey(const uint8_t* key, size_t size) override {
+            const EVP_CIPHER* cipher = size == 16 ? EVP_aes_128_gcm()
+                : size == 24 ? EVP_aes_192_gcm()
+                : size == 32 ? EVP_aes_256_gcm()
+                : nullptr;
+            if (!cipher) {
+                throw std::invalid_argument("Invalid key length.");
+            }
+            check(EVP_EncryptInit_ex(m_enc, cipher, nullptr, key, nullptr));
+            check(EVP_DecryptInit_ex(m_dec, cipher, nullptr, key, nullptr));
+            m_nonceSize = 12;
+        }
+
+        void seal(const uint8_t* nonce, size_t nonceSize, const uint8_t* aad, size_t aadSize,
+            const uint8_t* plaintext, size_t size, uint8_t* ciphertext, uint8_t* tag, size_t tagSize) override {
+            setNonce(m_enc, nonce, nonceSize, 1);
+            process(m_enc, aad, aadSize, nullptr);
+            process(m_enc, plaintext, size, ciphertext);
+            uint8_t none[16];
+            int length;
+            check(EVP_EncryptFinal_ex(m_enc, none, &length));
+            check(EVP_CIPHER_CTX_ctrl(m_enc, EVP_CTRL_GCM_GET_TAG, static_cast<int>(tagSize), tag));
+        }
+
+        bool open(const uint8_t* nonce, size_t nonceSize, const uint8_t* aad, size_t aadSize,
+            const uint8_t* ciphertext, size_t size, const uint8_t* tag, size_t tagSize, uint8_t* plaintext) override {
+            start(nonce, nonceSize);
+            process(m_dec, aad, aadSize, nullptr);
+            decrypt(ciphertext, size, plaintext);
+            return verify(tag, tagSize);
+        }
+
+        void start(const uint8_t* nonce, size_t nonceSize) override {
+            setNonce(m_dec, nonce, nonceSize, 0);
+        }
+
+        void decrypt(const uint8_t* ciphertext, size_t size, uint8_t* plaintext) override {
+            process(m_dec, ciphertext, size, plaintext);
+        }
+
+        bool verify(const uint8_t* tag, size_t tagSize) override {
+            uint8_t expected[16];
+            if (tagSize == 0 || tagSize > sizeof(expected)) {
+                return false;
+            }
+            std::copy(tag, tag + tagSize, expected);
+            check(EVP_CIPHER_CTX_ctrl(m_dec, EVP_CTRL_GCM_SET_TAG, static_cast<int>(tagSize), expected));
+            uint8_t none[16];
+            int length;
+            return EVP_DecryptFinal_ex(m_dec, none, &length) > 0;
+        }
+
+    private:
+        void setNonce(EVP_CIPHER_CTX* ctx, const uint8_t* nonce, size_t nonceSize, int encrypt) {
+            if (nonceSize != m_nonceSize) {
+                check(EVP_CIPHER_CTX_ctrl(m_enc, EVP_CTRL_GCM_SET_IVLEN, static_cast<int>(nonceSize), nullptr));
+                check(EVP_CIPHER_CTX_ctrl(m_dec, EVP_CTRL_GCM_SET_IVLEN, static_cast<int>(nonceSize), nullptr));
+                m_nonceSize = nonceSize;
+            }
+            check(EVP_CipherInit_ex(ctx, nullptr, nullptr, nullptr, nonce, encrypt));
+        }
+
+        // EVP takes int lengths; out is null for additional data.
+        static void process(EVP_CIPHER_CTX* ctx, const uint8_t* in, size_t size, uint8_t* out) {
+            while (size > 0) {
+                int piece = static_cast<int>(std::min<size_t>(size, INT_MAX / 2));
+                int length;
+                check(EVP_CipherUpdate(ctx, out, &length, in, piece));
+                in += piece;
+                if (out) {
+                    out += piece;
+                }
+                size -= piece;
+            }
+        }
+
+        EVP_CIPHER_CTX* m_enc;
+        EVP_CIPHER_CTX* m_dec;
+        size_t m_nonceSize;
+    };
+
+    // Restarts after final() as Crypto++'s hashes do.
+    class OpenSSLHash : public HashContext {
+    public:
+        explicit OpenSSLHash(const EVP_MD* md) : m_md(md), m_ctx(EVP_MD_CTX_new()) {
+            if (!m_ctx) {
+                throw std::bad_alloc();
+            }
+            init();
+        }
+
+        ~OpenSSLHash() {
+            EVP_MD_CTX_free(m_ctx);
+        }
+
+        OpenSSLHash(const OpenSSLHash&) = delete;
+        OpenSSLHash& operator=(const OpenSSLHash&) = delete;
+
+        void init() override {
+            check(EVP_DigestInit_ex(m_ctx, m_md, nullptr));
+        }
+
+        void update(const uint8_t* data, size_t size) override {
+            check(EVP_DigestUpdate(m_ctx, data, size));
+        }
+
+        void final(uint8_t* digest) override {
+            check(EVP_DigestFinal_ex(m_ctx, digest, nullptr));
+            init();
+        }
+
+    private:
+        const EVP_MD* m_md;
+        EVP_MD_CTX* m_ctx;
+    };
+
+    class OpenSSLBackend : public CryptoBackend {
+    public:
+        const char* name() const override {
+            return "openssl";
+        }
+
+        std::unique_ptr<GcmCipher> newGcm() const override {
+            return std::unique_ptr<GcmCipher>(new OpenSSLGcm);
+        }
+
+        std::unique_ptr<HashContext> newHash(Hashing::Algorithm alg) const override {
+            switch (alg) {
+            case Hashing::RC2_ALG:
+                return std::unique_ptr<HashContext>(new OpenSSLHash(EVP_sha1()));
+            case Hashing::MD5_ALG:
+                return std::unique_ptr<HashContext>(new OpenSSLHash(EVP_md5()));
+            case Hashing::SHA256_ALG:
+            default:
+                return std::unique_ptr<HashContext>(new OpenSSLHash(EVP_sha256()));
+            }
+        }
+    };
+#endif
+
+    const CryptoBackend& cryptoPP() {
+        static const CryptoPPBackend backend;
+        return backend;
+    }
+
+    // Null until chosen, so lookups during static initialisation still work.
+    const CryptoBackend* selected[CryptoBackend::PRIMITIVE_COUNT] = {};
+}
+
+const std::vector<const CryptoBackend*>& CryptoBackend::available() {
+#ifdef ANUCRYPT_WITH_OPENSSL
+    static const OpenSSLBackend openSSL;
+    static const std::vector<const CryptoBackend*> backends = { &cryptoPP(), &openSSL };
+#else
+    static const std::vector<const CryptoBackend*> backends = { &cryptoPP() };
+#endif
+    return backends;
+}
+
+const CryptoBackend* CryptoBackend::find(const std::string& name) {
+    for (const CryptoBackend* backend : available()) {
+        if (name == backend->name()) {
+            return backend;
+        }
+    }
+    return nullptr;
+}
+
+const CryptoBackend& CryptoBackend::defaultBackend() {
+    return cryptoPP();
+}
+
+const CryptoBackend& CryptoBackend::current(Primitive primitive) {
+    return selected[primitive] ? *selected[primitive] : cryptoPP();
+}
+
+const CryptoBackend& CryptoBackend::forHash(Hashing::Algorithm alg) {
+    return current(hashPrimitive(alg));
+}
+
+HashContext& CryptoBackend::threadHash(Hashing::Algorithm alg) {
+    struct Cached {
+        const CryptoBackend* backend;
+        Hashing::Algorithm alg;
+        std::unique_ptr<HashContext> context;
+    };
+    thread_local std::vector<Cached> cache;
+
+    const CryptoBackend& backend = forHash(alg);
+    for (auto& cached : cache) {
+        if (cached.backend == &backend && cached.alg == alg) {
+            cached.context->init();
+            return *cached.context;
+        }
+    }
+    cache.push_back({ &backend, alg, backend.newHash(alg) });
+    return *cache.back().context;
+}
+
+void CryptoBackend::use(Primitive primitive, const CryptoBackend& backend) {
+    selected[primitive] = &backend;
+}
+
+CryptoBackend::Primitive CryptoBackend::hashPrimitive(Hashing::Algorithm alg) {
+    switch (alg) {
+    case Hashing::RC2_ALG:
+        return SHA1_PRIMITIVE;
+    case Hashing::MD5_ALG:
+        return MD5_PRIMITIVE;
+    case Hashing::SHA256_ALG:
+    default:
+        return SHA256_PRIMITIVE;
+    }
+}
+
+const char* CryptoBackend::primitiveName(Primitive primitive) {
+    switch (primitive) {
+    case GCM_PRIMITIVE:
+        return "aes-gcm";
+    case MD5_PRIMITIVE:
+        return "md5";
+    case SHA1_PRIMITIVE:
+        return "sha1";
+    case SHA256_PRIMITIVE:
+    default:
+        return "sha256";
+    }
+}
+
+double CryptoBackend::measure(Primitive primitive, const CryptoBackend& backend) {
+    std::vector<uint8_t> input(CALIBRATION_SIZE, 0x5A);
+    std::vector<uint8_t> output(CALIBRATION_SIZE);
+    uint8_t nonce[12] = { 0 };
+    uint8_t tag[16];
+    uint8_t key[32] = { 0 };
+
+    std::unique_ptr<GcmCipher> gcm;
+    std::unique_ptr<HashContext> hash;
+    if (primitive == GCM_PRIMITIVE) {
+        gcm = backend.newGcm();
+        gcm->setKey(key, sizeof(key));
+    }
+    else {
+        hash = backend.newHash(primitive == MD5_PRIMITIVE ? Hashing::MD5_ALG
+            : primitive == SHA1_PRIMITIVE ? Hashing::SHA1_ALG : Hashing::SHA256_ALG);
+    }
+
+    // One untimed pass first, so table setup and page faults are not counted.
+    auto once = [&] {
+        if (gcm) {
+            gcm->seal(nonce, sizeof(nonce), nullptr, 0, input.data(), input.size(), output.data(), tag, sizeof(tag));
+        }
+        else {
+            hash->update(input.data(), input.size());
+            hash->final(output.data());
+        }
+    };
+    once();
+
+    auto start = std::chrono::steady_clock::now();
+    uint64_t bytes = 0;
+    double elapsed;
+    do {
+        once();
+        bytes += input.size();
+        elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    } while (elapsed < CALIBRATION_SECONDS);
+    return bytes / elapsed;
+}
+
+bool CryptoBackend::select(const std::string& name, std::ostream* progress, std::string& error) {
+    if (name != "auto") {
+        const CryptoBackend* backend = find(name);
+        if (!backend) {
+            error = name == "openssl"
+                ? "This build has no OpenSSL backend (build with ANUCRYPT_WITH_OPENSSL)."
+                : "Unknown crypto backend: " + name + " (use cryptopp, openssl or auto).";
+            return false;
+        }
+        for (int primitive = 0; primitive < PRIMITIVE_COUNT; ++primitive) {
+            use(static_cast<Primitive>(primitive), *backend);
+        }
+        return true;
+    }
+
+    try {
+        for (int p = 0; p < PRIMITIVE_COUNT; ++p) {
+            Primitive primitive = static_cast<Primitive>(p);
+            std::ostringstream line;
+            line.setf(std::ios::fixed);
+            line.precision(1);
+
+            const CryptoBackend* best = nullptr;
+            double bestRate = 0;
+            for (const CryptoBackend* backend : available()) {
+                double rate = measure(primitive, *backend);
+                line << " " << backend->name() << " " << rate / 1e6 << " MB/s";
+                if (!best || rate > bestRate) {
+                    best = backend;
+                    bestRate = rate;
+                }
+            }
+            use(primitive, *best);
+
+            if (progress) {
+                *progress << "Backend: " << primitiveName(primitive) << " -> " << best->name() << " ("
+                          << line.str().substr(1) << ")" << std::endl;
+            }
+        }
+        return true;
+    }
+    catch (const std::exception& e) {
+        error = std::string("Backend calibration failed: ") + e.what();
+        return false;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,91 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+#include "Hashing.h"
+
+// AES-GCM keyed once and used for many messages, each with its own nonce.
+// seal() and open() handle a whole record; start(), decrypt() and verify()
+// stream one long message, as the legacy format needs.
+class GcmCipher {
+public:
+    virtual ~GcmCipher() {}
+
+    virtual void setKey(const uint8_t* key, size_t size) = 0;
+
+    virtual void seal(const uint8_t* nonce, size_t nonceSize, const uint8_t* aad, size_t aadSize,
+                      const uint8_t* plaintext, size_t size, uint8_t* ciphertext, uint8_t* tag, size_t tagSize) = 0;
+    virtual bool open(const uint8_t* nonce, size_t nonceSize, const uint8_t* aad, size_t aadSize,
+                      const uint8_t* ciphertext, size_t size, const uint8_t* tag, size_t tagSize,
+                      uint8_t* plaintext) = 0;
+
+    virtual void start(const uint8_t* nonce, size_t nonceSize) = 0;
+    virtual void decrypt(const uint8_t* ciphertext, size_t size, uint8_t* plaintext) = 0;
+    virtual bool verify(const uint8_t* tag, size_t tagSize) = 0;
+};
+
+// Streaming hash: init() / update() any number of times / final().
+class HashContext {
+public:
+    virtual ~HashContext() {}
+
+    virtual void init() = 0;
+    virtual void update(const uint8_t* data, size_t size) = 0;
+    virtual void final(uint8_t* digest) = 0;
+};
+
+// A library that provides the primitives every format is built on. Crypto++ is
+// always available; OpenSSL's EVP interface is when built with
+// ANUCRYPT_WITH_OPENSSL. Both produce the same bytes, so files and digests do
+// not depend on the choice.
+//
+// Each primitive has its own current backend, Crypto++ by default. Choose them
+// at startup: contexts made earlier keep the backend they were made with.
+class CryptoBackend {
+public:
+    enum Primitive {
+        GCM_PRIMITIVE,
+        MD5_PRIMITIVE,
+        SHA1_PRIMITIVE,
+        SHA256_PRIMITIVE,
+        PRIMITIVE_COUNT
+    };
+
+    virtual ~CryptoBackend() {}
+
+    virtual const char* name() const = 0;
+    virtual std::unique_ptr<GcmCipher> newGcm() const = 0;
+    virtual std::unique_ptr<HashContext> newHash(Hashing::Algorithm alg) const = 0;
+
+    static const std::vector<const CryptoBackend*>& available();
+    static const CryptoBackend* find(const std::string& name);
+
+    static const CryptoBackend& defaultBackend();
+    static const CryptoBackend& current(Primitive primitive);
+    static const CryptoBackend& forHash(Hashing::Algorithm alg);
+
+    // An initialised context for alg on its current backend, owned by the
+    // calling thread, so one-shot digests do not allocate after the first. It
+    // is reset on the next call for the same algorithm on this thread.
+    static HashContext& threadHash(Hashing::Algorithm alg);
+    static void use(Primitive primitive, const CryptoBackend& backend);
+
+    // "cryptopp" or "openssl" for every primitive, or "auto" to time each
+    // backend on each primitive and keep the fastest; progress, if given,
+    // receives one line per primitive.
+    static bool select(const std::string& name, std::ostream* progress, std::string& error);
+
+    static const char* primitiveName(Primitive primitive);
+    static Primitive hashPrimitive(Hashing::Algorithm alg);
+
+private:
+    // Per primitive and backend; large enough for full-speed code paths, small
+    // enough that auto adds well under a second to startup.
+    static const size_t CALIBRATION_SIZE = 64 * 1024;
+    static constexpr double CALIBRATION_SECONDS = 0.05;
+
+    static double measure(Primitive primitive, const CryptoBackend& backend);
+};
\ No newline at end of file
@@ -0,0 +1,446 @@
+#include "CryptoSession.h"
+#include "CryptFormat.h"
+#include "SegmentedCipher.h"
+#include "FileValidator.h"
+#include "FileSystem.h"
+#include <fstream>
+#include <cstring>
+#include <cstdio>
+
+EncryptionSession::EncryptionSession()
+    : m_keyed(false), m_pipelined(false), m_algId(0) {
+}
+
+bool EncryptionSession::setKey(const std::vector<uint8_t>& key, bool aes128, std::string& error) {
+    if (!ChunkedCipher::checkKey(key, error)) {
+        return false;
+    }
+    m_context.gcm->setKey(key.data(), key.size());
+    m_algId = aes128 ? CryptFormat::AES128_CHUNKED : CryptFormat::AES256_CHUNKED;
+    m_keyed = true;
+    return true;
+}
+
+bool EncryptionSession::encryptFile(const std::string& inputPath, const std::string& outputPath, std::string& error) {
+    if (!m_keyed) {
+        error = "No key set.";
+        return false;
+    }
+
+    try {
+        std::ifstream inFile(inputPath, std::ios::binary);
+        if (!inFile.is_open()) {
+            error = "Cannot open input file.";
+            return false;
+        }
+
+        CryptFormat::Header header;
+        header.algId = m_algId;
+        header.md5.assign(CryptFormat::MD5_HEX_SIZE, '0');
+        header.chunkSize = CryptFormat::DEFAULT_CHUNK_SIZE;
+        header.iv.resize(CryptFormat::IV_SIZE);
+        m_rng.GenerateBlock(header.iv.data(), header.iv.size());
+
+        std::ofstream outFile(outputPath, std::ios::binary);
+        if (!outFile.is_open()) {
+            error = "Cannot open output file.";
+            return false;
+        }
+
+        // The MD5 is computed while encrypting and patched into the header afterwards,
+        // so the input is only read once.
+        CryptFormat::writeHeader(outFile, header);
+        std::string md5;
+        inFile.seekg(0, std::ios::end);
+        bool pipelined = m_pipelined && static_cast<uint64_t>(inFile.tellg()) > header.chunkSize;
+        inFile.seekg(0);
+        bool ok = pipelined
+            ? ChunkedCipher::encryptPipelined(inFile, outFile, m_context, header, md5, error)
+            : ChunkedCipher::encrypt(inFile, outFile, m_context, header, md5, error);
+        if (ok && !CryptFormat::patchMD5(outFile, md5)) {
+            error = "Failed writing output file.";
+            ok = false;
+        }
+        outFile.close();
+
+        if (!ok) {
+            std::remove(outputPath.c_str());
+            return false;
+        }
+
+        return true;
+    }
+    catch (const std::exception& e) {
+        error = e.what();
+        return false;
+    }
+}
+
+bool EncryptionSession::encryptFile(const std::string& inputPath, const std::string& outputPath, IOEngine& engine,
+    std::string& error) {
+    if (!m_keyed) {
+        error = "No key set.";
+        return false;
+    }
+    if (engine.blockSize() == 0 || engine.blockSize() > CryptFormat::MAX_CHUNK_SIZE) {
+        error = "I/O block size is not a valid chunk size.";
+        return false;
+    }
+
+    try {
+        CryptFormat::Header header;
+        header.algId = m_algId;
+        header.chunkSize = static_cast<uint32_t>(engine.blockSize());
+        header.iv.resize(CryptFormat::IV_SIZE);
+        m_rng.GenerateBlock(header.iv.data(), header.iv.size());
+
+        IOEngine::FileHandle outFile = IOEngine::openWrite(outputPath);
+        if (outFile == IOEngine::INVALID_FILE) {
+            error = "Cannot open output file.";
+            return false;
+        }
+
+        // Records have fixed sizes, so each one's offset is known before it is
+        // written; the header goes last, once the MD5 is known.
+        const uint64_t dataStart = CryptFormat::CHUNKED_HEADER_SIZE;
+        const uint64_t recordSize = header.chunkSize + CryptFormat::TAG_SIZE;
+        m_context.digest->init();
+        uint64_t index = 0;
+
+        bool ok = engine.readFile(inputPath, [&](const uint8_t* data, size_t size, bool last, std::string& err) {
+            IOEngine::WriteBuffer buffer;
+            if (!engine.acquireWrite(buffer, err)) {
+                return false;
+            }
+            m_context.digest->update(data, size);
+            ChunkedCipher::sealRecord(m_context, header.iv, index, last, data, size, buffer.data);
+            return engine.queueWrite(buffer, outFile, dataStart + index++ * recordSize,
+                size + CryptFormat::TAG_SIZE, err);
+        }, error);
+
+        if (ok) {
+            uint8_t hash[CryptFormat::MD5_SIZE];
+            m_context.digest->final(hash);
+            header.md5 = FileValidator::toHex(hash, sizeof(hash));
+
+            IOEngine::WriteBuffer buffer;
+            ok = engine.acquireWrite(buffer, error);
+            if (ok) {
+                CryptFormat::writeHeader(buffer.data, header);
+                ok = engine.queueWrite(buffer, outFile, 0, static_cast<size_t>(dataStart), error);
+            }
+        }
+
+        // Writes already queued must finish before the file is closed, even on failure.
+        std::string writeError;
+        if (!engine.finishWrites(writeError) && ok) {
+            error = writeError;
+            ok = false;
+        }
+        IOEngine::closeFile(outFile);
+
+        if (!ok) {
+            std::remove(outputPath.c_str());
+            return false;
+        }
+
+        return true;
+    }
+    catch (const std::exception& e) {
+        error = e.what();
+        return false;
+    }
+}
+
+uint64_t EncryptionSession::encryptedSize(uint64_t plainSize) {
+    return CryptFormat::CHUNKED_HEADER_SIZE + ChunkedCipher::recordBytes(plainSize, CryptFormat::DEFAULT_CHUNK_SIZE);
+}
+
+bool EncryptionSession::encrypt(const uint8_t* in, size_t inSize, uint8_t* out, size_t outCapacity,
+    size_t& outSize, std::string& error) {
+    if (!m_keyed) {
+        error = "No key set.";
+        return false;
+    }
+
+    const uint64_t required = encryptedSize(inSize);
+    if (outCapacity < required) {
+        error = "Output buffer is too small (" + std::to_string(required) + " bytes needed).";
+        return false;
+    }
+
+    try {
+        CryptFormat::Header header;
+        header.algId = m_algId;
+        header.chunkSize = CryptFormat::DEFAULT_CHUNK_SIZE;
+        header.iv.resize(CryptFormat::IV_SIZE);
+        m_rng.GenerateBlock(header.iv.data(), header.iv.size());
+
+        ChunkedCipher::encryptBuffer(in, inSize, out + CryptFormat::CHUNKED_HEADER_SIZE, m_context, header.iv,
+            header.chunkSize, header.md5);
+        CryptFormat::writeHeader(out, header);
+        outSize = static_cast<size_t>(required);
+        return true;
+    }
+    catch (const std::exception& e) {
+        error = e.what();
+        return false;
+    }
+}
+
+DecryptionSession::DecryptionSession()
+    : m_keyed(false), m_pipelined(false), m_aes128(false) {
+}
+
+bool DecryptionSession::setKey(const std::vector<uint8_t>& key, bool aes128, std::string& error) {
+    if (!ChunkedCipher::checkKey(key, error)) {
+        return false;
+    }
+    m_context.gcm->setKey(key.data(), key.size());
+    m_key = key;
+    m_aes128 = aes128;
+    m_keyed = true;
+    return true;
+}
+
+bool DecryptionSession::openHeader(std::ifstream& in, const std::string& inputPath, CryptFormat::Header& header,
+    std::string& error) {
+    in.open(inputPath, std::ios::binary);
+    if (!in.is_open()) {
+        error = "Cannot open encrypted file.";
+        return false;
+    }
+
+    in.seekg(0, std::ios::end);
+    uint64_t fileSize = static_cast<uint64_t>(in.tellg());
+    in.seekg(0);
+    return CryptFormat::readHeader(in, fileSize, header, error) && checkFormat(header, error);
+}
+
+bool DecryptionSession::checkFormat(const CryptFormat::Header& header, std::string& error) const {
+    bool matches = m_aes128
+        ? header.algId == CryptFormat::AES128_LEGACY || header.algId == CryptFormat::AES128_CHUNKED ||
+          header.algId == CryptFormat::AES128_SEGMENTED
+        : header.algId == CryptFormat::AES256_LEGACY || header.algId == CryptFormat::AES256_CHUNKED ||
+          header.algId == CryptFormat::AES256_SEGMENTED;
+    if (CryptFormat::isArchive(header.algId)) {
+        error = "File is an archive. Use --archive --extract.";
+        return false;
+    }
+    if (!matches) {
+        error = m_aes128
+            ? "File was not encrypted with AES-128. Use the correct decryption algorithm."
+            : "File was not encrypted with AES-256. Use the correct decryption algorithm.";
+        return false;
+    }
+    return true;
+}
+
+bool DecryptionSession::decryptFile(const std::string& inputPath, const std::string& outputPath, size_t jobs,
+    std::string& error) {
+    if (!m_keyed) {
+        error = "No key set.";
+        return false;
+    }
+
+    try {
+        std::ifstream inFile;
+        CryptFormat::Header header;
+        if (!openHeader(inFile, inputPath, header, error)) {
+            return false;
+        }
+
+        if (CryptFormat::isSegmented(header.algId)) {
+            inFile.close();
+            return SegmentedCipher::decryptFile(inputPath, outputPath, m_key, header, jobs, error);
+        }
+
+        // Decrypt into a temporary file that only replaces the output once both the
+        // GCM tag(s) and the stored MD5 have been verified.
+        std::string tempPath = outputPath + ".part";
+        std::ofstream outFile(tempPath, std::ios::binary);
+        if (!outFile.is_open()) {
+            error = "Cannot create output file.";
+            return false;
+        }
+
+        std::string computedMD5;
+        bool ok;
+        if (CryptFormat::isChunked(header.algId)) {
+            std::streampos dataStart = inFile.tellg();
+            inFile.seekg(0, std::ios::end);
+            bool pipelined = m_pipelined &&
+                inFile.tellg() - dataStart > static_cast<std::streamoff>(header.chunkSize + CryptFormat::TAG_SIZE);
+            inFile.seekg(dataStart);
+            ok = pipelined
+                ? ChunkedCipher::decryptPipelined(inFile, outFile, m_context, header, computedMD5, error)
+                : ChunkedCipher::decrypt(inFile, outFile, m_context, header, computedMD5, error);
+        }
+        else {
+            inFile.seekg(0, std::ios::end);
+            uint64_t totalSize = static_cast<uint64_t>(inFile.tellg());
+            inFile.seekg(CryptFormat::LEGACY_HEADER_SIZE);
+            ok = ChunkedCipher::decryptLegacy(inFile, outFile, m_key, header,
+                totalSize - CryptFormat::LEGACY_HEADER_SIZE, computedMD5, error);
+        }
+        inFile.close();
+        outFile.close();
+
+        if (ok && computedMD5 != header.md5) {
+            error = "File integrity check failed - possible corruption.";
+            ok = false;
+        }
+        if (ok && outFile.fail()) {
+            error = "Failed writing output file.";
+            ok = false;
+        }
+        if (!ok) {
+            std::remove(tempPath.c_str());
+            return false;
+        }
+
+        if (!replaceFile(tempPath, outputPath)) {
+            error = "Cannot create output file.";
+            std::remove(tempPath.c_str());
+            return false;
+        }
+
+        return true;
+    }
+    catch (const std::exception& e) {
+        error = std::string("Decryption error: ") + e.what();
+        return false;
+    }
+}
+
+bool DecryptionSession::decryptRange(const std::string& inputPath, uint64_t offset, uint64_t length,
+    std::ostream& out, std::string& error) {
+    if (!m_keyed) {
+        error = "No key set.";
+        return false;
+    }
+
+    try {
+        std::ifstream inFile;
+        CryptFormat::Header header;
+        if (!openHeader(inFile, inputPath, header, error)) {
+            return false;
+        }
+
+        // A legacy file is one GCM message whose tag covers all of it.
+        if (CryptFormat::isLegacy(header.algId)) {
+            error = "Legacy files cannot be decrypted by range. Decrypt and re-encrypt the file first.";
+            return false;
+        }
+
+        uint64_t dataStart = CryptFormat::dataOffset(header);
+        inFile.seekg(0, std::ios::end);
+        uint64_t fileSize = static_cast<uint64_t>(inFile.tellg());
+        if (fileSize < dataStart) {
+            error = "Encrypted file is truncated.";
+            return false;
+        }
+        return ChunkedCipher::decryptRange(inFile, out, m_context, header, dataStart, fileSize - dataStart,
+            offset, length, error);
+    }
+    catch (const std::exception& e) {
+        error = std::string("Decryption error: ") + e.what();
+        return false;
+    }
+}
+
+bool DecryptionSession::plainSize(const CryptFormat::Header& header, size_t inSize, size_t& size,
+    std::string& error) {
+    const uint64_t dataStart = CryptFormat::dataOffset(header);
+    uint64_t plain = 0;
+    bool ok = inSize >= dataStart;
+    if (ok && CryptFormat::isLegacy(header.algId)) {
+        ok = inSize - dataStart >= CryptFormat::TAG_SIZE;
+        plain = inSize - dataStart - (ok ? CryptFormat::TAG_SIZE : 0);
+    }
+    else if (ok) {
+        ok = ChunkedCipher::plainSize(inSize - dataStart, header.chunkSize, plain);
+    }
+
+    if (!ok) {
+        error = "Encrypted file is truncated.";
+        return false;
+    }
+    size = static_cast<size_t>(plain);
+    return true;
+}
+
+bool DecryptionSession::decryptedSize(const uint8_t* in, size_t inSize, size_t& size, std::string& error) {
+    CryptFormat::Header header;
+    if (!CryptFormat::readHeader(in, inSize, header, error)) {
+        return false;
+    }
+    if (CryptFormat::isArchive(header.algId)) {
+        error = "Data is an archive. Use --archive --extract.";
+        return false;
+    }
+    return plainSize(header, inSize, size, error);
+}
+
+bool DecryptionSession::decrypt(const uint8_t* in, size_t inSize, uint8_t* out, size_t outCapacity,
+    size_t& outSize, std::string& error) {
+    if (!m_keyed) {
+        error = "No key set.";
+        return false;
+    }
+
+    try {
+        CryptFormat::Header header;
+        size_t size;
+        if (!CryptFormat::readHeader(in, inSize, header, error) || !checkFormat(header, error) ||
+            !plainSize(header, inSize, size, error)) {
+            return false;
+        }
+        if (outCapacity < size) {
+            error = "Output buffer is too small (" + std::to_string(size) + " bytes needed).";
+            return false;
+        }
+
+        const uint8_t* data = in + CryptFormat::dataOffset(header);
+        std::string computedMD5;
+        bool ok;
+        if (CryptFormat::isLegacy(header.algId)) {
+            // The session's cipher already holds the key; the file's IV is the nonce.
+            ok = m_context.gcm->open(header.iv.data(), header.iv.size(), nullptr, 0, data, size,
+                data + size, CryptFormat::TAG_SIZE, out);
+            if (!ok) {
+                error = "Authentication failed - invalid key or corrupted file.";
+            }
+            else {
+                uint8_t hash[CryptFormat::MD5_SIZE];
+                m_context.digest->init();
+                m_context.digest->update(out, size);
+                m_context.digest->final(hash);
+                computedMD5 = FileValidator::toHex(hash, sizeof(hash));
+            }
+        }
+        else {
+            ok = ChunkedCipher::decryptBuffer(data, inSize - (data - in), out, m_context, header.iv,
+                header.chunkSize, computedMD5, error);
+        }
+
+        if (ok && CryptFormat::isSegmented(header.algId)) {
+            ok = SegmentedCipher::verifyDigests(out, size, header, error);
+        }
+        else if (ok && computedMD5 != header.md5) {
+            error = "File integrity check failed - possible corruption.";
+            ok = false;
+        }
+
+        if (!ok) {
+            std::memset(out, 0, size);
+            return false;
+        }
+        outSize = size;
+        return true;
+    }
+    catch (const std::exception& e) {
+        error = std::string("Decryption error: ") + e.what();
+        return false;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,89 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <cryptopp/osrng.h>
+#include "ChunkedCipher.h"
+#include "IOEngine.h"
+
+// Key schedule, random pool and record buffers kept across files, so bulk work
+// pays for key expansion, RNG seeding and buffer allocation once rather than
+// per file. A session is not thread-safe; give each worker thread its own.
+class EncryptionSession {
+public:
+    EncryptionSession();
+
+    EncryptionSession(const EncryptionSession&) = delete;
+    EncryptionSession& operator=(const EncryptionSession&) = delete;
+
+    bool setKey(const std::vector<uint8_t>& key, bool aes128, std::string& error);
+
+    // Overlaps reading, encryption and writing on three threads for files of
+    // more than one chunk. Worth it for single files; folder workers already
+    // overlap with each other.
+    void setPipelined(bool pipelined) { m_pipelined = pipelined; }
+
+    // Writes the chunked format; a partial output is removed on failure.
+    bool encryptFile(const std::string& inputPath, const std::string& outputPath, std::string& error);
+
+    // Same format through an engine that has write buffers. Chunks are sealed
+    // straight into write buffers at their final offsets, and the engine's block
+    // size is the chunk size.
+    bool encryptFile(const std::string& inputPath, const std::string& outputPath, IOEngine& engine,
+                     std::string& error);
+
+    // Buffer-level encryption into the same layout as encryptFile, for data that
+    // is already in memory. `out` must hold encryptedSize(inSize) bytes and
+    // receives exactly that many; nothing is copied on the way.
+    static uint64_t encryptedSize(uint64_t plainSize);
+    bool encrypt(const uint8_t* in, size_t inSize, uint8_t* out, size_t outCapacity, size_t& outSize,
+                 std::string& error);
+
+private:
+    bool m_keyed;
+    bool m_pipelined;
+    uint8_t m_algId;
+    CryptoPP::AutoSeededRandomPool m_rng;
+    ChunkedCipher::EncryptContext m_context;
+};
+
+class DecryptionSession {
+public:
+    DecryptionSession();
+
+    DecryptionSession(const DecryptionSession&) = delete;
+    DecryptionSession& operator=(const DecryptionSession&) = delete;
+
+    bool setKey(const std::vector<uint8_t>& key, bool aes128, std::string& error);
+
+    // As for EncryptionSession; applies to chunked files.
+    void setPipelined(bool pipelined) { m_pipelined = pipelined; }
+
+    // Accepts every format of the session's key size. Segmented files are
+    // decrypted on `jobs` threads; the output only appears once verified.
+    bool decryptFile(const std::string& inputPath, const std::string& outputPath, size_t jobs, std::string& error);
+
+    // Writes plaintext bytes [offset, offset + length) of a chunked or segmented
+    // file, reading and authenticating only the records that cover them. The
+    // whole-file MD5 is not checked; every record's GCM tag still is.
+    bool decryptRange(const std::string& inputPath, uint64_t offset, uint64_t length, std::ostream& out,
+                      std::string& error);
+
+    // Buffer-level decryption of any non-archive format. decryptedSize reads
+    // only the header, so it needs no key. Nothing is returned unverified: on
+    // failure the output buffer is zeroed.
+    static bool decryptedSize(const uint8_t* in, size_t inSize, size_t& plainSize, std::string& error);
+    bool decrypt(const uint8_t* in, size_t inSize, uint8_t* out, size_t outCapacity, size_t& outSize,
+                 std::string& error);
+
+private:
+    bool openHeader(std::ifstream& in, const std::string& inputPath, CryptFormat::Header& header,
+                    std::string& error);
+    bool checkFormat(const CryptFormat::Header& header, std::string& error) const;
+    static bool plainSize(const CryptFormat::Header& header, size_t inSize, size_t& size, std::string& error);
+
+    bool m_keyed;
+    bool m_pipelined;
+    bool m_aes128;
+    std::vector<uint8_t> m_key; // legacy and segmented files key their own ciphers
+    ChunkedCipher::DecryptContext m_context;
+};
\ No newline at end of file
@@ -0,0 +1,702 @@
+#include "Daemon.h"
+#include "KeyCache.h"
+#include "ThreadPool.h"
+#include "FileView.h"
+#include "Hashing.h"
+#include "Base64Stream.h"
+#include "FileSystem.h"
+#include "AlgorithmIdentifier.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#ifndef _WIN32
+#include <cerrno>
+#include <csignal>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace {
+    void putU32(std::string& out, uint32_t value) {
+        for (int i = 0; i < 4; ++i) {
+            out.push_back(static_cast<char>((value >> (8 * i)) & 0xff));
+        }
+    }
+
+    // Reads a u32 at `offset` and advances it; false past the end of `body`.
+    bool getU32(const std::string& body, size_t& offset, uint32_t& value) {
+        if (offset > body.size() || body.size() - offset < 4) {
+            return false;
+        }
+        value = 0;
+        for (int i = 0; i < 4; ++i) {
+            value |= static_cast<uint32_t>(static_cast<uint8_t>(body[offset + i])) << (8 * i);
+        }
+        offset += 4;
+        return true;
+    }
+
+    bool getBytes(const std::string& body, size_t& offset, std::string& value) {
+        uint32_t length;
+        if (!getU32(body, offset, length) || body.size() - offset < length) {
+            return false;
+        }
+        value.assign(body, offset, length);
+        offset += length;
+        return true;
+    }
+
+    void frame(std::string& out, const std::string& body) {
+        putU32(out, static_cast<uint32_t>(body.size()));
+        out += body;
+    }
+
+    std::string encodeRequest(const Daemon::Request& request) {
+        std::string body;
+        putU32(body, request.id);
+        body.push_back(static_cast<char>(request.op));
+        body.push_back(static_cast<char>(request.flags));
+        putU32(body, static_cast<uint32_t>(request.fields.size()));
+        for (const auto& field : request.fields) {
+            putU32(body, static_cast<uint32_t>(field.size()));
+            body += field;
+        }
+        std::string out;
+        frame(out, body);
+        return out;
+    }
+
+    bool parseRequest(const std::string& body, Daemon::Request& request) {
+        size_t offset = 0;
+        uint32_t count;
+        if (!getU32(body, offset, request.id) || body.size() - offset < 2) {
+            return false;
+        }
+        request.op = static_cast<uint8_t>(body[offset++]);
+        request.flags = static_cast<uint8_t>(body[offset++]);
+        if (!getU32(body, offset, count) || count > body.size()) {
+            return false;
+        }
+        request.fields.resize(count);
+        for (auto& field : request.fields) {
+            if (!getBytes(body, offset, field)) {
+                return false;
+            }
+        }
+        return offset == body.size();
+    }
+
+    std::string encodeResponse(const Daemon::Response& response) {
+        std::string body;
+        putU32(body, response.id);
+        body.push_back(static_cast<char>(response.status));
+        putU32(body, static_cast<uint32_t>(response.payload.size()));
+        body += response.payload;
+        std::string out;
+        frame(out, body);
+        return out;
+    }
+
+    bool parseResponse(const std::string& body, Daemon::Response& response) {
+        size_t offset = 0;
+        if (!getU32(body, offset, response.id) || offset >= body.size()) {
+            return false;
+        }
+        response.status = static_cast<uint8_t>(body[offset++]);
+        return getBytes(body, offset, response.payload) && offset == body.size();
+    }
+
+    // In the order --all prints them.
+    std::vector<Hashing::Algorithm> hashAlgorithms(uint8_t flags) {
+        std::vector<Hashing::Algorithm> algs;
+        if (flags & Daemon::MD5_FLAG) {
+            algs.push_back(Hashing::MD5_ALG);
+        }
+        if (flags & Daemon::SHA1_FLAG) {
+            algs.push_back(Hashing::SHA1_ALG);
+        }
+        if ((flags & Daemon::SHA256_FLAG) || algs.empty()) {
+            algs.push_back(Hashing::SHA256_ALG);
+        }
+        return algs;
+    }
+
+    // The input field as bytes: the field itself with DATA_FLAG, otherwise the
+    // file it names, mapped into `file`.
+    bool inputData(const Daemon::Request& request, FileView& file, const uint8_t*& data, size_t& size,
+        std::string& error) {
+        const std::string& input = request.fields[0];
+        if (request.flags & Daemon::DATA_FLAG) {
+            data = reinterpret_cast<const uint8_t*>(input.data());
+            size = input.size();
+            return true;
+        }
+        if (!file.open(input)) {
+            error = "Cannot open input file: " + input;
+            return false;
+        }
+        data = file.data();
+        size = file.size();
+        return true;
+    }
+
+#ifndef _WIN32
+    volatile std::sig_atomic_t signalled = 0;
+    int wakeFd = -1;    // write end of the pipe the accept loop polls
+
+    // Also wakes the accept loop, so a signal that lands just before it starts
+    // waiting is not missed.
+    void onSignal(int) {
+        signalled = 1;
+        if (wakeFd >= 0) {
+            int saved = errno;
+            ssize_t ignored = ::write(wakeFd, "s", 1);
+            (void)ignored;
+            errno = saved;
+        }
+    }
+
+    bool setFlags(int fd, int flags) {
+        int current = ::fcntl(fd, F_GETFL);
+        return current >= 0 && ::fcntl(fd, F_SETFL, current | flags) == 0 &&
+            ::fcntl(fd, F_SETFD, FD_CLOEXEC) == 0;
+    }
+
+    // SIGINT and SIGTERM should interrupt the serving thread only.
+    void blockStopSignals() {
+        sigset_t set;
+        sigemptyset(&set);
+        sigaddset(&set, SIGINT);
+        sigaddset(&set, SIGTERM);
+        pthread_sigmask(SIG_BLOCK, &set, nullptr);
+    }
+
+    bool readFully(int fd, void* buffer, size_t size) {
+        char* out = static_cast<char*>(buffer);
+        while (size > 0) {
+            ssize_t got = ::recv(fd, out, size, 0);
+            if (got < 0 && errno == EINTR) {
+                continue;
+            }
+            if (got <= 0) {
+                return false;
+            }
+            out += got;
+            size -= static_cast<size_t>(got);
+        }
+        return true;
+    }
+
+    bool writeFully(int fd, const std::string& data) {
+        const char* in = data.data();
+        size_t size = data.size();
+        while (size > 0) {
+            ssize_t sent = ::send(fd, in, size, MSG_NOSIGNAL);
+            if (sent < 0 && errno == EINTR) {
+                continue;
+            }
+            if (sent <= 0) {
+                return false;
+            }
+            in += sent;
+            size -= static_cast<size_t>(sent);
+        }
+        return true;
+    }
+
+    bool readFrame(int fd, uint32_t maxSize, std::string& body) {
+        uint8_t header[4];
+        if (!readFully(fd, header, sizeof(header))) {
+            return false;
+        }
+        uint32_t length = header[0] | (header[1] << 8) | (header[2] << 16) | (static_cast<uint32_t>(header[3]) << 24);
+        if (length > maxSize) {
+            return false;
+        }
+        body.resize(length);
+        return length == 0 || readFully(fd, &body[0], length);
+    }
+
+    bool socketAddress(const std::string& path, sockaddr_un& address, std::string& error) {
+        std::memset(&address, 0, sizeof(address));
+        address.sun_family = AF_UNIX;
+        if (path.empty() || path.size() >= sizeof(address.sun_path)) {
+            error = "Invalid socket path: " + path;
+            return false;
+        }
+        std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+        return true;
+    }
+
+    int connectTo(const std::string& path, std::string& error) {
+        sockaddr_un address;
+        if (!socketAddress(path, address, error)) {
+            return -1;
+        }
+        int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0) {
+            error = std::string("Cannot create socket: ") + std::strerror(errno);
+            return -1;
+        }
+        if (::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+            error = "Cannot connect to " + path + ": " + std::strerror(errno);
+            ::close(fd);
+            return -1;
+        }
+        return fd;
+    }
+
+    // A socket file nobody answers on is left over from a daemon that died, and
+    // is replaced; a live one is not.
+    int listenOn(const std::string& path, std::string& error) {
+        sockaddr_un address;
+        if (!socketAddress(path, address, error)) {
+            return -1;
+        }
+
+        std::string probeError;
+        int probe = connectTo(path, probeError);
+        if (probe >= 0) {
+            ::close(probe);
+            error = "A daemon is already listening on " + path;
+            return -1;
+        }
+        struct stat info;
+        if (::lstat(path.c_str(), &info) == 0 && S_ISSOCK(info.st_mode)) {
+            ::unlink(path.c_str());
+        }
+
+        int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0) {
+            error = std::string("Cannot create socket: ") + std::strerror(errno);
+            return -1;
+        }
+        // Jobs run with the daemon's access to keys, so only its owner may connect.
+        mode_t mask = ::umask(0177);
+        bool bound = ::bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0;
+        int bindErrno = errno;
+        ::umask(mask);
+        if (!bound || ::listen(fd, SOMAXCONN) != 0) {
+            error = "Cannot listen on " + path + ": " + std::strerror(bound ? errno : bindErrno);
+            ::close(fd);
+            return -1;
+        }
+        return fd;
+    }
+
+    struct Connection {
+        explicit Connection(int socket) : fd(socket) {}
+        ~Connection() { ::close(fd); }
+
+        int fd;
+        std::mutex writeMutex;
+        std::mutex mutex;
+        std::condition_variable changed;
+        size_t inFlight = 0;
+    };
+#endif
+}
+
+std::string Daemon::defaultSocketPath() {
+    const char* runtime = std::getenv("XDG_RUNTIME_DIR");
+    if (runtime && *runtime) {
+        return std::string(runtime) + "/anucrypt.sock";
+    }
+#ifdef _WIN32
+    return "anucrypt.sock";
+#else
+    return "/tmp/anucrypt-" + std::to_string(::getuid()) + ".sock";
+#endif
+}
+
+bool Daemon::execute(const Request& request, KeyCache& keys, std::string& payload, std::string& error) {
+    const size_t fieldCount = request.op == ENCRYPT_OP || request.op == DECRYPT_OP ? 3 : 1;
+    const bool optionalOutput = request.op == ENCODE_OP || request.op == DECODE_OP;
+    if (request.fields.size() != fieldCount && !(optionalOutput && request.fields.size() == fieldCount + 1)) {
+        error = "Malformed request.";
+        return false;
+    }
+
+    switch (request.op) {
+    case ENCRYPT_OP: {
+        KeyCache::Lease<EncryptionSession> session;
+        if (!keys.encryptor(request.fields[0], (request.flags & AES128_FLAG) != 0, session, error) ||
+            !session->encryptFile(request.fields[1], request.fields[2], error)) {
+            return false;
+        }
+        payload = request.fields[2];
+        return true;
+    }
+    case DECRYPT_OP: {
+        KeyCache::Lease<DecryptionSession> session;
+        if (!keys.decryptor(request.fields[0], (request.flags & AES128_FLAG) != 0, session, error) ||
+            !session->decryptFile(request.fields[1], request.fields[2], 1, error)) {
+            return false;
+        }
+        payload = request.fields[2];
+        return true;
+    }
+    case HASH_OP: {
+        std::vector<Hashing::Algorithm> algs = hashAlgorithms(request.flags);
+        FileView file;
+        const uint8_t* data;
+        size_t size;
+        if (!inputData(request, file, data, size, error)) {
+            return false;
+        }
+        std::vector<Digest> digests = Hashing::digestData(data, size, algs);
+        for (size_t i = 0; i < digests.size(); ++i) {
+            if (i > 0) {
+                payload += "\n";
+            }
+            if (digests.size() > 1) {
+                payload += std::string(Hashing::algorithmName(algs[i])) + ": ";
+            }
+            payload += digests[i].hex();
+        }
+        return true;
+    }
+    case ENCODE_OP:
+    case DECODE_OP: {
+        Base64Codec::Options options;
+        if (request.flags & NOWRAP_FLAG) {
+            options.lineLength = 0;
+        }
+        if (request.flags & URL_FLAG) {
+            options.alphabet = Base64Codec::URL_SAFE;
+        }
+        // Through Base64Stream, so decoding is as strict as --decode and reports
+        // the offset of a bad character.
+        std::ifstream file;
+        std::istringstream text;
+        if (request.flags & DATA_FLAG) {
+            text.str(request.fields[0]);
+        }
+        else {
+            file.open(request.fields[0], std::ios::binary);
+            if (!file.is_open()) {
+                error = "Cannot open input file: " + request.fields[0];
+                return false;
+            }
+        }
+        std::istream& in = file.is_open() ? static_cast<std::istream&>(file) : text;
+
+        if (request.fields.size() > 1) {
+            const std::string& outputPath = request.fields[1];
+            std::ofstream out(outputPath, std::ios::binary);
+            if (!out.is_open()) {
+                error = "Cannot create output file: " + outputPath;
+                return false;
+            }
+            bool ok = request.op == ENCODE_OP
+                ? Base64Stream::encode(in, out, options, error)
+                : Base64Stream::decode(in, out, options, error);
+            if (ok && request.op == ENCODE_OP) {
+                out << '\n';
+            }
+            out.close();
+            if (ok && !out) {
+                error = "Failed writing output file: " + outputPath;
+                ok = false;
+            }
+            if (!ok) {
+                std::remove(outputPath.c_str());
+                return false;
+            }
+            payload = outputPath;
+            return true;
+        }
+
+        // Without an output path the result travels in the reply, which has to fit in one frame.
+        auto tooLarge = [&error](uint64_t size) {
+            error = "Result of " + std::to_string(size) + " bytes is too large to return; give an output path.";
+            return false;
+        };
+        if (request.op == ENCODE_OP && file.is_open()) {
+            std::error_code ec;
+            uint64_t inputSize = fs::file_size(request.fields[0], ec);
+            uint64_t encodedSize = ec ? 0 : Base64Codec::encodedSize(static_cast<size_t>(inputSize), options);
+            if (encodedSize > MAX_PAYLOAD_SIZE) {
+                return tooLarge(encodedSize);
+            }
+        }
+        std::ostringstream out;
+        bool ok = request.op == ENCODE_OP
+            ? Base64Stream::encode(in, out, options, error)
+            : Base64Stream::decode(in, out, options, error);
+        if (!ok) {
+            return false;
+        }
+        payload = out.str();
+        if (payload.size() > MAX_PAYLOAD_SIZE) {
+            uint64_t size = payload.size();
+            payload.clear();
+            return tooLarge(size);
+        }
+        return true;
+    }
+    case IDENTIFY_OP: {
+        AlgorithmIdentifier::AlgorithmType alg = (request.flags & DATA_FLAG)
+            ? AlgorithmIdentifier::identifyFromText(request.fields[0])
+            : AlgorithmIdentifier::identifyFromFile(request.fields[0]);
+        payload = AlgorithmIdentifier::algorithmToString(alg);
+        return true;
+    }
+    default:
+        error = "Unknown request type " + std::to_string(request.op) + ".";
+        return false;
+    }
+}
+
+#ifdef _WIN32
+bool Daemon::serve(const Options&, std::ostream*, std::string& error) {
+    error = "Daemon mode needs Unix domain sockets, which this build does not support.";
+    return false;
+}
+
+bool Daemon::call(const std::string&, const std::vector<Request>&, std::vector<Response>&, std::string& error) {
+    error = "Daemon mode needs Unix domain sockets, which this build does not support.";
+    return false;
+}
+#else
+bool Daemon::serve(const Options& options, std::ostream* log, std::string& error) {
+    // Workers and connection threads inherit the blocked mask; only this
+    // thread sees the signals, while it waits for a connection.
+    blockStopSignals();
+    KeyCache keys;
+    ThreadPool pool(std::max<size_t>(1, options.jobs));
+
+    int listener = listenOn(options.socketPath, error);
+    if (listener < 0) {
+        return false;
+    }
+
+    // The loop waits on the listener and on this pipe, which signals and
+    // SHUTDOWN_OP write to.
+    int wake[2];
+    if (::pipe(wake) != 0 || !setFlags(wake[0], O_NONBLOCK) || !setFlags(wake[1], O_NONBLOCK) ||
+        !setFlags(listener, O_NONBLOCK)) {
+        error = std::string("Cannot set up the listening socket: ") + std::strerror(errno);
+        ::close(listener);
+        ::unlink(options.socketPath.c_str());
+        return false;
+    }
+    wakeFd = wake[1];
+
+    signalled = 0;
+    struct sigaction action;
+    std::memset(&action, 0, sizeof(action));
+    action.sa_handler = onSignal;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGINT, &action, nullptr);
+    sigaction(SIGTERM, &action, nullptr);
+    std::signal(SIGPIPE, SIG_IGN);
+
+    sigset_t stopSignals;
+    sigemptyset(&stopSignals);
+    sigaddset(&stopSignals, SIGINT);
+    sigaddset(&stopSignals, SIGTERM);
+
+    std::atomic<bool> stopping(false);
+    std::mutex connectionsMutex;
+    std::condition_variable connectionsDone;
+    std::list<std::shared_ptr<Connection>> connections;
+
+    if (log) {
+        *log << "Listening on " << options.socketPath << " with " << pool.size() << " worker(s)" << std::endl;
+    }
+
+    auto serveConnection = [&](std::shared_ptr<Connection> connection) {
+        std::string body;
+        while (!stopping && readFrame(connection->fd, MAX_FRAME_SIZE, body)) {
+            std::shared_ptr<Request> request = std::make_shared<Request>();
+            if (!parseRequest(body, *request)) {
+                Response response;
+                response.payload = "Malformed request.";
+                std::lock_guard<std::mutex> lock(connection->writeMutex);
+                writeFully(connection->fd, encodeResponse(response));
+                break;
+            }
+
+            if (request->op == SHUTDOWN_OP) {
+                Response response;
+                response.id = request->id;
+                response.status = OK;
+                {
+                    std::lock_guard<std::mutex> lock(connection->writeMutex);
+                    writeFully(connection->fd, encodeResponse(response));
+                }
+                stopping = true;
+                ssize_t ignored = ::write(wake[1], "q", 1);
+                (void)ignored;
+                break;
+            }
+
+            {
+                std::unique_lock<std::mutex> lock(connection->mutex);
+                connection->changed.wait(lock, [&] { return connection->inFlight < MAX_IN_FLIGHT; });
+                ++connection->inFlight;
+            }
+            pool.submit([&keys, connection, request] {
+                Response response;
+                response.id = request->id;
+                std::string error;
+                bool ok;
+                try {
+                    ok = execute(*request, keys, response.payload, error);
+                }
+                catch (const std::exception& e) {
+                    error = e.what();
+                    ok = false;
+                }
+                if (ok) {
+                    response.status = OK;
+                }
+                else {
+                    response.payload = error;
+                }
+
+                std::string reply = encodeResponse(response);
+                {
+                    std::lock_guard<std::mutex> lock(connection->writeMutex);
+                    writeFully(connection->fd, reply);
+                }
+                std::lock_guard<std::mutex> lock(connection->mutex);
+                --connection->inFlight;
+                connection->changed.notify_all();
+            });
+        }
+
+        std::unique_lock<std::mutex> lock(connection->mutex);
+        connection->changed.wait(lock, [&] { return connection->inFlight == 0; });
+    };
+
+    pollfd waits[2];
+    waits[0].fd = listener;
+    waits[0].events = POLLIN;
+    waits[1].fd = wake[0];
+    waits[1].events = POLLIN;
+    while (!stopping && !signalled) {
+        pthread_sigmask(SIG_UNBLOCK, &stopSignals, nullptr);
+        int ready = ::poll(waits, 2, -1);
+        int pollErrno = errno;
+        pthread_sigmask(SIG_BLOCK, &stopSignals, nullptr);
+        if (ready < 0) {
+            if (pollErrno == EINTR) {
+                continue;
+            }
+            error = std::string("Waiting for connections failed: ") + std::strerror(pollErrno);
+            break;
+        }
+        if (waits[1].revents || !(waits[0].revents & POLLIN)) {
+            continue;
+        }
+
+        int fd = ::accept(listener, nullptr, nullptr);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED || errno == EAGAIN || errno == EWOULDBLOCK) {
+                continue;
+            }
+            error = std::string("Accept failed: ") + std::strerror(errno);
+            break;
+        }
+        // Some systems pass O_NONBLOCK on from the listener; connections block.
+        int flags = ::fcntl(fd, F_GETFL);
+        if (flags >= 0) {
+            ::fcntl(fd, F_SETFL, flags & ~O_NONBLOCK);
+        }
+        ::fcntl(fd, F_SETFD, FD_CLOEXEC);
+
+        std::shared_ptr<Connection> connection = std::make_shared<Connection>(fd);
+        std::list<std::shared_ptr<Connection>>::iterator entry;
+        {
+            std::lock_guard<std::mutex> lock(connectionsMutex);
+            entry = connections.insert(connections.end(), connection);
+        }
+        std::thread([&, connection, entry] {
+            serveConnection(connection);
+            std::lock_guard<std::mutex> lock(connectionsMutex);
+            connections.erase(entry);
+            connectionsDone.notify_all();
+        }).detach();
+    }
+
+    // Readers stop at their next frame; jobs already queued still get replies.
+    stopping = true;
+    {
+        std::unique_lock<std::mutex> lock(connectionsMutex);
+        for (const auto& connection : connections) {
+            ::shutdown(connection->fd, SHUT_RD);
+        }
+        connectionsDone.wait(lock, [&] { return connections.empty(); });
+    }
+    pool.wait();
+
+    wakeFd = -1;
+    ::close(wake[0]);
+    ::close(wake[1]);
+    ::close(listener);
+    ::unlink(options.socketPath.c_str());
+    if (log) {
+        *log << "Daemon stopped" << std::endl;
+    }
+    return error.empty();
+}
+
+bool Daemon::call(const std::string& socketPath, const std::vector<Request>& requests,
+    std::vector<Response>& responses, std::string& error) {
+    int fd = connectTo(socketPath, error);
+    if (fd < 0) {
+        return false;
+    }
+
+    // Requests go out on their own thread so a large batch cannot fill both
+    // directions of the socket at once.
+    std::atomic<bool> sendFailed(false);
+    std::thread sender([&] {
+        for (size_t i = 0; i < requests.size(); ++i) {
+            Request request = requests[i];
+            request.id = static_cast<uint32_t>(i);
+            if (!writeFully(fd, encodeRequest(request))) {
+                sendFailed = true;
+                break;
+            }
+        }
+    });
+
+    responses.assign(requests.size(), Response());
+    std::string body;
+    bool ok = true;
+    for (size_t received = 0; received < requests.size(); ++received) {
+        Response response;
+        if (!readFrame(fd, MAX_FRAME_SIZE, body) || !parseResponse(body, response) ||
+            response.id >= requests.size()) {
+            error = sendFailed ? "Lost the connection to the daemon." : "Bad reply from the daemon.";
+            ok = false;
+            break;
+        }
+        uint32_t index = response.id;
+        responses[index] = std::move(response);
+        responses[index].id = requests[index].id;
+    }
+
+    ::shutdown(fd, SHUT_RDWR);
+    sender.join();
+    ::close(fd);
+    return ok;
+}
+#endif
\ No newline at end of file
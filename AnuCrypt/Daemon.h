@@ -0,0 +1,86 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <iostream>
+#include <cstdint>
+
+class KeyCache;
+
+// Serves encrypt, decrypt, hash, encode, decode and identify jobs over a Unix
+// domain socket, so callers that run thousands of small jobs pay for process
+// start-up, settings, key loading and RNG seeding once. Keys and keyed sessions
+// stay in a KeyCache and jobs run on a pool of warm workers. A connection may
+// have many requests in flight; each reply carries its request's id, and
+// replies come back in the order the jobs finish.
+//
+// Every frame is a little-endian u32 body length followed by the body:
+//   request:  u32 id, u8 op, u8 flags, u32 field count, fields as u32 length + bytes
+//   response: u32 id, u8 status, u32 length + payload (the result or the error)
+// Paths are opened by the daemon, so clients should send absolute ones. Results
+// that go to an output path reply with that path; a result sent back in the
+// reply is limited to MAX_PAYLOAD_SIZE.
+class Daemon {
+public:
+    enum Op {
+        ENCRYPT_OP = 1,     // key path, input path, output path; AES128_FLAG
+        DECRYPT_OP = 2,     // key path, input path, output path; AES128_FLAG
+        HASH_OP = 3,        // input; MD5_FLAG, SHA1_FLAG, SHA256_FLAG (SHA-256 when none)
+        ENCODE_OP = 4,      // input, optional output path; NOWRAP_FLAG, URL_FLAG
+        DECODE_OP = 5,      // input, optional output path; URL_FLAG
+        IDENTIFY_OP = 6,    // input
+        SHUTDOWN_OP = 7     // stops the daemon once running jobs are done
+    };
+
+    enum Status {
+        OK = 0,
+        FAILED = 1
+    };
+
+    static const uint8_t AES128_FLAG = 0x01;
+    static const uint8_t MD5_FLAG = 0x01;
+    static const uint8_t SHA1_FLAG = 0x02;
+    static const uint8_t SHA256_FLAG = 0x04;
+    static const uint8_t NOWRAP_FLAG = 0x01;
+    static const uint8_t URL_FLAG = 0x02;
+    static const uint8_t DATA_FLAG = 0x80;     // the input field is the data, not a path
+
+    struct Request {
+        uint32_t id = 0;
+        uint8_t op = 0;
+        uint8_t flags = 0;
+        std::vector<std::string> fields;
+    };
+
+    struct Response {
+        uint32_t id = 0;
+        uint8_t status = FAILED;
+        std::string payload;
+    };
+
+    struct Options {
+        std::string socketPath;
+        size_t jobs = 1;
+    };
+
+    // Runs until a SHUTDOWN_OP request, SIGINT or SIGTERM, then removes the
+    // socket. The socket is only accessible to its owner.
+    static bool serve(const Options& options, std::ostream* log, std::string& error);
+
+    // Sends every request down one connection without waiting for replies,
+    // and returns the replies in request order.
+    static bool call(const std::string& socketPath, const std::vector<Request>& requests,
+                     std::vector<Response>& responses, std::string& error);
+
+    // $XDG_RUNTIME_DIR/anucrypt.sock, or /tmp/anucrypt-<uid>.sock without it.
+    static std::string defaultSocketPath();
+
+    // Runs one job in this process; payload receives what its reply would carry.
+    static bool execute(const Request& request, KeyCache& keys, std::string& payload, std::string& error);
+
+private:
+
+    static const uint32_t MAX_FRAME_SIZE = 256u << 20;
+    // A response body is id, status and payload length before the payload.
+    static const uint32_t MAX_PAYLOAD_SIZE = MAX_FRAME_SIZE - 9;
+    static const size_t MAX_IN_FLIGHT = 64;    // per connection
+};
\ No newline at end of file
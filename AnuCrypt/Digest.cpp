@@ -0,0 +1,41 @@
+#include "Digest.h"
+
+std::string Digest::hex() const {
+    char buffer[HEX_CAPACITY];
+    return std::string(buffer, toHex(buffer));
+}
+
+size_t Digest::toHex(const uint8_t* data, size_t size, char* out) {
+    static const char digits[] = "0123456789ABCDEF";
+    for (size_t i = 0; i < size; ++i) {
+        out[2 * i] = digits[data[i] >> 4];
+        out[2 * i + 1] = digits[data[i] & 0x0F];
+    }
+    return size * 2;
+}
+
+size_t Digest::toBase64(const uint8_t* data, size_t size, char* out) {
+    static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    size_t written = 0;
+    size_t i = 0;
+    for (; i + 3 <= size; i += 3) {
+        uint32_t triple = (data[i] << 16) | (data[i + 1] << 8) | data[i + 2];
+        out[written++] = alphabet[(triple >> 18) & 0x3F];
+        out[written++] = alphabet[(triple >> 12) & 0x3F];
+        out[written++] = alphabet[(triple >> 6) & 0x3F];
+        out[written++] = alphabet[triple & 0x3F];
+    }
+
+    size_t remaining = size - i;
+    if (remaining > 0) {
+        uint32_t triple = data[i] << 16;
+        if (remaining == 2) {
+            triple |= data[i + 1] << 8;
+        }
+        out[written++] = alphabet[(triple >> 18) & 0x3F];
+        out[written++] = alphabet[(triple >> 12) & 0x3F];
+        out[written++] = remaining == 2 ? alphabet[(triple >> 6) & 0x3F] : '=';
+        out[written++] = '=';
+    }
+    return written;
+}
\ No newline at end of file
@@ -0,0 +1,35 @@
+#pragma once
+#include <array>
+#include <algorithm>
+#include <string>
+#include <cstdint>
+
+typedef std::array<uint8_t, 16> MD5Digest;
+typedef std::array<uint8_t, 20> SHA1Digest;
+typedef std::array<uint8_t, 32> SHA256Digest;
+
+// Digest of any supported algorithm, stored inline so it can be returned and
+// copied without touching the heap. Formatting writes into caller buffers.
+struct Digest {
+    static const size_t MAX_SIZE = 32;
+    static const size_t HEX_CAPACITY = MAX_SIZE * 2;
+    static const size_t BASE64_CAPACITY = (MAX_SIZE + 2) / 3 * 4;
+
+    std::array<uint8_t, MAX_SIZE> bytes;
+    size_t size;
+
+    const uint8_t* data() const { return bytes.data(); }
+
+    bool operator==(const Digest& other) const {
+        return size == other.size && std::equal(bytes.begin(), bytes.begin() + size, other.bytes.begin());
+    }
+    bool operator!=(const Digest& other) const { return !(*this == other); }
+
+    size_t toHex(char* out) const { return toHex(bytes.data(), size, out); }
+    size_t toBase64(char* out) const { return toBase64(bytes.data(), size, out); }
+    std::string hex() const;
+
+    // Uppercase hex (2 * size chars) and padded Base64 ((size + 2) / 3 * 4 chars).
+    static size_t toHex(const uint8_t* data, size_t size, char* out);
+    static size_t toBase64(const uint8_t* data, size_t size, char* out);
+};
\ No newline at end of file
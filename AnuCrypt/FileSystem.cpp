@@ -0,0 +1,16 @@
+#include "FileSystem.h"
+#include <cstdio>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#endif
+
+bool replaceFile(const std::string& from, const std::string& to) {
+#ifdef _WIN32
+    // rename() fails on Windows when the target exists.
+    return MoveFileExA(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+    return std::rename(from.c_str(), to.c_str()) == 0;
+#endif
+}
\ No newline at end of file
@@ -0,0 +1,46 @@
+#pragma once
+#include <string>
+#define _SILENCE_EXPERIMENTAL_FILESYSTEM_DEPRECATION_WARNING
+#if defined(_MSC_VER) && (_MSC_VER >= 1910)
+#include <experimental/filesystem>
+namespace fs = std::experimental::filesystem;
+#else
+#include <filesystem>
+namespace fs = std::filesystem;
+#endif
+
+inline std::string getRelativePath(const fs::path& fullPath, const fs::path& baseDir) {
+    std::string fullPathStr = fullPath.string();
+    std::string baseDirStr = baseDir.string();
+
+    if (!baseDirStr.empty() && baseDirStr.back() != '\\' && baseDirStr.back() != '/') {
+        baseDirStr += static_cast<char>(fs::path::preferred_separator);
+    }
+
+    if (fullPathStr.substr(0, baseDirStr.length()) == baseDirStr) {
+        return fullPathStr.substr(baseDirStr.length());
+    }
+
+    return fullPathStr;
+}
+
+// fs::absolute(path, ec) only exists in std::filesystem; this works with both.
+// False when the working directory cannot be determined.
+inline bool getAbsolutePath(const std::string& path, std::string& absolutePath) {
+    fs::path relative(path);
+    if (relative.is_absolute()) {
+        absolutePath = path;
+        return true;
+    }
+    std::error_code ec;
+    fs::path current = fs::current_path(ec);
+    if (ec || current.empty()) {
+        return false;
+    }
+    absolutePath = (current / relative).string();
+    return true;
+}
+
+// Moves from over to, replacing any existing file in one step, so a crash
+// leaves either the old file or the new one in place.
+bool replaceFile(const std::string& from, const std::string& to);
\ No newline at end of file
@@ -1,30 +1,21 @@
 #include "FileValidator.h"
-#include <fstream>
-#include <cryptopp/md5.h>
-#include <cryptopp/hex.h>
-#include <cryptopp/filters.h>
-#include <cryptopp/files.h>
+#include "Hashing.h"
 
 std::string FileValidator::computeMD5(const std::string& filename) {
-    try {
-        CryptoPP::MD5 md5;
-        std::string hash;
-        
-        CryptoPP::FileSource fs(filename.c_str(), true,
-            new CryptoPP::HashFilter(md5,
-                new CryptoPP::HexEncoder(
-                    new CryptoPP::StringSink(hash)
-                )
-            )
-        );
-        
-        return hash;
-    } catch (...) {
+    Digest digest;
+    if (!Hashing::digestFile(filename, Hashing::MD5_ALG, digest)) {
         return "";
     }
+    return digest.hex();
 }
 
 bool FileValidator::verifyMD5(const std::string& filename, const std::string& expectedHash) {
     std::string actualHash = computeMD5(filename);
     return actualHash == expectedHash;
+}
+
+std::string FileValidator::toHex(const uint8_t* digest, size_t size) {
+    std::string hex(size * 2, '\0');
+    Digest::toHex(digest, size, &hex[0]);
+    return hex;
 }
\ No newline at end of file
@@ -1,8 +1,10 @@
 #pragma once
 #include <string>
+#include <cstdint>
 
 class FileValidator {
 public:
     static std::string computeMD5(const std::string& filename);
     static bool verifyMD5(const std::string& filename, const std::string& expectedHash);
+    static std::string toHex(const uint8_t* digest, size_t size);
 };
\ No newline at end of file
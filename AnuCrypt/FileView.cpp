@@ -0,0 +1,141 @@
+#include "FileView.h"
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+FileView::FileView() : m_data(nullptr), m_size(0), m_mapped(false) {
+}
+
+FileView::~FileView() {
+    close();
+}
+
+void FileView::close() {
+    if (m_mapped) {
+#ifdef _WIN32
+        UnmapViewOfFile(m_data);
+#else
+        munmap(const_cast<uint8_t*>(m_data), m_size);
+#endif
+    }
+    m_data = nullptr;
+    m_size = 0;
+    m_mapped = false;
+    std::vector<uint8_t>().swap(m_buffer);
+}
+
+#ifdef _WIN32
+
+bool FileView::open(const std::string& path) {
+    close();
+
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr,
+        OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    LARGE_INTEGER size;
+    if (GetFileType(file) != FILE_TYPE_DISK || !GetFileSizeEx(file, &size)) {
+        bool ok = readAll(file);
+        CloseHandle(file);
+        return ok;
+    }
+
+    if (size.QuadPart == 0) {
+        CloseHandle(file);
+        return true;
+    }
+    if (static_cast<unsigned long long>(size.QuadPart) > SIZE_MAX) {
+        CloseHandle(file);
+        return false;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(file);
+    if (mapping == nullptr) {
+        return false;
+    }
+
+    // The view keeps the mapping alive after its handle is closed.
+    void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mapping);
+    if (view == nullptr) {
+        return false;
+    }
+
+    m_data = static_cast<const uint8_t*>(view);
+    m_size = static_cast<size_t>(size.QuadPart);
+    m_mapped = true;
+    return true;
+}
+
+bool FileView::readAll(void* file) {
+    uint8_t block[64 * 1024];
+    DWORD got = 0;
+    while (ReadFile(static_cast<HANDLE>(file), block, sizeof(block), &got, nullptr) && got > 0) {
+        m_buffer.insert(m_buffer.end(), block, block + got);
+    }
+    m_data = m_buffer.data();
+    m_size = m_buffer.size();
+    return true;
+}
+
+#else
+
+bool FileView::open(const std::string& path) {
+    close();
+
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || !S_ISREG(info.st_mode)) {
+        bool ok = readAll(fd);
+        ::close(fd);
+        return ok;
+    }
+
+    if (info.st_size == 0) {
+        ::close(fd);
+        return true;
+    }
+
+    void* view = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (view == MAP_FAILED) {
+        return false;
+    }
+    madvise(view, static_cast<size_t>(info.st_size), MADV_SEQUENTIAL);
+
+    m_data = static_cast<const uint8_t*>(view);
+    m_size = static_cast<size_t>(info.st_size);
+    m_mapped = true;
+    return true;
+}
+
+bool FileView::readAll(int fd) {
+    uint8_t block[64 * 1024];
+    ssize_t got;
+    while ((got = ::read(fd, block, sizeof(block))) > 0) {
+        m_buffer.insert(m_buffer.end(), block, block + got);
+    }
+    if (got < 0) {
+        m_buffer.clear();
+        return false;
+    }
+    m_data = m_buffer.data();
+    m_size = m_buffer.size();
+    return true;
+}
+
+#endif
\ No newline at end of file
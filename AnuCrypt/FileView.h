@@ -0,0 +1,36 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <cstdint>
+
+// Read-only view of a whole file. Regular files are memory-mapped (with a
+// sequential-access hint) so callers can read them without a heap copy; pipes,
+// character devices and other special files fall back to a buffered read.
+class FileView {
+public:
+    FileView();
+    ~FileView();
+
+    FileView(const FileView&) = delete;
+    FileView& operator=(const FileView&) = delete;
+
+    bool open(const std::string& path);
+    void close();
+
+    const uint8_t* data() const { return m_data; }
+    size_t size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+    bool isMapped() const { return m_mapped; }
+
+private:
+#ifdef _WIN32
+    bool readAll(void* file);
+#else
+    bool readAll(int fd);
+#endif
+
+    const uint8_t* m_data;
+    size_t m_size;
+    bool m_mapped;
+    std::vector<uint8_t> m_buffer;
+};
\ No newline at end of file
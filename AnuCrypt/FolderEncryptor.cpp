@@ -0,0 +1,189 @@
+#include "FolderEncryptor.h"
+#include "FileSystem.h"
+#include "ThreadPool.h"
+#include "HashCache.h"
+#include "CryptoSession.h"
+#include "CryptFormat.h"
+#include <iostream>
+#include <mutex>
+#include <memory>
+#include <chrono>
+#include <unordered_set>
+
+uint64_t FolderEncryptor::stateTag(const std::vector<uint8_t>& key, bool aes128) {
+    // Only a fingerprint of the key is stored, never the key itself.
+    std::string label = aes128 ? "AnuCrypt folder state AES-128" : "AnuCrypt folder state AES-256";
+    std::vector<uint8_t> data(label.begin(), label.end());
+    data.insert(data.end(), key.begin(), key.end());
+
+    Digest digest = Hashing::digestData(data.data(), data.size(), Hashing::SHA256_ALG);
+    uint64_t tag = 0;
+    for (size_t i = 0; i < 8; ++i) {
+        tag |= static_cast<uint64_t>(digest.bytes[i]) << (8 * i);
+    }
+    return tag;
+}
+
+bool FolderEncryptor::encryptFolder(const std::string& inputDir, const std::string& outputDir,
+    const std::vector<uint8_t>& key, bool aes128, size_t jobs, Summary& summary, std::string& error) {
+    Options options;
+    options.aes128 = aes128;
+    options.jobs = jobs;
+    return encryptFolder(inputDir, outputDir, key, options, summary, error);
+}
+
+bool FolderEncryptor::encryptFolder(const std::string& inputDir, const std::string& outputDir,
+    const std::vector<uint8_t>& key, const Options& options, Summary& summary, std::string& error) {
+    const std::vector<Hashing::Algorithm> stateAlgs = { Hashing::SHA256_ALG };
+    std::mutex outputMutex;
+    bool traversalOk = true;
+
+    std::unique_ptr<HashCache> state;
+    if (!options.statePath.empty()) {
+        state.reset(new HashCache(stateAlgs, stateTag(key, options.aes128)));
+        state->load(options.statePath);
+    }
+
+    // As with the hash cache, files written this close to the run are encrypted
+    // but not recorded, since a further change could leave their metadata as is.
+    const int64_t racyLimit = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count() - RACY_WINDOW_NS;
+    std::unordered_set<std::string> seen;
+
+    {
+        ThreadPool pool(options.jobs, options.jobs * 64);
+
+        // One keyed session per worker, so a file costs no key expansion, RNG
+        // seeding or buffer allocation of its own.
+        std::vector<std::unique_ptr<EncryptionSession>> sessions;
+        for (size_t i = 0; i < pool.size(); ++i) {
+            sessions.emplace_back(new EncryptionSession());
+            if (!sessions.back()->setKey(key, options.aes128, error)) {
+                return false;
+            }
+        }
+        std::vector<std::unique_ptr<IOEngine>> engines;
+        if (options.asyncIO) {
+            for (size_t i = 0; i < pool.size(); ++i) {
+                engines.push_back(IOEngine::create(options.ioBackend, options.ioDepth,
+                    CryptFormat::DEFAULT_CHUNK_SIZE, true, error));
+                if (!engines.back()) {
+                    return false;
+                }
+            }
+            summary.ioBackend = engines.front()->name();
+        }
+
+        try {
+            fs::create_directories(outputDir);
+            for (auto it = fs::recursive_directory_iterator(inputDir);
+                it != fs::recursive_directory_iterator();
+                ++it) {
+                fs::path source = it->path();
+                std::string relative = getRelativePath(source, inputDir);
+                fs::path target = fs::path(outputDir) / relative;
+
+                if (fs::is_directory(it->symlink_status())) {
+                    fs::create_directories(target);
+                    continue;
+                }
+                if (!fs::is_regular_file(it->status())) {
+                    continue;
+                }
+
+                std::string cryptName = target.string() + ".crypt";
+                if (state) {
+                    seen.insert(relative);
+                }
+                pool.submit([&, source, relative, cryptName] {
+                    HashCache::FileStat before;
+                    std::vector<Digest> digests;
+                    bool recordable = false;
+
+                    if (state && HashCache::statFile(source.string(), before)) {
+                        HashCache::FileStat output;
+                        bool outputExists = HashCache::statFile(cryptName, output);
+                        if (outputExists && state->lookup(relative, before, digests)) {
+                            std::lock_guard<std::mutex> lock(outputMutex);
+                            ++summary.skipped;
+                            return;
+                        }
+
+                        // The metadata changed; the contents may not have.
+                        std::vector<Digest> previous;
+                        recordable = Hashing::digestFile(source.string(), stateAlgs, 1, digests) &&
+                            before.mtime < racyLimit;
+                        if (recordable && outputExists && state->find(relative, previous) && previous == digests) {
+                            state->update(relative, before, digests);
+                            std::lock_guard<std::mutex> lock(outputMutex);
+                            ++summary.skipped;
+                            return;
+                        }
+                    }
+
+                    std::string fileError;
+                    size_t worker = pool.workerIndex();
+                    bool success = engines.empty()
+                        ? sessions[worker]->encryptFile(source.string(), cryptName, fileError)
+                        : sessions[worker]->encryptFile(source.string(), cryptName, *engines[worker], fileError);
+
+                    // Only record what was encrypted if the source held still meanwhile.
+                    HashCache::FileStat after;
+                    if (success && recordable && HashCache::statFile(source.string(), after) && after.matches(before)) {
+                        state->update(relative, before, digests);
+                    }
+
+                    std::lock_guard<std::mutex> lock(outputMutex);
+                    if (success) {
+                        ++summary.encrypted;
+                        std::cout << "Encrypted: " << source << " -> " << cryptName << '\n';
+                    }
+                    else {
+                        summary.failures.emplace_back(source.string(), fileError);
+                        std::cerr << "Error encrypting " << source << ": " << fileError << '\n';
+                    }
+                });
+            }
+        }
+        catch (const std::exception& e) {
+            error = e.what();
+            traversalOk = false;
+        }
+
+        pool.wait();
+        for (const auto& engine : engines) {
+            summary.io.add(engine->stats());
+        }
+    }
+
+    if (state) {
+        // Entries for sources that were not seen either name outputs to prune or
+        // are carried over so a later --prune run can still find them. After a
+        // failed traversal "not seen" proves nothing, so nothing is removed.
+        for (const std::string& relative : state->paths()) {
+            if (seen.count(relative)) {
+                continue;
+            }
+            if (options.prune && traversalOk) {
+                std::string cryptName = (fs::path(outputDir) / relative).string() + ".crypt";
+                std::error_code ec;
+                if (fs::remove(cryptName, ec)) {
+                    ++summary.pruned;
+                    std::cout << "Pruned: " << cryptName << '\n';
+                }
+            }
+            else {
+                state->keep(relative);
+            }
+        }
+
+        std::string stateError;
+        if (!state->save(options.statePath, stateError)) {
+            error = "Cannot write state file: " + stateError;
+            traversalOk = false;
+        }
+    }
+
+    std::cout.flush();
+    return traversalOk;
+}
\ No newline at end of file
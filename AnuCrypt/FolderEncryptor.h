@@ -0,0 +1,46 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <utility>
+#include <cstdint>
+#include "IOEngine.h"
+
+// Encrypts a directory tree on a work-stealing pool. The calling thread walks the
+// tree and mirrors its directories while workers encrypt the files it finds.
+class FolderEncryptor {
+public:
+    struct Options {
+        bool aes128 = false;
+        size_t jobs = 1;
+        // With a state file only new or changed files are encrypted. It records
+        // each source's metadata and SHA-256 so touched but unchanged files are
+        // also skipped; a different key or mode starts from scratch.
+        std::string statePath;
+        bool prune = false; // remove outputs whose sources are gone (needs a state file)
+        bool asyncIO = false; // read and write through an IOEngine per worker
+        IOEngine::Backend ioBackend = IOEngine::AUTO;
+        size_t ioDepth = 8;
+    };
+
+    struct Summary {
+        size_t encrypted = 0;
+        size_t skipped = 0;
+        size_t pruned = 0;
+        std::vector<std::pair<std::string, std::string>> failures;
+        std::string ioBackend;
+        IOEngine::Stats io;
+    };
+
+    static bool encryptFolder(const std::string& inputDir, const std::string& outputDir,
+                              const std::vector<uint8_t>& key, bool aes128, size_t jobs,
+                              Summary& summary, std::string& error);
+
+    static bool encryptFolder(const std::string& inputDir, const std::string& outputDir,
+                              const std::vector<uint8_t>& key, const Options& options,
+                              Summary& summary, std::string& error);
+
+private:
+    static uint64_t stateTag(const std::vector<uint8_t>& key, bool aes128);
+
+    static const int64_t RACY_WINDOW_NS = 2000000000;
+};
\ No newline at end of file
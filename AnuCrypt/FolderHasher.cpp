@@ -0,0 +1,201 @@
+#include "FolderHasher.h"
+#include "FileSystem.h"
+#include "ThreadPool.h"
+#include "HashCache.h"
+#include "ReorderBuffer.h"
+#include "Hasher.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <vector>
+
+bool FolderHasher::hashFolder(const std::string& folder, Hashing::Algorithm alg, size_t jobs, bool sortPaths,
+    std::ostream& out, size_t& fileCount, std::string& error) {
+    return hashFolder(folder, std::vector<Hashing::Algorithm>(1, alg), jobs, sortPaths, out, fileCount, error);
+}
+
+std::string FolderHasher::formatLine(const std::string& path, const std::vector<Hashing::Algorithm>& algs,
+    const std::vector<Digest>& digests) {
+    std::string line = path + ":";
+    char hex[Digest::HEX_CAPACITY];
+    for (size_t i = 0; i < algs.size(); ++i) {
+        line += ' ';
+        if (algs.size() > 1) {
+            line += Hashing::algorithmName(algs[i]);
+            line += '=';
+        }
+        if (i < digests.size()) {
+            line.append(hex, digests[i].toHex(hex));
+        }
+    }
+    return line + "\n";
+}
+
+bool FolderHasher::digestFile(const std::string& path, const std::vector<Hashing::Algorithm>& algs,
+    IOEngine* engine, std::vector<Digest>& digests) {
+    if (!engine) {
+        return Hashing::digestFile(path, algs, 1, digests);
+    }
+
+    MultiHasher hasher(algs);
+    std::string error;
+    if (!engine->readFile(path, [&](const uint8_t* data, size_t size, bool, std::string&) {
+            hasher.update(data, size);
+            return true;
+        }, error)) {
+        return false;
+    }
+    digests = hasher.final();
+    return true;
+}
+
+bool FolderHasher::hashFolder(const std::string& folder, const std::vector<Hashing::Algorithm>& algs, size_t jobs,
+    bool sortPaths, std::ostream& out, size_t& fileCount, std::string& error) {
+    Options options;
+    options.algs = algs;
+    options.jobs = jobs;
+    options.sortPaths = sortPaths;
+
+    Stats stats;
+    bool ok = hashFolder(folder, options, out, stats, error);
+    fileCount = stats.files;
+    return ok;
+}
+
+bool FolderHasher::hashFolder(const std::string& folder, const Options& options, std::ostream& out, Stats& stats,
+    std::string& error) {
+    const std::vector<Hashing::Algorithm>& algs = options.algs;
+    ReorderBuffer results(out, OUTPUT_BUFFER_SIZE);
+    bool traversalOk = true;
+    stats = Stats();
+
+    std::unique_ptr<HashCache> cache;
+    if (!options.cachePath.empty()) {
+        cache.reset(new HashCache(algs));
+        cache->load(options.cachePath);
+    }
+
+    // A file modified within the same timestamp tick as its stat() could change
+    // again without its metadata changing, so recently touched files are hashed
+    // but not cached.
+    const int64_t racyLimit = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count() - RACY_WINDOW_NS;
+    const uint32_t seed = std::random_device()();
+
+    std::atomic<size_t> cached(0);
+    std::atomic<size_t> hashed(0);
+    std::atomic<size_t> spotChecked(0);
+    std::mutex mismatchMutex;
+
+    // One engine per worker, each keeping its own queue of reads in flight.
+    std::vector<std::unique_ptr<IOEngine>> engines;
+    if (options.asyncIO) {
+        for (size_t i = 0; i < std::max<size_t>(options.jobs, 1); ++i) {
+            engines.push_back(IOEngine::create(options.ioBackend, options.ioDepth, IO_BLOCK_SIZE, false, error));
+            if (!engines.back()) {
+                return false;
+            }
+        }
+        stats.ioBackend = engines.front()->name();
+    }
+
+    {
+        ThreadPool pool(options.jobs, options.jobs * 64);
+        auto submit = [&](const std::string& path) {
+            size_t sequence = stats.files++;
+            // Files are the unit of parallelism here, so each one is hashed on a
+            // single thread even when several digests are selected.
+            pool.submit([&, path, sequence] {
+                std::string line;
+                try {
+                    IOEngine* engine = engines.empty() ? nullptr : engines[pool.workerIndex()].get();
+                    std::vector<Digest> digests;
+                    HashCache::FileStat stat;
+                    bool haveStat = cache && HashCache::statFile(path, stat);
+                    bool hit = haveStat && !options.rehash && cache->lookup(path, stat, digests);
+
+                    if (hit && options.spotCheck > 0) {
+                        std::minstd_rand rng(seed ^ static_cast<uint32_t>(sequence * 2654435761u));
+                        if (std::uniform_real_distribution<double>(0, 1)(rng) < options.spotCheck) {
+                            ++spotChecked;
+                            std::vector<Digest> fresh;
+                            if (digestFile(path, algs, engine, fresh) && fresh != digests) {
+                                std::lock_guard<std::mutex> lock(mismatchMutex);
+                                stats.mismatches.push_back(path);
+                                hit = false;
+                            }
+                        }
+                    }
+
+                    if (hit) {
+                        ++cached;
+                    }
+                    else {
+                        ++hashed;
+                        if (digestFile(path, algs, engine, digests) && haveStat && stat.mtime < racyLimit) {
+                            cache->update(path, stat, digests);
+                        }
+                    }
+                    line = formatLine(path, algs, digests);
+                }
+                catch (const std::exception& e) {
+                    line = path + ": error: " + e.what() + "\n";
+                }
+                catch (...) {
+                    line = path + ": error\n";
+                }
+                // Every sequence number must complete, or later lines would wait forever.
+                results.complete(sequence, std::move(line));
+            });
+        };
+
+        try {
+            std::vector<std::string> paths;
+            for (auto& entry : fs::recursive_directory_iterator(folder)) {
+                if (!fs::is_regular_file(entry.status())) {
+                    continue;
+                }
+                if (options.sortPaths) {
+                    paths.push_back(entry.path().string());
+                }
+                else {
+                    submit(entry.path().string());
+                }
+            }
+
+            if (options.sortPaths) {
+                std::sort(paths.begin(), paths.end());
+                for (const auto& path : paths) {
+                    submit(path);
+                }
+            }
+        }
+        catch (const std::exception& e) {
+            error = e.what();
+            traversalOk = false;
+        }
+
+        pool.wait();
+    }
+
+    results.finish();
+    stats.cached = cached;
+    stats.hashed = hashed;
+    stats.spotChecked = spotChecked;
+    for (const auto& engine : engines) {
+        stats.io.add(engine->stats());
+    }
+
+    // A failed traversal saw only part of the tree; saving would drop the rest.
+    if (cache && traversalOk) {
+        std::string cacheError;
+        if (!cache->save(options.cachePath, cacheError)) {
+            error = "Cannot write hash cache: " + cacheError;
+            return false;
+        }
+    }
+    return traversalOk;
+}
\ No newline at end of file
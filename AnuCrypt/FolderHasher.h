@@ -0,0 +1,58 @@
+#pragma once
+#include <string>
+#include <iostream>
+#include <vector>
+#include "Hashing.h"
+#include "IOEngine.h"
+
+// Hashes every file under a folder on a thread pool. Results pass through a
+// reorder buffer so lines come out in traversal order (or sorted by path) no
+// matter which worker finishes first, and are written in large blocks.
+class FolderHasher {
+public:
+    struct Options {
+        std::vector<Hashing::Algorithm> algs;
+        size_t jobs = 1;
+        bool sortPaths = false;
+        std::string cachePath;   // empty disables the hash cache
+        bool rehash = false;     // ignore cached digests but still rewrite the cache
+        double spotCheck = 0;    // fraction of cache hits re-hashed and compared
+        bool asyncIO = false;    // read through an IOEngine instead of mapping files
+        IOEngine::Backend ioBackend = IOEngine::AUTO;
+        size_t ioDepth = 8;      // requests in flight per worker
+    };
+
+    struct Stats {
+        size_t files = 0;
+        size_t cached = 0;
+        size_t hashed = 0;
+        size_t spotChecked = 0;
+        std::vector<std::string> mismatches; // spot-checked files whose cached digest was wrong
+        std::string ioBackend;
+        IOEngine::Stats io;
+    };
+
+    static bool hashFolder(const std::string& folder, Hashing::Algorithm alg, size_t jobs, bool sortPaths,
+                           std::ostream& out, size_t& fileCount, std::string& error);
+
+    // Every selected digest from one read of each file. A single algorithm keeps
+    // the "path: hash" format; several give "path: MD5=... SHA256=...".
+    static bool hashFolder(const std::string& folder, const std::vector<Hashing::Algorithm>& algs, size_t jobs,
+                           bool sortPaths, std::ostream& out, size_t& fileCount, std::string& error);
+
+    // With a cache path, files whose size, times, inode and device match their
+    // cache entry are answered from the cache instead of being read.
+    static bool hashFolder(const std::string& folder, const Options& options, std::ostream& out, Stats& stats,
+                           std::string& error);
+
+private:
+    static std::string formatLine(const std::string& path, const std::vector<Hashing::Algorithm>& algs,
+                                  const std::vector<Digest>& digests);
+
+    static bool digestFile(const std::string& path, const std::vector<Hashing::Algorithm>& algs, IOEngine* engine,
+                           std::vector<Digest>& digests);
+
+    static const size_t OUTPUT_BUFFER_SIZE = 64 * 1024;
+    static const size_t IO_BLOCK_SIZE = 256 * 1024;
+    static const int64_t RACY_WINDOW_NS = 2000000000;
+};
\ No newline at end of file
@@ -0,0 +1,382 @@
+#include "HashCache.h"
+#include "Hasher.h"
+#include "FileSystem.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/stat.h>
+#endif
+
+namespace {
+    const char MAGIC[8] = { 'A', 'N', 'U', 'C', 'A', 'C', 'H', 'E' };
+
+    uint64_t readLE(const uint8_t* p, size_t bytes) {
+        uint64_t value = 0;
+        for (size_t i = 0; i < bytes; ++i) {
+            value |= static_cast<uint64_t>(p[i]) << (8 * i);
+        }
+        return value;
+    }
+
+    void writeLE(uint8_t* p, uint64_t value, size_t bytes) {
+        for (size_t i = 0; i < bytes; ++i) {
+            p[i] = static_cast<uint8_t>(value >> (8 * i));
+        }
+    }
+
+    // Record layout; digests follow the fixed part.
+    enum RecordField {
+        PATH_HASH = 0,
+        PATH_OFFSET = 8,
+        PATH_LENGTH = 16,
+        FILE_SIZE = 24,
+        MTIME = 32,
+        CTIME = 40,
+        INODE = 48,
+        DEVICE = 56,
+        DIGESTS = 64
+    };
+
+    HashCache::FileStat recordStat(const uint8_t* record) {
+        HashCache::FileStat stat;
+        stat.size = readLE(record + FILE_SIZE, 8);
+        stat.mtime = static_cast<int64_t>(readLE(record + MTIME, 8));
+        stat.ctime = static_cast<int64_t>(readLE(record + CTIME, 8));
+        stat.inode = readLE(record + INODE, 8);
+        stat.device = readLE(record + DEVICE, 8);
+        return stat;
+    }
+
+#ifdef _WIN32
+    // FILETIME counts 100 ns intervals since 1601.
+    int64_t fileTimeToUnixNs(int64_t fileTime) {
+        return (fileTime - 116444736000000000LL) * 100;
+    }
+#endif
+}
+
+bool HashCache::statFile(const std::string& path, FileStat& stat) {
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), FILE_READ_ATTRIBUTES, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+        nullptr, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    BY_HANDLE_FILE_INFORMATION info;
+    FILE_BASIC_INFO basic;
+    bool ok = GetFileInformationByHandle(file, &info) &&
+        GetFileInformationByHandleEx(file, FileBasicInfo, &basic, sizeof(basic));
+    CloseHandle(file);
+    if (!ok) {
+        return false;
+    }
+
+    stat.size = (static_cast<uint64_t>(info.nFileSizeHigh) << 32) | info.nFileSizeLow;
+    stat.mtime = fileTimeToUnixNs(basic.LastWriteTime.QuadPart);
+    stat.ctime = fileTimeToUnixNs(basic.ChangeTime.QuadPart);
+    stat.inode = (static_cast<uint64_t>(info.nFileIndexHigh) << 32) | info.nFileIndexLow;
+    stat.device = info.dwVolumeSerialNumber;
+    return true;
+#else
+    struct stat info;
+    if (::stat(path.c_str(), &info) != 0) {
+        return false;
+    }
+
+    stat.size = static_cast<uint64_t>(info.st_size);
+#ifdef __APPLE__
+    stat.mtime = static_cast<int64_t>(info.st_mtimespec.tv_sec) * 1000000000 + info.st_mtimespec.tv_nsec;
+    stat.ctime = static_cast<int64_t>(info.st_ctimespec.tv_sec) * 1000000000 + info.st_ctimespec.tv_nsec;
+#else
+    stat.mtime = static_cast<int64_t>(info.st_mtim.tv_sec) * 1000000000 + info.st_mtim.tv_nsec;
+    stat.ctime = static_cast<int64_t>(info.st_ctim.tv_sec) * 1000000000 + info.st_ctim.tv_nsec;
+#endif
+    stat.inode = static_cast<uint64_t>(info.st_ino);
+    stat.device = static_cast<uint64_t>(info.st_dev);
+    return true;
+#endif
+}
+
+HashCache::HashCache(const std::vector<Hashing::Algorithm>& algs, uint64_t tag)
+    : m_algs(algs), m_tag(tag), m_digestBytes(0), m_entryCount(0), m_strings(nullptr), m_stringsSize(0) {
+    for (Hashing::Algorithm alg : m_algs) {
+        m_digestBytes += Hasher::digestSize(alg);
+    }
+    m_recordSize = (RECORD_FIXED_SIZE + m_digestBytes + 7) / 8 * 8;
+}
+
+uint64_t HashCache::pathHash(const std::string& path) {
+    // FNV-1a
+    uint64_t hash = 14695981039346656037ULL;
+    for (unsigned char c : path) {
+        hash = (hash ^ c) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+const uint8_t* HashCache::record(size_t index) const {
+    return m_file.data() + HEADER_SIZE + index * m_recordSize;
+}
+
+void HashCache::reset() {
+    m_file.close();
+    m_entryCount = 0;
+    m_strings = nullptr;
+    m_stringsSize = 0;
+    m_kept.clear();
+}
+
+void HashCache::load(const std::string& path) {
+    reset();
+    if (!m_file.open(path) || m_file.size() < HEADER_SIZE) {
+        reset();
+        return;
+    }
+
+    const uint8_t* header = m_file.data();
+    bool valid = std::memcmp(header, MAGIC, sizeof(MAGIC)) == 0 &&
+        readLE(header + 8, 4) == VERSION &&
+        readLE(header + 12, 4) == m_algs.size() &&
+        readLE(header + 20, 4) == m_recordSize &&
+        readLE(header + 48, 8) == m_tag;
+    for (size_t i = 0; valid && i < m_algs.size(); ++i) {
+        valid = header[16 + i] == static_cast<uint8_t>(m_algs[i]);
+    }
+
+    uint64_t entryCount = readLE(header + 24, 8);
+    uint64_t stringsOffset = readLE(header + 32, 8);
+    uint64_t stringsSize = readLE(header + 40, 8);
+    valid = valid && entryCount <= (m_file.size() - HEADER_SIZE) / m_recordSize &&
+        stringsOffset == HEADER_SIZE + entryCount * m_recordSize &&
+        stringsSize <= m_file.size() - stringsOffset;
+    if (!valid) {
+        reset();
+        return;
+    }
+
+    m_entryCount = static_cast<size_t>(entryCount);
+    m_strings = m_file.data() + stringsOffset;
+    m_stringsSize = stringsSize;
+    m_kept.assign(m_entryCount, 0);
+}
+
+size_t HashCache::findRecord(const std::string& path) const {
+    const uint64_t hash = pathHash(path);
+
+    size_t lo = 0;
+    size_t hi = m_entryCount;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (readLE(record(mid) + PATH_HASH, 8) < hash) {
+            lo = mid + 1;
+        }
+        else {
+            hi = mid;
+        }
+    }
+
+    for (size_t index = lo; index < m_entryCount && readLE(record(index) + PATH_HASH, 8) == hash; ++index) {
+        const uint8_t* entry = record(index);
+        uint64_t offset = readLE(entry + PATH_OFFSET, 8);
+        uint64_t length = readLE(entry + PATH_LENGTH, 8);
+        if (length == path.size() && offset <= m_stringsSize && length <= m_stringsSize - offset &&
+            std::memcmp(m_strings + offset, path.data(), path.size()) == 0) {
+            return index;
+        }
+    }
+    return NOT_FOUND;
+}
+
+void HashCache::recordDigests(size_t index, std::vector<Digest>& digests) const {
+    digests.clear();
+    const uint8_t* p = record(index) + DIGESTS;
+    for (Hashing::Algorithm alg : m_algs) {
+        Digest digest;
+        digest.size = Hasher::digestSize(alg);
+        std::copy(p, p + digest.size, digest.bytes.begin());
+        digests.push_back(digest);
+        p += digest.size;
+    }
+}
+
+bool HashCache::lookup(const std::string& path, const FileStat& stat, std::vector<Digest>& digests) {
+    size_t index = findRecord(path);
+    if (index == NOT_FOUND || !recordStat(record(index)).matches(stat)) {
+        return false;
+    }
+
+    recordDigests(index, digests);
+    // Each index belongs to one path, so threads never write the same byte.
+    m_kept[index] = 1;
+    return true;
+}
+
+bool HashCache::find(const std::string& path, std::vector<Digest>& digests) const {
+    size_t index = findRecord(path);
+    if (index == NOT_FOUND) {
+        return false;
+    }
+    recordDigests(index, digests);
+    return true;
+}
+
+void HashCache::keep(const std::string& path) {
+    size_t index = findRecord(path);
+    if (index != NOT_FOUND) {
+        m_kept[index] = 1;
+    }
+}
+
+std::vector<std::string> HashCache::paths() const {
+    std::vector<std::string> result;
+    result.reserve(m_entryCount);
+    for (size_t index = 0; index < m_entryCount; ++index) {
+        const uint8_t* entry = record(index);
+        uint64_t offset = readLE(entry + PATH_OFFSET, 8);
+        uint64_t length = readLE(entry + PATH_LENGTH, 8);
+        if (offset <= m_stringsSize && length <= m_stringsSize - offset) {
+            result.emplace_back(reinterpret_cast<const char*>(m_strings + offset), static_cast<size_t>(length));
+        }
+    }
+    return result;
+}
+
+void HashCache::update(const std::string& path, const FileStat& stat, const std::vector<Digest>& digests) {
+    if (digests.size() != m_algs.size()) {
+        return;
+    }
+
+    Entry entry;
+    entry.pathHash = pathHash(path);
+    entry.path = path;
+    entry.stat = stat;
+    for (const Digest& digest : digests) {
+        entry.digests.insert(entry.digests.end(), digest.data(), digest.data() + digest.size);
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_updates.push_back(std::move(entry));
+}
+
+bool HashCache::save(const std::string& path, std::string& error) {
+    // Kept records are copied from the mapping, updated ones from memory. On a
+    // tie the update wins, which lets a re-hash replace a stale entry.
+    struct Item {
+        uint64_t hash;
+        const char* path;
+        size_t pathLength;
+        const uint8_t* oldRecord;
+        const Entry* entry;
+    };
+
+    std::vector<Item> items;
+    items.reserve(m_updates.size() + m_entryCount);
+    for (const Entry& entry : m_updates) {
+        items.push_back(Item{ entry.pathHash, entry.path.data(), entry.path.size(), nullptr, &entry });
+    }
+    for (size_t index = 0; index < m_entryCount; ++index) {
+        if (!m_kept[index]) {
+            continue;
+        }
+        const uint8_t* old = record(index);
+        uint64_t offset = readLE(old + PATH_OFFSET, 8);
+        uint64_t length = readLE(old + PATH_LENGTH, 8);
+        items.push_back(Item{ readLE(old + PATH_HASH, 8), reinterpret_cast<const char*>(m_strings + offset),
+            static_cast<size_t>(length), old, nullptr });
+    }
+
+    auto pathLess = [](const Item& a, const Item& b) {
+        int order = std::memcmp(a.path, b.path, std::min(a.pathLength, b.pathLength));
+        return order != 0 ? order < 0 : a.pathLength < b.pathLength;
+    };
+    std::stable_sort(items.begin(), items.end(), [&](const Item& a, const Item& b) {
+        if (a.hash != b.hash) {
+            return a.hash < b.hash;
+        }
+        return pathLess(a, b);
+    });
+    items.erase(std::unique(items.begin(), items.end(), [&](const Item& a, const Item& b) {
+        return a.hash == b.hash && !pathLess(a, b) && !pathLess(b, a);
+    }), items.end());
+
+    std::string tempPath = path + ".tmp";
+    {
+        std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+        if (!out.is_open()) {
+            error = "Cannot create cache file: " + tempPath;
+            return false;
+        }
+
+        uint64_t stringsSize = 0;
+        for (const Item& item : items) {
+            stringsSize += item.pathLength;
+        }
+
+        uint8_t header[HEADER_SIZE] = {};
+        std::memcpy(header, MAGIC, sizeof(MAGIC));
+        writeLE(header + 8, VERSION, 4);
+        writeLE(header + 12, m_algs.size(), 4);
+        for (size_t i = 0; i < m_algs.size(); ++i) {
+            header[16 + i] = static_cast<uint8_t>(m_algs[i]);
+        }
+        writeLE(header + 20, m_recordSize, 4);
+        writeLE(header + 24, items.size(), 8);
+        writeLE(header + 32, HEADER_SIZE + items.size() * m_recordSize, 8);
+        writeLE(header + 40, stringsSize, 8);
+        writeLE(header + 48, m_tag, 8);
+        out.write(reinterpret_cast<const char*>(header), sizeof(header));
+
+        std::vector<uint8_t> buffer(m_recordSize);
+        uint64_t offset = 0;
+        for (const Item& item : items) {
+            if (item.oldRecord) {
+                std::copy(item.oldRecord, item.oldRecord + m_recordSize, buffer.begin());
+            }
+            else {
+                std::fill(buffer.begin(), buffer.end(), static_cast<uint8_t>(0));
+                const FileStat& stat = item.entry->stat;
+                writeLE(&buffer[PATH_HASH], item.hash, 8);
+                writeLE(&buffer[FILE_SIZE], stat.size, 8);
+                writeLE(&buffer[MTIME], static_cast<uint64_t>(stat.mtime), 8);
+                writeLE(&buffer[CTIME], static_cast<uint64_t>(stat.ctime), 8);
+                writeLE(&buffer[INODE], stat.inode, 8);
+                writeLE(&buffer[DEVICE], stat.device, 8);
+                std::copy(item.entry->digests.begin(), item.entry->digests.end(), buffer.begin() + DIGESTS);
+            }
+            writeLE(&buffer[PATH_OFFSET], offset, 8);
+            writeLE(&buffer[PATH_LENGTH], item.pathLength, 8);
+            out.write(reinterpret_cast<const char*>(buffer.data()), buffer.size());
+            offset += item.pathLength;
+        }
+
+        for (const Item& item : items) {
+            out.write(item.path, item.pathLength);
+        }
+
+        if (!out) {
+            error = "Failed writing cache file: " + tempPath;
+            out.close();
+            std::remove(tempPath.c_str());
+            return false;
+        }
+    }
+
+    // The old cache may still be mapped; unmap it before it is replaced.
+    items.clear();
+    reset();
+    m_updates.clear();
+
+    if (!replaceFile(tempPath, path)) {
+        error = "Cannot replace cache file: " + path;
+        std::remove(tempPath.c_str());
+        return false;
+    }
+    return true;
+}
\ No newline at end of file
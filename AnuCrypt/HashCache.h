@@ -0,0 +1,91 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <mutex>
+#include <cstdint>
+#include "Hashing.h"
+#include "FileView.h"
+
+// On-disk manifest of file digests keyed by path and file metadata, so folder
+// hashing only has to read files that changed since the last run.
+//
+// The file is memory-mapped and searched in place: a 64-byte header, fixed-size
+// records sorted by path hash, then the path strings. All integers are little
+// endian. A cache written for a different set of algorithms, or with a
+// different tag, is ignored.
+class HashCache {
+public:
+    struct FileStat {
+        uint64_t size = 0;
+        int64_t mtime = 0;   // nanoseconds since the Unix epoch
+        int64_t ctime = 0;
+        uint64_t inode = 0;
+        uint64_t device = 0;
+
+        bool matches(const FileStat& other) const {
+            return size == other.size && mtime == other.mtime && ctime == other.ctime &&
+                inode == other.inode && device == other.device;
+        }
+    };
+
+    static bool statFile(const std::string& path, FileStat& stat);
+
+    // The tag lets callers tie a cache to something beyond the file contents,
+    // such as the key the files were encrypted with.
+    explicit HashCache(const std::vector<Hashing::Algorithm>& algs, uint64_t tag = 0);
+
+    HashCache(const HashCache&) = delete;
+    HashCache& operator=(const HashCache&) = delete;
+
+    // A missing, damaged or incompatible cache loads as empty.
+    void load(const std::string& path);
+    size_t size() const { return m_entryCount; }
+
+    // Both are safe to call from several threads. lookup() only succeeds when
+    // every metadata field matches; entries found this way are kept by save().
+    bool lookup(const std::string& path, const FileStat& stat, std::vector<Digest>& digests);
+    void update(const std::string& path, const FileStat& stat, const std::vector<Digest>& digests);
+
+    // The stored digests whatever the metadata says, without keeping the entry.
+    bool find(const std::string& path, std::vector<Digest>& digests) const;
+    // Keeps an entry as it is; for files that were not looked up this run.
+    void keep(const std::string& path);
+    std::vector<std::string> paths() const;
+
+    // Writes the entries looked up or updated since load(); files that were not
+    // seen in this run drop out.
+    bool save(const std::string& path, std::string& error);
+
+private:
+    static const size_t HEADER_SIZE = 64;
+    static const size_t RECORD_FIXED_SIZE = 64;
+    static const uint32_t VERSION = 1;
+    static const size_t NOT_FOUND = static_cast<size_t>(-1);
+
+    struct Entry {
+        uint64_t pathHash;
+        std::string path;
+        FileStat stat;
+        std::vector<uint8_t> digests;
+    };
+
+    static uint64_t pathHash(const std::string& path);
+    void reset();
+    const uint8_t* record(size_t index) const;
+    size_t findRecord(const std::string& path) const;
+    void recordDigests(size_t index, std::vector<Digest>& digests) const;
+
+    std::vector<Hashing::Algorithm> m_algs;
+    uint64_t m_tag;
+    size_t m_digestBytes;
+    size_t m_recordSize;
+
+    FileView m_file;
+    size_t m_entryCount;
+    const uint8_t* m_strings;
+    uint64_t m_stringsSize;
+    std::vector<uint8_t> m_kept;
+
+    std::mutex m_mutex;
+    std::vector<Entry> m_updates;
+};
\ No newline at end of file
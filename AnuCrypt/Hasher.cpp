@@ -0,0 +1,111 @@
+#include "Hasher.h"
+#include "ThreadPool.h"
+#include <algorithm>
+
+Hasher::Hasher(Hashing::Algorithm alg) : Hasher(alg, CryptoBackend::forHash(alg)) {
+}
+
+Hasher::Hasher(Hashing::Algorithm alg, const CryptoBackend& backend) : m_alg(alg) {
+    if (&backend != &CryptoBackend::defaultBackend()) {
+        m_context = backend.newHash(alg);
+    }
+}
+
+size_t Hasher::digestSize(Hashing::Algorithm alg) {
+    switch (alg) {
+    case Hashing::RC2_ALG:
+        return 20;
+    case Hashing::MD5_ALG:
+        return 16;
+    case Hashing::SHA256_ALG:
+    default:
+        return 32;
+    }
+}
+
+CryptoPP::HashTransformation& Hasher::cryptoPPContext() {
+    switch (m_alg) {
+    case Hashing::RC2_ALG:
+        return m_sha1;
+    case Hashing::MD5_ALG:
+        return m_md5;
+    case Hashing::SHA256_ALG:
+    default:
+        return m_sha256;
+    }
+}
+
+void Hasher::init() {
+    if (m_context) {
+        m_context->init();
+    }
+    else {
+        cryptoPPContext().Restart();
+    }
+}
+
+void Hasher::update(const uint8_t* data, size_t size) {
+    if (m_context) {
+        m_context->update(data, size);
+    }
+    else {
+        cryptoPPContext().Update(data, size);
+    }
+}
+
+Digest Hasher::final() {
+    Digest digest;
+    digest.size = digestSize(m_alg);
+    if (m_context) {
+        m_context->final(digest.bytes.data());
+    }
+    else {
+        cryptoPPContext().Final(digest.bytes.data());
+    }
+    return digest;
+}
+
+MultiHasher::MultiHasher(const std::vector<Hashing::Algorithm>& algs, size_t threads) {
+    for (Hashing::Algorithm alg : algs) {
+        m_hashers.emplace_back(new Hasher(alg));
+    }
+    threads = std::min(threads, m_hashers.size());
+    if (threads > 1) {
+        m_pool.reset(new ThreadPool(threads));
+    }
+}
+
+MultiHasher::~MultiHasher() {
+}
+
+void MultiHasher::init() {
+    for (auto& hasher : m_hashers) {
+        hasher->init();
+    }
+}
+
+void MultiHasher::update(const uint8_t* data, size_t size) {
+    if (!m_pool) {
+        for (auto& hasher : m_hashers) {
+            hasher->update(data, size);
+        }
+        return;
+    }
+
+    for (auto& hasher : m_hashers) {
+        Hasher* context = hasher.get();
+        m_pool->submit([context, data, size] {
+            context->update(data, size);
+        });
+    }
+    m_pool->wait();
+}
+
+std::vector<Digest> MultiHasher::final() {
+    std::vector<Digest> digests;
+    digests.reserve(m_hashers.size());
+    for (auto& hasher : m_hashers) {
+        digests.push_back(hasher->final());
+    }
+    return digests;
+}
\ No newline at end of file
@@ -0,0 +1,60 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <cryptopp/md5.h>
+#include <cryptopp/sha.h>
+#include "Hashing.h"
+#include "Digest.h"
+#include "CryptoBackend.h"
+
+// Streaming hash context: init() / update() any number of times / final().
+// One Hasher can be reused for many messages without allocating. Uses the
+// current backend for alg unless given one; the Crypto++ contexts live inline,
+// so only other backends allocate, once, on construction.
+class Hasher {
+public:
+    explicit Hasher(Hashing::Algorithm alg);
+    Hasher(Hashing::Algorithm alg, const CryptoBackend& backend);
+
+    void init();
+    void update(const uint8_t* data, size_t size);
+    Digest final();
+
+    Hashing::Algorithm algorithm() const { return m_alg; }
+
+    static size_t digestSize(Hashing::Algorithm alg);
+
+private:
+    CryptoPP::HashTransformation& cryptoPPContext();
+
+    Hashing::Algorithm m_alg;
+    std::unique_ptr<HashContext> m_context;  // null when Crypto++ is used
+    CryptoPP::MD5 m_md5;
+    CryptoPP::SHA1 m_sha1;
+    CryptoPP::SHA256 m_sha256;
+};
+
+class ThreadPool;
+
+// Feeds the same input to several hash contexts so every digest comes from a
+// single read. With threads > 1 each context hashes the shared block on its own
+// pool thread; update() returns once all of them are done with it.
+class MultiHasher {
+public:
+    MultiHasher(const std::vector<Hashing::Algorithm>& algs, size_t threads = 1);
+    ~MultiHasher();
+
+    MultiHasher(const MultiHasher&) = delete;
+    MultiHasher& operator=(const MultiHasher&) = delete;
+
+    void init();
+    void update(const uint8_t* data, size_t size);
+    std::vector<Digest> final();
+
+    size_t count() const { return m_hashers.size(); }
+
+private:
+    std::vector<std::unique_ptr<Hasher>> m_hashers;
+    std::unique_ptr<ThreadPool> m_pool;
+};
\ No newline at end of file
@@ -2,39 +2,95 @@
 #include "RC2.h"
 #include "MD5.h"
 #include "Sha256.h"
-#include <fstream>
+#include "FileView.h"
+#include "Hasher.h"
+#include <algorithm>
 
 std::string Hashing::hashData(const std::vector<uint8_t>& data, Algorithm alg) {
+    return hashData(data.data(), data.size(), alg);
+}
+
+std::string Hashing::hashData(const uint8_t* data, size_t size, Algorithm alg) {
     switch (alg) {
     case RC2_ALG:
-        return RC2Hash::hash(data);
+        return RC2Hash::hash(data, size);
     case MD5_ALG:
-        return MD5::hash(data);
+        return MD5::hash(data, size);
     case SHA256_ALG:
-        return Sha256::hash(data);
+        return Sha256::hash(data, size);
     default:
         return "";
     }
 }
 
 std::string Hashing::hashFile(const std::string& filepath, Algorithm alg) {
-    std::ifstream file(filepath, std::ios::binary);
-    if (!file.is_open()) {
+    Digest digest;
+    if (!digestFile(filepath, alg, digest)) {
         return "";
     }
+    return digest.hex();
+}
+
+std::string Hashing::hashText(const std::string& text, Algorithm alg) {
+    return hashData(reinterpret_cast<const uint8_t*>(text.data()), text.size(), alg);
+}
 
-    file.seekg(0, std::ios::end);
-    size_t size = file.tellg();
-    file.seekg(0, std::ios::beg);
+Digest Hashing::digestData(const uint8_t* data, size_t size, Algorithm alg) {
+    Digest digest;
+    digest.size = Hasher::digestSize(alg);
+    HashContext& context = CryptoBackend::threadHash(alg);
+    context.update(data, size);
+    context.final(digest.bytes.data());
+    return digest;
+}
 
-    std::vector<uint8_t> data(size);
-    file.read(reinterpret_cast<char*>(data.data()), size);
-    file.close();
+bool Hashing::digestFile(const std::string& filepath, Algorithm alg, Digest& digest) {
+    try {
+        FileView file;
+        if (!file.open(filepath)) {
+            return false;
+        }
+        digest = digestData(file.data(), file.size(), alg);
+        return true;
+    }
+    catch (...) {
+        return false;
+    }
+}
 
-    return hashData(data, alg);
+std::vector<Digest> Hashing::digestData(const uint8_t* data, size_t size,
+    const std::vector<Algorithm>& algs, size_t threads) {
+    MultiHasher hasher(algs, threads);
+    for (size_t offset = 0; offset < size; offset += MULTI_BLOCK_SIZE) {
+        hasher.update(data + offset, std::min(MULTI_BLOCK_SIZE, size - offset));
+    }
+    return hasher.final();
 }
 
-std::string Hashing::hashText(const std::string& text, Algorithm alg) {
-    std::vector<uint8_t> data(text.begin(), text.end());
-    return hashData(data, alg);
+bool Hashing::digestFile(const std::string& filepath, const std::vector<Algorithm>& algs, size_t threads,
+    std::vector<Digest>& digests) {
+    try {
+        FileView file;
+        if (!file.open(filepath)) {
+            return false;
+        }
+        digests = digestData(file.data(), file.size(), algs, threads);
+        return true;
+    }
+    catch (...) {
+        return false;
+    }
+}
+
+const char* Hashing::algorithmName(Algorithm alg) {
+    switch (alg) {
+    case RC2_ALG:
+        return "SHA1";
+    case MD5_ALG:
+        return "MD5";
+    case SHA256_ALG:
+        return "SHA256";
+    default:
+        return "";
+    }
 }
\ No newline at end of file
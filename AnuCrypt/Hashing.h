@@ -1,16 +1,36 @@
 #pragma once
 #include <string>
 #include <vector>
+#include "Digest.h"
 
 class Hashing {
 public:
     enum Algorithm {
         RC2_ALG,
         MD5_ALG,
-        SHA256_ALG
+        SHA256_ALG,
+        SHA1_ALG = RC2_ALG // RC2_ALG has always been SHA-1
     };
 
     static std::string hashData(const std::vector<uint8_t>& data, Algorithm alg);
+    static std::string hashData(const uint8_t* data, size_t size, Algorithm alg);
     static std::string hashFile(const std::string& filepath, Algorithm alg);
     static std::string hashText(const std::string& text, Algorithm alg);
+
+    // Raw digests, for callers that format or compare them themselves.
+    static Digest digestData(const uint8_t* data, size_t size, Algorithm alg);
+    static bool digestFile(const std::string& filepath, Algorithm alg, Digest& digest);
+
+    // Several digests from one pass over the input, in the order of algs. With
+    // threads > 1 each algorithm runs on its own thread over the shared blocks.
+    static std::vector<Digest> digestData(const uint8_t* data, size_t size,
+                                          const std::vector<Algorithm>& algs, size_t threads = 1);
+    static bool digestFile(const std::string& filepath, const std::vector<Algorithm>& algs, size_t threads,
+                           std::vector<Digest>& digests);
+
+    static const char* algorithmName(Algorithm alg);
+
+private:
+    // Small enough that a block is still in cache when the next context reads it.
+    static constexpr size_t MULTI_BLOCK_SIZE = 1 << 20;
 };
\ No newline at end of file
@@ -0,0 +1,640 @@
+#include "IOEngine.h"
+#include <algorithm>
+#include <cerrno>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef ANUCRYPT_HAVE_IO_URING
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#endif
+
+namespace {
+    const size_t PAGE_SIZE = 4096;
+    const size_t WRITE_EXTRA = 64;
+    const size_t MAX_IO_THREADS = 8;
+
+    size_t roundUp(size_t value, size_t unit) {
+        return (value + unit - 1) / unit * unit;
+    }
+
+    std::string systemError(int code) {
+#ifdef _WIN32
+        return "system error " + std::to_string(code);
+#else
+        return std::strerror(code);
+#endif
+    }
+
+    // A negative error code marks a file that shrank while it was being read.
+    const int FILE_SHRANK = -1;
+
+    IOEngine::FileHandle openRead(const std::string& path, uint64_t& size) {
+#ifdef _WIN32
+        HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+            FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        LARGE_INTEGER fileSize;
+        if (file == INVALID_HANDLE_VALUE || !GetFileSizeEx(file, &fileSize)) {
+            if (file != INVALID_HANDLE_VALUE) {
+                CloseHandle(file);
+            }
+            return IOEngine::INVALID_FILE;
+        }
+        size = static_cast<uint64_t>(fileSize.QuadPart);
+        return reinterpret_cast<IOEngine::FileHandle>(file);
+#else
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        struct stat info;
+        if (fd < 0 || ::fstat(fd, &info) != 0) {
+            if (fd >= 0) {
+                ::close(fd);
+            }
+            return IOEngine::INVALID_FILE;
+        }
+        size = static_cast<uint64_t>(info.st_size);
+        return fd;
+#endif
+    }
+}
+
+void IOEngine::Stats::add(const Stats& other) {
+    reads += other.reads;
+    writes += other.writes;
+    bytesRead += other.bytesRead;
+    bytesWritten += other.bytesWritten;
+    batches += other.batches;
+    depthTotal += other.depthTotal;
+    maxDepth = std::max(maxDepth, other.maxDepth);
+}
+
+double IOEngine::Stats::averageDepth() const {
+    return batches > 0 ? static_cast<double>(depthTotal) / batches : 0;
+}
+
+IOEngine::FileHandle IOEngine::openWrite(const std::string& path) {
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    return file == INVALID_HANDLE_VALUE ? INVALID_FILE : reinterpret_cast<FileHandle>(file);
+#else
+    int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+    return fd < 0 ? INVALID_FILE : fd;
+#endif
+}
+
+void IOEngine::closeFile(FileHandle file) {
+    if (file == INVALID_FILE) {
+        return;
+    }
+#ifdef _WIN32
+    CloseHandle(reinterpret_cast<HANDLE>(file));
+#else
+    ::close(static_cast<int>(file));
+#endif
+}
+
+bool IOEngine::transfer(const Slot& slot, int64_t& result) {
+    uint8_t* data = slot.buffer + slot.progress;
+    uint64_t offset = slot.offset + slot.progress;
+    size_t length = slot.length - slot.progress;
+#ifdef _WIN32
+    OVERLAPPED overlapped = {};
+    overlapped.Offset = static_cast<DWORD>(offset);
+    overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+    DWORD done = 0;
+    HANDLE file = reinterpret_cast<HANDLE>(slot.file);
+    BOOL ok = slot.write
+        ? WriteFile(file, data, static_cast<DWORD>(length), &done, &overlapped)
+        : ReadFile(file, data, static_cast<DWORD>(length), &done, &overlapped);
+    if (!ok && GetLastError() != ERROR_HANDLE_EOF) {
+        result = -static_cast<int64_t>(GetLastError());
+        return false;
+    }
+    result = done;
+    return true;
+#else
+    ssize_t done;
+    do {
+        done = slot.write
+            ? ::pwrite(static_cast<int>(slot.file), data, length, static_cast<off_t>(offset))
+            : ::pread(static_cast<int>(slot.file), data, length, static_cast<off_t>(offset));
+    } while (done < 0 && errno == EINTR);
+    result = done < 0 ? -static_cast<int64_t>(errno) : static_cast<int64_t>(done);
+    return done >= 0;
+#endif
+}
+
+IOEngine::IOEngine(size_t queueDepth, size_t blockSize, bool writes)
+    : m_blockSize(blockSize), m_inFlight(0), m_queued(0) {
+    queueDepth = std::max<size_t>(queueDepth, writes ? 2 : 1);
+    m_readSlots = writes ? queueDepth / 2 : queueDepth;
+    size_t writeSlots = queueDepth - (writes ? m_readSlots : queueDepth);
+    m_writeCapacity = blockSize + WRITE_EXTRA;
+
+    // Page-aligned buffers, which io_uring registration and direct I/O prefer.
+    size_t readStride = roundUp(blockSize, PAGE_SIZE);
+    size_t writeStride = roundUp(m_writeCapacity, PAGE_SIZE);
+    m_memory.resize(m_readSlots * readStride + writeSlots * writeStride + PAGE_SIZE);
+    uint8_t* base = m_memory.data() + (PAGE_SIZE - reinterpret_cast<uintptr_t>(m_memory.data()) % PAGE_SIZE) % PAGE_SIZE;
+
+    m_slots.resize(m_readSlots + writeSlots);
+    for (size_t i = 0; i < m_slots.size(); ++i) {
+        m_slots[i].buffer = i < m_readSlots
+            ? base + i * readStride
+            : base + m_readSlots * readStride + (i - m_readSlots) * writeStride;
+        m_slots[i].write = i >= m_readSlots;
+    }
+}
+
+IOEngine::~IOEngine() {
+}
+
+bool IOEngine::start(size_t slot, std::string& error) {
+    if (!submit(slot, error)) {
+        return false;
+    }
+    ++m_queued;
+    return true;
+}
+
+bool IOEngine::flushQueued(std::string& error) {
+    if (m_queued == 0) {
+        return true;
+    }
+    ++m_stats.batches;
+    m_stats.depthTotal += m_inFlight;
+    m_stats.maxDepth = std::max(m_stats.maxDepth, m_inFlight);
+    m_queued = 0;
+    return flush(error);
+}
+
+bool IOEngine::reap(std::string& error) {
+    if (!flushQueued(error)) {
+        return false;
+    }
+
+    size_t index;
+    int64_t result;
+    if (!waitCompletion(index, result, error)) {
+        return false;
+    }
+
+    Slot& slot = m_slots[index];
+    if (result < 0) {
+        slot.error = static_cast<int>(-result);
+    }
+    else if (result == 0) {
+        slot.error = slot.write ? EIO : FILE_SHRANK;
+    }
+    else {
+        // Short transfers carry on from where they stopped.
+        slot.progress += static_cast<size_t>(result);
+        if (slot.progress < slot.length) {
+            return start(index, error);
+        }
+    }
+
+    --m_inFlight;
+    slot.done = true;
+    if (slot.write) {
+        ++m_stats.writes;
+        m_stats.bytesWritten += slot.progress;
+        if (slot.error != 0 && m_writeError.empty()) {
+            m_writeError = "Failed writing output file: " + systemError(slot.error);
+        }
+        slot.busy = false;
+    }
+    else {
+        ++m_stats.reads;
+        m_stats.bytesRead += slot.progress;
+    }
+    return true;
+}
+
+void IOEngine::drain() {
+    std::string ignored;
+    while (m_inFlight > 0 && reap(ignored)) {
+    }
+    for (Slot& slot : m_slots) {
+        slot.busy = false;
+    }
+}
+
+bool IOEngine::readFile(const std::string& path, const BlockConsumer& consume, std::string& error) {
+    uint64_t size = 0;
+    FileHandle file = openRead(path, size);
+    if (file == INVALID_FILE) {
+        error = "Cannot open input file: " + path;
+        return false;
+    }
+
+    // Block b always uses read slot b % m_readSlots: blocks are issued and
+    // consumed in order, so that slot has been consumed before b is issued.
+    const uint64_t blocks = size == 0 ? 1 : (size + m_blockSize - 1) / m_blockSize;
+    uint64_t issued = 0;
+    uint64_t consumed = 0;
+    bool ok = true;
+
+    while (ok && consumed < blocks) {
+        while (issued < blocks && issued < consumed + m_readSlots) {
+            Slot& slot = m_slots[issued % m_readSlots];
+            slot.busy = true;
+            slot.done = false;
+            slot.file = file;
+            slot.offset = issued * m_blockSize;
+            slot.length = static_cast<size_t>(std::min<uint64_t>(m_blockSize, size - slot.offset));
+            slot.progress = 0;
+            slot.error = 0;
+            if (slot.length == 0) {
+                slot.done = true;
+            }
+            else if (!start(issued % m_readSlots, error)) {
+                ok = false;
+                break;
+            }
+            else {
+                ++m_inFlight;
+            }
+            ++issued;
+        }
+        if (!ok || !flushQueued(error)) {
+            ok = false;
+            break;
+        }
+
+        Slot& slot = m_slots[consumed % m_readSlots];
+        while (ok && !slot.done) {
+            ok = reap(error);
+        }
+        if (!ok) {
+            break;
+        }
+        if (slot.error != 0) {
+            error = slot.error == FILE_SHRANK
+                ? "Input file changed while reading: " + path
+                : "Failed reading " + path + ": " + systemError(slot.error);
+            ok = false;
+            break;
+        }
+
+        ok = consume(slot.buffer, slot.length, consumed + 1 == blocks, error);
+        slot.busy = false;
+        ++consumed;
+    }
+
+    if (!ok) {
+        drain();
+    }
+    closeFile(file);
+    return ok;
+}
+
+bool IOEngine::acquireWrite(WriteBuffer& buffer, std::string& error) {
+    while (true) {
+        for (size_t i = m_readSlots; i < m_slots.size(); ++i) {
+            if (!m_slots[i].busy) {
+                m_slots[i].busy = true;
+                buffer.data = m_slots[i].buffer;
+                buffer.capacity = m_writeCapacity;
+                buffer.slot = i;
+                return true;
+            }
+        }
+        if (m_slots.size() == m_readSlots) {
+            error = "This I/O engine was created without write buffers.";
+            return false;
+        }
+        if (m_inFlight == 0) {
+            error = "Every write buffer is held and none is being written.";
+            return false;
+        }
+        if (!reap(error)) {
+            return false;
+        }
+    }
+}
+
+bool IOEngine::queueWrite(const WriteBuffer& buffer, FileHandle file, uint64_t offset, size_t size,
+    std::string& error) {
+    Slot& slot = m_slots[buffer.slot];
+    slot.done = false;
+    slot.file = file;
+    slot.offset = offset;
+    slot.length = size;
+    slot.progress = 0;
+    slot.error = 0;
+    if (size == 0) {
+        slot.busy = false;
+        return true;
+    }
+    if (!start(buffer.slot, error)) {
+        slot.busy = false;
+        return false;
+    }
+    ++m_inFlight;
+    return true;
+}
+
+bool IOEngine::finishWrites(std::string& error) {
+    for (size_t i = m_readSlots; i < m_slots.size(); ++i) {
+        while (m_slots[i].busy) {
+            if (!reap(error)) {
+                return false;
+            }
+        }
+    }
+    if (!m_writeError.empty()) {
+        error = m_writeError;
+        m_writeError.clear();
+        return false;
+    }
+    return true;
+}
+
+namespace {
+    // pread/pwrite on a few threads; each thread keeps one request in flight.
+    class ThreadEngine : public IOEngine {
+    public:
+        ThreadEngine(size_t queueDepth, size_t blockSize, bool writes)
+            : IOEngine(queueDepth, blockSize, writes), m_stopping(false) {
+            size_t threads = std::min(m_slots.size(), MAX_IO_THREADS);
+            for (size_t i = 0; i < threads; ++i) {
+                m_threads.emplace_back([this] { workerLoop(); });
+            }
+        }
+
+        ~ThreadEngine() override {
+            drain();
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_stopping = true;
+            }
+            m_workAvailable.notify_all();
+            for (auto& thread : m_threads) {
+                thread.join();
+            }
+        }
+
+        const char* name() const override { return "threads"; }
+
+    protected:
+        bool submit(size_t slot, std::string&) override {
+            m_staged.push_back(slot);
+            return true;
+        }
+
+        bool flush(std::string&) override {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_pending.insert(m_pending.end(), m_staged.begin(), m_staged.end());
+            }
+            m_staged.size() > 1 ? m_workAvailable.notify_all() : m_workAvailable.notify_one();
+            m_staged.clear();
+            return true;
+        }
+
+        bool waitCompletion(size_t& slot, int64_t& result, std::string&) override {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_completionAvailable.wait(lock, [this] { return !m_completed.empty(); });
+            slot = m_completed.front().first;
+            result = m_completed.front().second;
+            m_completed.pop_front();
+            return true;
+        }
+
+    private:
+        void workerLoop() {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            while (true) {
+                m_workAvailable.wait(lock, [this] { return m_stopping || !m_pending.empty(); });
+                if (m_pending.empty()) {
+                    return;
+                }
+                size_t slot = m_pending.front();
+                m_pending.pop_front();
+
+                lock.unlock();
+                int64_t result;
+                transfer(m_slots[slot], result);
+                lock.lock();
+
+                m_completed.emplace_back(slot, result);
+                m_completionAvailable.notify_one();
+            }
+        }
+
+        std::vector<size_t> m_staged;
+        std::mutex m_mutex;
+        std::condition_variable m_workAvailable;
+        std::condition_variable m_completionAvailable;
+        std::deque<size_t> m_pending;
+        std::deque<std::pair<size_t, int64_t>> m_completed;
+        std::vector<std::thread> m_threads;
+        bool m_stopping;
+    };
+
+#ifdef ANUCRYPT_HAVE_IO_URING
+    // io_uring through the raw system calls, so no extra library is needed.
+    // Buffers are registered once so the kernel skips pinning them per request;
+    // if registration is refused (e.g. by RLIMIT_MEMLOCK) plain vectored
+    // requests are used instead.
+    class UringEngine : public IOEngine {
+    public:
+        UringEngine(size_t queueDepth, size_t blockSize, bool writes)
+            : IOEngine(queueDepth, blockSize, writes), m_fd(-1), m_ring(MAP_FAILED), m_ringSize(0),
+              m_sqes(static_cast<io_uring_sqe*>(MAP_FAILED)), m_sqesSize(0), m_fixed(false) {
+        }
+
+        ~UringEngine() override {
+            if (m_fd >= 0) {
+                drain();
+            }
+            if (m_sqes != MAP_FAILED) {
+                munmap(m_sqes, m_sqesSize);
+            }
+            if (m_ring != MAP_FAILED) {
+                munmap(m_ring, m_ringSize);
+            }
+            if (m_fd >= 0) {
+                ::close(m_fd);
+            }
+        }
+
+        bool init(std::string& error) {
+            io_uring_params params;
+            std::memset(&params, 0, sizeof(params));
+            m_fd = static_cast<int>(syscall(__NR_io_uring_setup, static_cast<unsigned>(m_slots.size()), &params));
+            if (m_fd < 0) {
+                error = "io_uring is not available: " + systemError(errno);
+                return false;
+            }
+
+            // One mapping holds both rings on every kernel that has READV.
+            if (!(params.features & IORING_FEAT_SINGLE_MMAP)) {
+                error = "io_uring is too old on this kernel.";
+                return false;
+            }
+            m_ringSize = std::max<size_t>(params.sq_off.array + params.sq_entries * sizeof(uint32_t),
+                params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe));
+            m_ring = mmap(nullptr, m_ringSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd,
+                IORING_OFF_SQ_RING);
+            m_sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+            m_sqes = static_cast<io_uring_sqe*>(mmap(nullptr, m_sqesSize, PROT_READ | PROT_WRITE,
+                MAP_SHARED | MAP_POPULATE, m_fd, IORING_OFF_SQES));
+            if (m_ring == MAP_FAILED || m_sqes == MAP_FAILED) {
+                error = "Cannot map io_uring rings: " + systemError(errno);
+                return false;
+            }
+
+            uint8_t* ring = static_cast<uint8_t*>(m_ring);
+            m_sqTail = reinterpret_cast<uint32_t*>(ring + params.sq_off.tail);
+            m_sqMask = *reinterpret_cast<uint32_t*>(ring + params.sq_off.ring_mask);
+            m_sqArray = reinterpret_cast<uint32_t*>(ring + params.sq_off.array);
+            m_cqHead = reinterpret_cast<uint32_t*>(ring + params.cq_off.head);
+            m_cqTail = reinterpret_cast<uint32_t*>(ring + params.cq_off.tail);
+            m_cqMask = *reinterpret_cast<uint32_t*>(ring + params.cq_off.ring_mask);
+            m_cqes = reinterpret_cast<io_uring_cqe*>(ring + params.cq_off.cqes);
+            m_toSubmit = 0;
+
+            m_iovecs.resize(m_slots.size());
+            for (size_t i = 0; i < m_slots.size(); ++i) {
+                m_iovecs[i].iov_base = m_slots[i].buffer;
+                m_iovecs[i].iov_len = i < m_readSlots ? blockSize() : m_writeCapacity;
+            }
+            m_fixed = syscall(__NR_io_uring_register, m_fd, IORING_REGISTER_BUFFERS, m_iovecs.data(),
+                static_cast<unsigned>(m_iovecs.size())) == 0;
+            return true;
+        }
+
+        const char* name() const override { return m_fixed ? "io_uring" : "io_uring (unregistered buffers)"; }
+
+    protected:
+        bool submit(size_t index, std::string&) override {
+            const Slot& slot = m_slots[index];
+            uint32_t tail = *m_sqTail;
+            uint32_t entry = tail & m_sqMask;
+            io_uring_sqe& sqe = m_sqes[entry];
+            std::memset(&sqe, 0, sizeof(sqe));
+
+            sqe.fd = static_cast<int>(slot.file);
+            sqe.off = slot.offset + slot.progress;
+            sqe.user_data = index;
+            if (m_fixed) {
+                sqe.opcode = slot.write ? IORING_OP_WRITE_FIXED : IORING_OP_READ_FIXED;
+                sqe.addr = reinterpret_cast<uint64_t>(slot.buffer + slot.progress);
+                sqe.len = static_cast<uint32_t>(slot.length - slot.progress);
+                sqe.buf_index = static_cast<uint16_t>(index);
+            }
+            else {
+                m_iovecs[index].iov_base = slot.buffer + slot.progress;
+                m_iovecs[index].iov_len = slot.length - slot.progress;
+                sqe.opcode = slot.write ? IORING_OP_WRITEV : IORING_OP_READV;
+                sqe.addr = reinterpret_cast<uint64_t>(&m_iovecs[index]);
+                sqe.len = 1;
+            }
+
+            m_sqArray[entry] = entry;
+            __atomic_store_n(m_sqTail, tail + 1, __ATOMIC_RELEASE);
+            ++m_toSubmit;
+            return true;
+        }
+
+        bool flush(std::string& error) override {
+            while (m_toSubmit > 0) {
+                long done = syscall(__NR_io_uring_enter, m_fd, m_toSubmit, 0, 0, nullptr, 0);
+                if (done < 0) {
+                    if (errno == EINTR) {
+                        continue;
+                    }
+                    error = "io_uring submission failed: " + systemError(errno);
+                    return false;
+                }
+                m_toSubmit -= static_cast<unsigned>(done);
+            }
+            return true;
+        }
+
+        bool waitCompletion(size_t& slot, int64_t& result, std::string& error) override {
+            while (true) {
+                uint32_t head = *m_cqHead;
+                if (head != __atomic_load_n(m_cqTail, __ATOMIC_ACQUIRE)) {
+                    const io_uring_cqe& cqe = m_cqes[head & m_cqMask];
+                    slot = static_cast<size_t>(cqe.user_data);
+                    result = cqe.res;
+                    __atomic_store_n(m_cqHead, head + 1, __ATOMIC_RELEASE);
+                    return true;
+                }
+                if (syscall(__NR_io_uring_enter, m_fd, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0) < 0 &&
+                    errno != EINTR) {
+                    error = "io_uring wait failed: " + systemError(errno);
+                    return false;
+                }
+            }
+        }
+
+    private:
+        int m_fd;
+        void* m_ring;
+        size_t m_ringSize;
+        io_uring_sqe* m_sqes;
+        size_t m_sqesSize;
+        bool m_fixed;
+        unsigned m_toSubmit;
+        uint32_t* m_sqTail;
+        uint32_t m_sqMask;
+        uint32_t* m_sqArray;
+        uint32_t* m_cqHead;
+        uint32_t* m_cqTail;
+        uint32_t m_cqMask;
+        io_uring_cqe* m_cqes;
+        std::vector<iovec> m_iovecs;
+    };
+#endif
+}
+
+std::unique_ptr<IOEngine> IOEngine::create(Backend backend, size_t queueDepth, size_t blockSize, bool writes,
+    std::string& error) {
+    if (backend != THREADS) {
+#ifdef ANUCRYPT_HAVE_IO_URING
+        std::unique_ptr<UringEngine> engine(new UringEngine(queueDepth, blockSize, writes));
+        if (engine->init(error)) {
+            return engine;
+        }
+#else
+        error = "io_uring is not available on this platform.";
+#endif
+        if (backend == URING) {
+            return nullptr;
+        }
+    }
+    return std::unique_ptr<IOEngine>(new ThreadEngine(queueDepth, blockSize, writes));
+}
+
+bool IOEngine::parseBackend(const std::string& name, Backend& backend) {
+    if (name == "auto") {
+        backend = AUTO;
+    }
+    else if (name == "uring" || name == "io_uring") {
+        backend = URING;
+    }
+    else if (name == "threads") {
+        backend = THREADS;
+    }
+    else {
+        return false;
+    }
+    return true;
+}
\ No newline at end of file
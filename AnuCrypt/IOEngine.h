@@ -0,0 +1,124 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <cstdint>
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define ANUCRYPT_HAVE_IO_URING 1
+#endif
+#endif
+
+// Positioned reads and writes with many requests in flight at once, so fast
+// devices see a real queue instead of one blocking call at a time. The io_uring
+// backend submits in batches from registered buffers; elsewhere, or when the
+// kernel refuses io_uring, a small pool of threads issues pread/pwrite.
+//
+// An engine is not thread-safe; folder operations give each worker its own.
+// Every buffer belongs to the engine: reads hand out views of them and writes
+// are staged in them, so no request outlives the memory it points at.
+class IOEngine {
+public:
+    enum Backend {
+        AUTO,
+        URING,
+        THREADS
+    };
+
+    typedef intptr_t FileHandle;
+    static const FileHandle INVALID_FILE = -1;
+
+    struct Stats {
+        uint64_t reads = 0;
+        uint64_t writes = 0;
+        uint64_t bytesRead = 0;
+        uint64_t bytesWritten = 0;
+        uint64_t batches = 0;       // submissions handed to the backend
+        uint64_t depthTotal = 0;    // requests in flight, summed over batches
+        size_t maxDepth = 0;
+
+        void add(const Stats& other);
+        double averageDepth() const;
+    };
+
+    // Called for each block of a file in order. An empty file gives one empty
+    // last block. Returning false stops the read with the error set.
+    typedef std::function<bool(const uint8_t* data, size_t size, bool last, std::string& error)> BlockConsumer;
+
+    struct WriteBuffer {
+        uint8_t* data = nullptr;
+        size_t capacity = 0;
+        size_t slot = 0;
+    };
+
+    // queueDepth requests may be in flight; with writes enabled half of them
+    // are reserved for writes. Reads use blockSize buffers, writes a little more
+    // so a block can grow by a tag or header.
+    static std::unique_ptr<IOEngine> create(Backend backend, size_t queueDepth, size_t blockSize, bool writes,
+                                            std::string& error);
+    static bool parseBackend(const std::string& name, Backend& backend);
+
+    virtual ~IOEngine();
+
+    IOEngine(const IOEngine&) = delete;
+    IOEngine& operator=(const IOEngine&) = delete;
+
+    virtual const char* name() const = 0;
+    const Stats& stats() const { return m_stats; }
+    size_t blockSize() const { return m_blockSize; }
+
+    bool readFile(const std::string& path, const BlockConsumer& consume, std::string& error);
+
+    static FileHandle openWrite(const std::string& path);
+    static void closeFile(FileHandle file);
+
+    // Fill a buffer, then queue it; the buffer is released once written.
+    // finishWrites() waits for every queued write and reports the first failure.
+    bool acquireWrite(WriteBuffer& buffer, std::string& error);
+    bool queueWrite(const WriteBuffer& buffer, FileHandle file, uint64_t offset, size_t size, std::string& error);
+    bool finishWrites(std::string& error);
+
+protected:
+    struct Slot {
+        uint8_t* buffer = nullptr;
+        bool busy = false;
+        bool done = false;
+        bool write = false;
+        FileHandle file = INVALID_FILE;
+        uint64_t offset = 0;
+        size_t length = 0;
+        size_t progress = 0;  // bytes already transferred by earlier short completions
+        int error = 0;
+    };
+
+    IOEngine(size_t queueDepth, size_t blockSize, bool writes);
+
+    // Backends queue a request for a slot's remaining bytes, hand queued requests
+    // over in one batch, and block until one request completes (result is the
+    // byte count or a negative errno).
+    virtual bool submit(size_t slot, std::string& error) = 0;
+    virtual bool flush(std::string& error) = 0;
+    virtual bool waitCompletion(size_t& slot, int64_t& result, std::string& error) = 0;
+
+    static bool transfer(const Slot& slot, int64_t& result);
+    // Waits out every request still in flight; backends call it before teardown.
+    void drain();
+
+    std::vector<Slot> m_slots;
+    std::vector<uint8_t> m_memory;
+    size_t m_readSlots;
+    size_t m_writeCapacity;
+
+private:
+    bool start(size_t slot, std::string& error);
+    bool flushQueued(std::string& error);
+    bool reap(std::string& error);
+
+    size_t m_blockSize;
+    size_t m_inFlight;
+    size_t m_queued;
+    std::string m_writeError;
+    Stats m_stats;
+};
\ No newline at end of file
@@ -0,0 +1,111 @@
+#include "KeyCache.h"
+#include "KeyGenerator.h"
+
+std::vector<std::unique_ptr<EncryptionSession>>& KeyCache::idle(Entry& entry, bool aes128, EncryptionSession*) {
+    return entry.encryptors[aes128 ? 1 : 0];
+}
+
+std::vector<std::unique_ptr<DecryptionSession>>& KeyCache::idle(Entry& entry, bool aes128, DecryptionSession*) {
+    return entry.decryptors[aes128 ? 1 : 0];
+}
+
+// Called with m_mutex held.
+KeyCache::Entry* KeyCache::load(const std::string& keyPath, std::string& error) {
+    std::error_code ec;
+    fs::file_time_type modified = fs::last_write_time(keyPath, ec);
+    if (ec) {
+        error = "Error loading key from: " + keyPath;
+        return nullptr;
+    }
+
+    auto found = m_entries.find(keyPath);
+    if (found != m_entries.end() && found->second.modified == modified) {
+        return &found->second;
+    }
+
+    std::vector<uint8_t> key;
+    if (!KeyGenerator::loadKey(keyPath, key)) {
+        error = "Error loading key from: " + keyPath;
+        return nullptr;
+    }
+
+    // Sessions keyed from the old contents are dropped, including lent ones
+    // when they come back.
+    Entry& entry = m_entries[keyPath];
+    entry.key.swap(key);
+    entry.modified = modified;
+    entry.generation = ++m_generations;
+    for (int i = 0; i < 2; ++i) {
+        entry.encryptors[i].clear();
+        entry.decryptors[i].clear();
+    }
+    return &entry;
+}
+
+template <typename Session>
+bool KeyCache::lend(const std::string& keyPath, bool aes128, Lease<Session>& lease, std::string& error) {
+    std::vector<uint8_t> key;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        Entry* entry = load(keyPath, error);
+        if (!entry) {
+            return false;
+        }
+
+        lease.m_cache = this;
+        lease.m_keyPath = keyPath;
+        lease.m_aes128 = aes128;
+        lease.m_generation = entry->generation;
+
+        auto& sessions = idle(*entry, aes128, static_cast<Session*>(nullptr));
+        if (!sessions.empty()) {
+            lease.m_session = std::move(sessions.back());
+            sessions.pop_back();
+            return true;
+        }
+        key = entry->key;
+    }
+
+    // Key expansion for a new session happens outside the lock.
+    std::unique_ptr<Session> session(new Session);
+    if (!session->setKey(key, aes128, error)) {
+        return false;
+    }
+    lease.m_session = std::move(session);
+    return true;
+}
+
+template <typename Session>
+void KeyCache::restore(const std::string& keyPath, bool aes128, uint64_t generation,
+    std::unique_ptr<Session> session) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto found = m_entries.find(keyPath);
+    if (found != m_entries.end() && found->second.generation == generation) {
+        idle(found->second, aes128, static_cast<Session*>(nullptr)).push_back(std::move(session));
+    }
+}
+
+bool KeyCache::encryptor(const std::string& keyPath, bool aes128, Lease<EncryptionSession>& lease,
+    std::string& error) {
+    return lend(keyPath, aes128, lease, error);
+}
+
+bool KeyCache::decryptor(const std::string& keyPath, bool aes128, Lease<DecryptionSession>& lease,
+    std::string& error) {
+    return lend(keyPath, aes128, lease, error);
+}
+
+void KeyCache::giveBack(const std::string& keyPath, bool aes128, uint64_t generation,
+    std::unique_ptr<EncryptionSession> session) {
+    restore(keyPath, aes128, generation, std::move(session));
+}
+
+void KeyCache::giveBack(const std::string& keyPath, bool aes128, uint64_t generation,
+    std::unique_ptr<DecryptionSession> session) {
+    restore(keyPath, aes128, generation, std::move(session));
+}
+
+size_t KeyCache::keyCount() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_entries.size();
+}
\ No newline at end of file
@@ -0,0 +1,77 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <cstdint>
+#include "FileSystem.h"
+#include "CryptoSession.h"
+
+// Key files loaded once and kept with sessions already keyed from them, for a
+// process that runs many jobs under a few keys. A key file is read again when
+// its modification time changes. Thread-safe: each session is lent to a single
+// caller and comes back to the cache when its Lease goes away.
+class KeyCache {
+public:
+    template <typename Session>
+    class Lease {
+    public:
+        Lease() : m_cache(nullptr), m_aes128(false), m_generation(0) {}
+        Lease(Lease&& other) = default;
+        Lease& operator=(Lease&& other) = default;
+        ~Lease() {
+            if (m_cache && m_session) {
+                m_cache->giveBack(m_keyPath, m_aes128, m_generation, std::move(m_session));
+            }
+        }
+
+        Session* operator->() const { return m_session.get(); }
+        Session& operator*() const { return *m_session; }
+
+    private:
+        friend class KeyCache;
+
+        KeyCache* m_cache;
+        std::string m_keyPath;
+        bool m_aes128;
+        uint64_t m_generation;
+        std::unique_ptr<Session> m_session;
+    };
+
+    KeyCache() = default;
+    KeyCache(const KeyCache&) = delete;
+    KeyCache& operator=(const KeyCache&) = delete;
+
+    bool encryptor(const std::string& keyPath, bool aes128, Lease<EncryptionSession>& lease, std::string& error);
+    bool decryptor(const std::string& keyPath, bool aes128, Lease<DecryptionSession>& lease, std::string& error);
+
+    size_t keyCount() const;
+
+private:
+    struct Entry {
+        std::vector<uint8_t> key;
+        fs::file_time_type modified;
+        uint64_t generation = 0;
+        // Idle sessions, indexed by aes128.
+        std::vector<std::unique_ptr<EncryptionSession>> encryptors[2];
+        std::vector<std::unique_ptr<DecryptionSession>> decryptors[2];
+    };
+
+    Entry* load(const std::string& keyPath, std::string& error);
+    template <typename Session>
+    bool lend(const std::string& keyPath, bool aes128, Lease<Session>& lease, std::string& error);
+    void giveBack(const std::string& keyPath, bool aes128, uint64_t generation,
+                  std::unique_ptr<EncryptionSession> session);
+    void giveBack(const std::string& keyPath, bool aes128, uint64_t generation,
+                  std::unique_ptr<DecryptionSession> session);
+    template <typename Session>
+    void restore(const std::string& keyPath, bool aes128, uint64_t generation, std::unique_ptr<Session> session);
+
+    static std::vector<std::unique_ptr<EncryptionSession>>& idle(Entry& entry, bool aes128, EncryptionSession*);
+    static std::vector<std::unique_ptr<DecryptionSession>>& idle(Entry& entry, bool aes128, DecryptionSession*);
+
+    mutable std::mutex m_mutex;
+    std::map<std::string, Entry> m_entries;
+    uint64_t m_generations = 0;
+};
\ No newline at end of file
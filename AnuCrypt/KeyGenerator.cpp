@@ -1,4 +1,5 @@
 #include "KeyGenerator.h"
+#include "FileView.h"
 #include <fstream>
 #include <sstream>
 #include <iomanip>
@@ -22,13 +23,8 @@ bool KeyGenerator::saveKey(const std::vector<uint8_t>& key, const std::string& f
 }
 
 bool KeyGenerator::loadKey(const std::string& filename, std::vector<uint8_t>& outKey) {
-    std::ifstream file(filename, std::ios::binary);
-    if (!file.is_open()) return false;
-    file.seekg(0, std::ios::end);
-    size_t size = file.tellg();
-    file.seekg(0, std::ios::beg);
-    outKey.resize(size);
-    file.read(reinterpret_cast<char*>(outKey.data()), size);
-    file.close();
+    FileView file;
+    if (!file.open(filename)) return false;
+    outKey.assign(file.data(), file.data() + file.size());
     return true;
 }
\ No newline at end of file
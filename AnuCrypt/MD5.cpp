@@ -1,21 +1,26 @@
 #include "MD5.h"
-#include <cryptopp/md5.h>
-#include <cryptopp/hex.h>
-#include <cryptopp/filters.h>
+#include "CryptoBackend.h"
 
 std::string MD5::hash(const std::vector<uint8_t>& data) {
-    try {
-        CryptoPP::byte digest[CryptoPP::MD5::DIGESTSIZE];
-        CryptoPP::MD5().CalculateDigest(digest, data.data(), data.size());
-
-        std::string output;
-        CryptoPP::HexEncoder encoder(new CryptoPP::StringSink(output));
-        encoder.Put(digest, sizeof(digest));
-        encoder.MessageEnd();
+    return hash(data.data(), data.size());
+}
 
-        return output;
+std::string MD5::hash(const uint8_t* data, size_t size) {
+    try {
+        MD5Digest value = digest(data, size);
+        char hex[Digest::HEX_CAPACITY];
+        return std::string(hex, Digest::toHex(value.data(), value.size(), hex));
     }
     catch (...) {
         return "";
     }
+}
+
+MD5Digest MD5::digest(const uint8_t* data, size_t size) {
+    static_assert(sizeof(MD5Digest) == 16, "digest size mismatch");
+    MD5Digest value;
+    HashContext& context = CryptoBackend::threadHash(Hashing::MD5_ALG);
+    context.update(data, size);
+    context.final(value.data());
+    return value;
 }
\ No newline at end of file
@@ -0,0 +1,128 @@
+#include "Pipeline.h"
+#include "SpscQueue.h"
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+
+namespace {
+    typedef SpscQueue<Pipeline::Block*> BlockQueue;
+
+    // Spin briefly, then yield, then sleep: a stage waiting on the disk should
+    // not take the CPU the crypto stage needs.
+    bool waitPop(BlockQueue& queue, Pipeline::Block*& block, const std::atomic<bool>& stop) {
+        for (unsigned attempt = 0; !queue.pop(block); ++attempt) {
+            if (stop.load(std::memory_order_acquire)) {
+                return false;
+            }
+            if (attempt >= 256) {
+                std::this_thread::sleep_for(std::chrono::microseconds(50));
+            }
+            else if (attempt >= 64) {
+                std::this_thread::yield();
+            }
+        }
+        return true;
+    }
+}
+
+bool Pipeline::run(size_t inputSize, size_t outputSize, size_t depth, const Reader& read,
+    const Transform& transform, const Writer& write, std::string& error) {
+    if (depth == 0) {
+        depth = 1;
+    }
+
+    // Each queue can hold every buffer of its kind, so a push never has to wait.
+    std::vector<Block> inputs(depth);
+    std::vector<Block> outputs(depth);
+    BlockQueue freeInputs(depth), fullInputs(depth);
+    BlockQueue freeOutputs(depth), fullOutputs(depth);
+    for (size_t i = 0; i < depth; ++i) {
+        inputs[i].data.resize(inputSize);
+        outputs[i].data.resize(outputSize);
+        freeInputs.push(&inputs[i]);
+        freeOutputs.push(&outputs[i]);
+    }
+
+    std::atomic<bool> stop(false);
+    std::mutex errorMutex;
+    std::string firstError;
+    auto fail = [&](const std::string& message) {
+        std::lock_guard<std::mutex> lock(errorMutex);
+        if (!stop.load()) {
+            firstError = message;
+            stop.store(true, std::memory_order_release);
+        }
+    };
+
+    // Runs one stage call, turning a false return or an exception into a stop.
+    auto call = [&](const std::function<bool(std::string&)>& stage) {
+        std::string stageError;
+        try {
+            if (stage(stageError)) {
+                return true;
+            }
+        }
+        catch (const std::exception& e) {
+            stageError = e.what();
+        }
+        fail(stageError);
+        return false;
+    };
+
+    std::thread reader([&] {
+        Block* block;
+        for (uint64_t index = 0; waitPop(freeInputs, block, stop); ++index) {
+            block->size = 0;
+            block->last = false;
+            block->index = index;
+            if (!call([&](std::string& e) { return read(*block, e); })) {
+                return;
+            }
+            fullInputs.push(block);
+            if (block->last) {
+                return;
+            }
+        }
+    });
+
+    std::thread writer([&] {
+        Block* block;
+        while (waitPop(fullOutputs, block, stop)) {
+            if (!call([&](std::string& e) { return write(*block, e); })) {
+                return;
+            }
+            bool last = block->last;
+            freeOutputs.push(block);
+            if (last) {
+                return;
+            }
+        }
+    });
+
+    Block* input;
+    Block* output;
+    while (waitPop(fullInputs, input, stop) && waitPop(freeOutputs, output, stop)) {
+        output->size = 0;
+        output->last = input->last;
+        output->index = input->index;
+        if (!call([&](std::string& e) { return transform(*input, *output, e); })) {
+            break;
+        }
+        bool last = input->last;
+        freeInputs.push(input);
+        fullOutputs.push(output);
+        if (last) {
+            break;
+        }
+    }
+
+    reader.join();
+    writer.join();
+
+    if (stop.load()) {
+        error = firstError;
+        return false;
+    }
+    return true;
+}
\ No newline at end of file
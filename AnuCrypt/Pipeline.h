@@ -0,0 +1,32 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <functional>
+#include <cstdint>
+
+// Three-stage pipeline for streaming one file: a reader thread fills input
+// buffers, the calling thread transforms each into an output buffer, and a
+// writer thread drains those. Buffers circulate through lock-free queues and
+// are reused, so reading, crypto and writing overlap without allocating.
+//
+// Every stage sees the blocks in order. The reader marks the final block with
+// `last`; any stage returning false stops the others and its error is reported.
+class Pipeline {
+public:
+    struct Block {
+        std::vector<uint8_t> data;
+        size_t size = 0;
+        bool last = false;
+        uint64_t index = 0;
+    };
+
+    typedef std::function<bool(Block& block, std::string& error)> Reader;
+    typedef std::function<bool(const Block& input, Block& output, std::string& error)> Transform;
+    typedef std::function<bool(const Block& block, std::string& error)> Writer;
+
+    // depth buffers of each kind; the reader starts up to depth blocks ahead.
+    static bool run(size_t inputSize, size_t outputSize, size_t depth, const Reader& read,
+                    const Transform& transform, const Writer& write, std::string& error);
+
+    static const size_t DEFAULT_DEPTH = 4;
+};
\ No newline at end of file
@@ -1,21 +1,26 @@
 #include "RC2.h"
-#include <cryptopp/sha.h>
-#include <cryptopp/hex.h>
-#include <cryptopp/filters.h>
+#include "CryptoBackend.h"
 
 std::string RC2Hash::hash(const std::vector<uint8_t>& data) {
-    try {
-        CryptoPP::byte digest[CryptoPP::SHA1::DIGESTSIZE];
-        CryptoPP::SHA1().CalculateDigest(digest, data.data(), data.size());
-
-        std::string output;
-        CryptoPP::HexEncoder encoder(new CryptoPP::StringSink(output));
-        encoder.Put(digest, sizeof(digest));
-        encoder.MessageEnd();
+    return hash(data.data(), data.size());
+}
 
-        return output;
+std::string RC2Hash::hash(const uint8_t* data, size_t size) {
+    try {
+        SHA1Digest value = digest(data, size);
+        char hex[Digest::HEX_CAPACITY];
+        return std::string(hex, Digest::toHex(value.data(), value.size(), hex));
     }
     catch (...) {
         return "";
     }
+}
+
+SHA1Digest RC2Hash::digest(const uint8_t* data, size_t size) {
+    static_assert(sizeof(SHA1Digest) == 20, "digest size mismatch");
+    SHA1Digest value;
+    HashContext& context = CryptoBackend::threadHash(Hashing::SHA1_ALG);
+    context.update(data, size);
+    context.final(value.data());
+    return value;
 }
\ No newline at end of file
@@ -1,8 +1,11 @@
 #pragma once
 #include <string>
 #include <vector>
+#include "Digest.h"
 
 class RC2Hash {
 public:
     static std::string hash(const std::vector<uint8_t>& data);
+    static std::string hash(const uint8_t* data, size_t size);
+    static SHA1Digest digest(const uint8_t* data, size_t size);
 };
\ No newline at end of file
@@ -0,0 +1,44 @@
+#include "ReorderBuffer.h"
+
+ReorderBuffer::ReorderBuffer(std::ostream& out, size_t flushSize)
+    : m_out(out), m_flushSize(flushSize), m_next(0) {
+    m_buffer.reserve(flushSize * 2);
+}
+
+void ReorderBuffer::complete(size_t sequence, std::string line) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (sequence != m_next) {
+        m_waiting.emplace(sequence, std::move(line));
+        return;
+    }
+
+    append(line);
+    ++m_next;
+    auto it = m_waiting.begin();
+    while (it != m_waiting.end() && it->first == m_next) {
+        append(it->second);
+        it = m_waiting.erase(it);
+        ++m_next;
+    }
+}
+
+void ReorderBuffer::finish() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    // Lines are only left waiting when an earlier sequence number never
+    // completed; write them in order rather than losing everything past the gap.
+    for (const auto& waiting : m_waiting) {
+        m_buffer += waiting.second;
+    }
+    m_waiting.clear();
+    m_out.write(m_buffer.data(), m_buffer.size());
+    m_buffer.clear();
+    m_out.flush();
+}
+
+void ReorderBuffer::append(const std::string& line) {
+    m_buffer += line;
+    if (m_buffer.size() >= m_flushSize) {
+        m_out.write(m_buffer.data(), m_buffer.size());
+        m_buffer.clear();
+    }
+}
\ No newline at end of file
@@ -0,0 +1,28 @@
+#pragma once
+#include <string>
+#include <iostream>
+#include <map>
+#include <mutex>
+
+// Collects finished lines keyed by sequence number and releases them strictly
+// in order, batching the writes into one large buffer.
+class ReorderBuffer {
+public:
+    ReorderBuffer(std::ostream& out, size_t flushSize);
+
+    ReorderBuffer(const ReorderBuffer&) = delete;
+    ReorderBuffer& operator=(const ReorderBuffer&) = delete;
+
+    void complete(size_t sequence, std::string line);
+    void finish();
+
+private:
+    void append(const std::string& line);
+
+    std::ostream& m_out;
+    size_t m_flushSize;
+    size_t m_next;
+    std::string m_buffer;
+    std::map<size_t, std::string> m_waiting;
+    std::mutex m_mutex;
+};
\ No newline at end of file
@@ -0,0 +1,324 @@
+#include "SegmentedCipher.h"
+#include "FileValidator.h"
+#include "FileSystem.h"
+#include "ThreadPool.h"
+#include "CryptoBackend.h"
+#include "Hasher.h"
+#include <fstream>
+#include <mutex>
+#include <atomic>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <cryptopp/osrng.h>
+
+bool SegmentedCipher::runSegments(uint64_t segmentCount, size_t jobs,
+    const std::function<bool(uint64_t, std::string&)>& work, std::string& error) {
+    std::mutex errorMutex;
+    std::atomic<bool> failed(false);
+
+    {
+        ThreadPool pool(std::min<uint64_t>(jobs, segmentCount), jobs * 4);
+        for (uint64_t segment = 0; segment < segmentCount && !failed; ++segment) {
+            pool.submit([&, segment] {
+                if (failed) {
+                    return;
+                }
+
+                std::string segmentError;
+                bool ok;
+                try {
+                    ok = work(segment, segmentError);
+                }
+                catch (const std::exception& e) {
+                    segmentError = e.what();
+                    ok = false;
+                }
+
+                if (!ok) {
+                    std::lock_guard<std::mutex> lock(errorMutex);
+                    if (!failed) {
+                        error = segmentError;
+                        failed = true;
+                    }
+                }
+            });
+        }
+        pool.wait();
+    }
+
+    return !failed;
+}
+
+std::string SegmentedCipher::tableDigest(const std::vector<uint8_t>& table) {
+    Digest digest = Hashing::digestData(table.data(), table.size(), Hashing::MD5_ALG);
+    return FileValidator::toHex(digest.bytes.data(), digest.size);
+}
+
+bool SegmentedCipher::verifyDigests(const uint8_t* plaintext, uint64_t size, const CryptFormat::Header& header,
+    std::string& error) {
+    const uint64_t segmentBytes = static_cast<uint64_t>(header.chunkSize) * header.segmentChunks;
+    const uint64_t chunkCount = std::max<uint64_t>(1, (size + header.chunkSize - 1) / header.chunkSize);
+    const uint64_t segmentCount = (chunkCount + header.segmentChunks - 1) / header.segmentChunks;
+
+    bool ok = segmentCount * CryptFormat::MD5_SIZE == header.segmentTable.size() &&
+        tableDigest(header.segmentTable) == header.md5;
+    Hasher md5(Hashing::MD5_ALG);
+    for (uint64_t segment = 0; ok && segment < segmentCount; ++segment) {
+        uint64_t offset = segment * segmentBytes;
+        md5.update(plaintext + offset, static_cast<size_t>(std::min(segmentBytes, size - offset)));
+        Digest digest = md5.final();
+        ok = std::memcmp(digest.bytes.data(), &header.segmentTable[segment * CryptFormat::MD5_SIZE],
+            CryptFormat::MD5_SIZE) == 0;
+    }
+
+    if (!ok) {
+        error = "File integrity check failed - possible corruption.";
+    }
+    return ok;
+}
+
+bool SegmentedCipher::encryptSegment(const std::string& inputPath, const std::string& outputPath,
+    const std::vector<uint8_t>& key, const CryptFormat::Header& header, const Layout& layout,
+    uint64_t segment, uint8_t* digest, std::string& error) {
+    const uint64_t chunkSize = header.chunkSize;
+    const uint64_t firstChunk = segment * header.segmentChunks;
+    const uint64_t endChunk = std::min<uint64_t>(firstChunk + header.segmentChunks, layout.chunkCount);
+
+    std::ifstream in(inputPath, std::ios::binary);
+    std::fstream out(outputPath, std::ios::in | std::ios::out | std::ios::binary);
+    if (!in.is_open() || !out.is_open()) {
+        error = "Cannot open file for segment encryption.";
+        return false;
+    }
+    in.seekg(static_cast<std::streamoff>(firstChunk * chunkSize));
+    out.seekp(static_cast<std::streamoff>(layout.dataStart + firstChunk * (chunkSize + CryptFormat::TAG_SIZE)));
+
+    std::vector<uint8_t> plaintext(header.chunkSize);
+    std::vector<uint8_t> ciphertext(header.chunkSize + CryptFormat::TAG_SIZE);
+    uint8_t nonce[CryptFormat::IV_SIZE];
+
+    std::unique_ptr<GcmCipher> gcm = CryptoBackend::current(CryptoBackend::GCM_PRIMITIVE).newGcm();
+    gcm->setKey(key.data(), key.size());
+    Hasher md5(Hashing::MD5_ALG);
+
+    for (uint64_t chunk = firstChunk; chunk < endChunk; ++chunk) {
+        size_t want = static_cast<size_t>(std::min(chunkSize, layout.plainSize - chunk * chunkSize));
+        in.read(reinterpret_cast<char*>(plaintext.data()), want);
+        if (static_cast<size_t>(in.gcount()) != want) {
+            error = "Input file changed during encryption.";
+            return false;
+        }
+
+        uint8_t finalFlag = chunk + 1 == layout.chunkCount ? 1 : 0;
+        md5.update(plaintext.data(), want);
+        CryptFormat::chunkNonce(header.iv, chunk, nonce);
+        gcm->seal(nonce, sizeof(nonce), &finalFlag, sizeof(finalFlag), plaintext.data(), want,
+            ciphertext.data(), ciphertext.data() + want, CryptFormat::TAG_SIZE);
+
+        out.write(reinterpret_cast<const char*>(ciphertext.data()), want + CryptFormat::TAG_SIZE);
+        if (!out) {
+            error = "Failed writing output file.";
+            return false;
+        }
+    }
+
+    Digest result = md5.final();
+    std::memcpy(digest, result.bytes.data(), CryptFormat::MD5_SIZE);
+    return true;
+}
+
+bool SegmentedCipher::decryptSegment(const std::string& inputPath, const std::string& outputPath,
+    const std::vector<uint8_t>& key, const CryptFormat::Header& header, const Layout& layout,
+    uint64_t segment, std::string& error) {
+    const uint64_t chunkSize = header.chunkSize;
+    const uint64_t recordSize = chunkSize + CryptFormat::TAG_SIZE;
+    const uint64_t firstChunk = segment * header.segmentChunks;
+    const uint64_t endChunk = std::min<uint64_t>(firstChunk + header.segmentChunks, layout.chunkCount);
+
+    std::ifstream in(inputPath, std::ios::binary);
+    std::fstream out(outputPath, std::ios::in | std::ios::out | std::ios::binary);
+    if (!in.is_open() || !out.is_open()) {
+        error = "Cannot open file for segment decryption.";
+        return false;
+    }
+    in.seekg(static_cast<std::streamoff>(layout.dataStart + firstChunk * recordSize));
+    out.seekp(static_cast<std::streamoff>(firstChunk * chunkSize));
+
+    std::vector<uint8_t> ciphertext(static_cast<size_t>(recordSize));
+    std::vector<uint8_t> plaintext(header.chunkSize);
+    uint8_t nonce[CryptFormat::IV_SIZE];
+
+    std::unique_ptr<GcmCipher> gcm = CryptoBackend::current(CryptoBackend::GCM_PRIMITIVE).newGcm();
+    gcm->setKey(key.data(), key.size());
+    Hasher md5(Hashing::MD5_ALG);
+
+    for (uint64_t chunk = firstChunk; chunk < endChunk; ++chunk) {
+        size_t dataSize = static_cast<size_t>(std::min(chunkSize, layout.plainSize - chunk * chunkSize));
+        size_t want = dataSize + CryptFormat::TAG_SIZE;
+        in.read(reinterpret_cast<char*>(ciphertext.data()), want);
+        if (static_cast<size_t>(in.gcount()) != want) {
+            error = "Encrypted file is truncated.";
+            return false;
+        }
+
+        uint8_t finalFlag = chunk + 1 == layout.chunkCount ? 1 : 0;
+        CryptFormat::chunkNonce(header.iv, chunk, nonce);
+        if (!gcm->open(nonce, sizeof(nonce), &finalFlag, sizeof(finalFlag), ciphertext.data(), dataSize,
+            ciphertext.data() + dataSize, CryptFormat::TAG_SIZE, plaintext.data())) {
+            error = "Authentication failed - invalid key or corrupted file.";
+            return false;
+        }
+
+        md5.update(plaintext.data(), dataSize);
+        out.write(reinterpret_cast<const char*>(plaintext.data()), dataSize);
+        if (!out) {
+            error = "Failed writing output file.";
+            return false;
+        }
+    }
+
+    Digest digest = md5.final();
+    if (std::memcmp(digest.bytes.data(), &header.segmentTable[segment * CryptFormat::MD5_SIZE],
+        CryptFormat::MD5_SIZE) != 0) {
+        error = "File integrity check failed - possible corruption.";
+        return false;
+    }
+    return true;
+}
+
+bool SegmentedCipher::encryptFile(const std::string& inputPath, const std::string& outputPath,
+    const std::vector<uint8_t>& key, uint8_t algId, size_t jobs, std::string& error) {
+    try {
+        if (key.size() != 16 && key.size() != 24 && key.size() != 32) {
+            error = "Invalid key length.";
+            return false;
+        }
+        if (!fs::is_regular_file(inputPath)) {
+            error = "Cannot open input file.";
+            return false;
+        }
+
+        CryptFormat::Header header;
+        header.algId = algId;
+        header.chunkSize = CryptFormat::DEFAULT_CHUNK_SIZE;
+        header.segmentChunks = CryptFormat::DEFAULT_SEGMENT_CHUNKS;
+        header.md5.assign(CryptFormat::MD5_HEX_SIZE, '0');
+
+        CryptoPP::AutoSeededRandomPool rng;
+        header.iv.resize(CryptFormat::IV_SIZE);
+        rng.GenerateBlock(header.iv.data(), header.iv.size());
+
+        // An empty file still produces one (empty) final record.
+        Layout layout;
+        layout.plainSize = fs::file_size(inputPath);
+        layout.chunkCount = std::max<uint64_t>(1, (layout.plainSize + header.chunkSize - 1) / header.chunkSize);
+        uint64_t segmentCount = (layout.chunkCount + header.segmentChunks - 1) / header.segmentChunks;
+        if (segmentCount > CryptFormat::MAX_SEGMENT_COUNT) {
+            error = "File is too large for segmented encryption.";
+            return false;
+        }
+        header.segmentTable.assign(static_cast<size_t>(segmentCount) * CryptFormat::MD5_SIZE, 0);
+        layout.dataStart = CryptFormat::dataOffset(header);
+
+        {
+            std::ofstream outFile(outputPath, std::ios::binary | std::ios::trunc);
+            if (!outFile.is_open()) {
+                error = "Cannot open output file.";
+                return false;
+            }
+            CryptFormat::writeHeader(outFile, header);
+        }
+
+        bool ok = runSegments(segmentCount, jobs, [&](uint64_t segment, std::string& segmentError) {
+            return encryptSegment(inputPath, outputPath, key, header, layout, segment,
+                &header.segmentTable[static_cast<size_t>(segment) * CryptFormat::MD5_SIZE], segmentError);
+        }, error);
+
+        if (ok) {
+            header.md5 = tableDigest(header.segmentTable);
+            std::fstream outFile(outputPath, std::ios::in | std::ios::out | std::ios::binary);
+            CryptFormat::writeHeader(outFile, header);
+            if (!outFile) {
+                error = "Failed writing output file.";
+                ok = false;
+            }
+        }
+
+        if (!ok) {
+            std::remove(outputPath.c_str());
+            return false;
+        }
+        return true;
+    }
+    catch (const std::exception& e) {
+        error = e.what();
+        return false;
+    }
+}
+
+bool SegmentedCipher::decryptFile(const std::string& inputPath, const std::string& outputPath,
+    const std::vector<uint8_t>& key, const CryptFormat::Header& header, size_t jobs, std::string& error) {
+    std::string tempPath = outputPath + ".part";
+    try {
+        if (key.size() != 16 && key.size() != 24 && key.size() != 32) {
+            error = "Invalid key length.";
+            return false;
+        }
+
+        const uint64_t recordSize = static_cast<uint64_t>(header.chunkSize) + CryptFormat::TAG_SIZE;
+        Layout layout;
+        layout.dataStart = CryptFormat::dataOffset(header);
+        uint64_t fileSize = fs::file_size(inputPath);
+        if (fileSize < layout.dataStart + CryptFormat::TAG_SIZE) {
+            error = "Encrypted file is truncated.";
+            return false;
+        }
+
+        uint64_t dataSize = fileSize - layout.dataStart;
+        layout.chunkCount = (dataSize + recordSize - 1) / recordSize;
+        uint64_t lastRecord = dataSize - (layout.chunkCount - 1) * recordSize;
+        uint64_t segmentCount = header.segmentTable.size() / CryptFormat::MD5_SIZE;
+        if (lastRecord < CryptFormat::TAG_SIZE ||
+            segmentCount != (layout.chunkCount + header.segmentChunks - 1) / header.segmentChunks) {
+            error = "Encrypted file is truncated.";
+            return false;
+        }
+        layout.plainSize = dataSize - layout.chunkCount * CryptFormat::TAG_SIZE;
+
+        if (tableDigest(header.segmentTable) != header.md5) {
+            error = "File integrity check failed - possible corruption.";
+            return false;
+        }
+
+        {
+            std::ofstream outFile(tempPath, std::ios::binary | std::ios::trunc);
+            if (!outFile.is_open()) {
+                error = "Cannot create output file.";
+                return false;
+            }
+        }
+
+        bool ok = runSegments(segmentCount, jobs, [&](uint64_t segment, std::string& segmentError) {
+            return decryptSegment(inputPath, tempPath, key, header, layout, segment, segmentError);
+        }, error);
+
+        if (!ok) {
+            std::remove(tempPath.c_str());
+            return false;
+        }
+
+        std::remove(outputPath.c_str());
+        if (std::rename(tempPath.c_str(), outputPath.c_str()) != 0) {
+            error = "Cannot create output file.";
+            std::remove(tempPath.c_str());
+            return false;
+        }
+        return true;
+    }
+    catch (const std::exception& e) {
+        std::remove(tempPath.c_str());
+        error = std::string("Decryption error: ") + e.what();
+        return false;
+    }
+}
\ No newline at end of file
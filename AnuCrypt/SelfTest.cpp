@@ -0,0 +1,404 @@
+#include "SelfTest.h"
+#include "Base64Codec.h"
+#include "Base64Stream.h"
+#include "ChunkedCipher.h"
+#include "CryptoBackend.h"
+#include <cryptopp/base64.h>
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <vector>
+
+namespace {
+    std::vector<uint8_t> randomBytes(std::mt19937& rng, size_t size) {
+        std::vector<uint8_t> data(size);
+        for (auto& byte : data) {
+            byte = static_cast<uint8_t>(rng());
+        }
+        return data;
+    }
+
+    // What Base64Encoder::encode produced before Base64Codec existed.
+    std::string cryptoPPEncode(const std::vector<uint8_t>& data) {
+        std::string encoded;
+        CryptoPP::Base64Encoder encoder;
+        encoder.Put(data.data(), data.size());
+        encoder.MessageEnd();
+        CryptoPP::word64 size = encoder.MaxRetrievable();
+        if (size) {
+            encoded.resize(static_cast<size_t>(size));
+            encoder.Get(reinterpret_cast<CryptoPP::byte*>(&encoded[0]), encoded.size());
+        }
+        while (!encoded.empty() && (encoded.back() == '\n' || encoded.back() == '\r')) {
+            encoded.pop_back();
+        }
+        return encoded;
+    }
+
+    std::string describe(const char* what, Base64Codec::Implementation impl, const Base64Codec::Options& options,
+        size_t length) {
+        std::ostringstream text;
+        text << what << " differs: " << Base64Codec::implementationName(impl) << ", "
+             << (options.alphabet == Base64Codec::URL_SAFE ? "URL-safe" : "standard") << " alphabet, line length "
+             << options.lineLength << (options.padding ? "" : ", no padding") << ", " << options.threads
+             << " thread(s), " << length << " bytes";
+        return text.str();
+    }
+
+    // Encodes data with impl and the given options and compares the result, and
+    // its decoding, with the scalar codec.
+    bool compareWithScalar(Base64Codec::Implementation impl, const Base64Codec::Options& options,
+        const std::vector<uint8_t>& data, std::string& error) {
+        Base64Codec::Options single = options;
+        single.threads = 1;
+        Base64Codec::setImplementation(Base64Codec::SCALAR);
+        std::string expected = Base64Codec::encode(data.data(), data.size(), single);
+
+        Base64Codec::setImplementation(impl);
+        std::string encoded = Base64Codec::encode(data.data(), data.size(), options);
+        if (encoded != expected) {
+            error = describe("Encoding", impl, options, data.size());
+            return false;
+        }
+        std::vector<uint8_t> decoded = Base64Codec::decode(encoded.data(), encoded.size(), options);
+        if (decoded != data) {
+            error = describe("Decoding", impl, options, data.size());
+            return false;
+        }
+        return true;
+    }
+
+    std::string describe(const char* what, const CryptoBackend& backend, const CryptoBackend& reference,
+        size_t length) {
+        std::ostringstream text;
+        text << what << " from " << backend.name() << " differs from " << reference.name() << " at " << length
+             << " bytes";
+        return text.str();
+    }
+
+    // Seals each input with both backends and checks that each opens the
+    // other's record and rejects it once the tag is changed.
+    bool compareGcm(const CryptoBackend& backend, const CryptoBackend& reference, std::mt19937& rng,
+        const std::vector<size_t>& lengths, std::string& error) {
+        const size_t TAG_SIZE = CryptFormat::TAG_SIZE;
+        for (size_t keySize : { 16, 32 }) {
+            std::vector<uint8_t> key = randomBytes(rng, keySize);
+            std::unique_ptr<GcmCipher> expectedGcm = reference.newGcm();
+            std::unique_ptr<GcmCipher> gcm = backend.newGcm();
+            expectedGcm->setKey(key.data(), key.size());
+            gcm->setKey(key.data(), key.size());
+
+            for (size_t length : lengths) {
+                std::vector<uint8_t> nonce = randomBytes(rng, CryptFormat::IV_SIZE);
+                std::vector<uint8_t> aad = randomBytes(rng, length % 2);
+                std::vector<uint8_t> plaintext = randomBytes(rng, length);
+                std::vector<uint8_t> expected(length + TAG_SIZE);
+                std::vector<uint8_t> sealed(length + TAG_SIZE);
+                expectedGcm->seal(nonce.data(), nonce.size(), aad.data(), aad.size(), plaintext.data(), length,
+                                  expected.data(), expected.data() + length, TAG_SIZE);
+                gcm->seal(nonce.data(), nonce.size(), aad.data(), aad.size(), plaintext.data(), length,
+                          sealed.data(), sealed.data() + length, TAG_SIZE);
+                if (sealed != expected) {
+                    error = describe("GCM record", backend, reference, length);
+                    return false;
+                }
+
+                std::vector<uint8_t> opened(length);
+                GcmCipher* openers[] = { gcm.get(), expectedGcm.get() };
+                for (GcmCipher* opener : openers) {
+                    if (!opener->open(nonce.data(), nonce.size(), aad.data(), aad.size(), sealed.data(), length,
+                                      sealed.data() + length, TAG_SIZE, opened.data()) || opened != plaintext) {
+                        error = describe("GCM open", backend, reference, length);
+                        return false;
+                    }
+                }
+                sealed[length] ^= 1;
+                if (gcm->open(nonce.data(), nonce.size(), aad.data(), aad.size(), sealed.data(), length,
+                              sealed.data() + length, TAG_SIZE, opened.data())) {
+                    error = describe("GCM open of a bad tag", backend, reference, length);
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    // The backend is fed in uneven pieces, the reference all at once, so
+    // buffering across block boundaries is covered too.
+    bool compareHashes(const CryptoBackend& backend, const CryptoBackend& reference, std::mt19937& rng,
+        const std::vector<size_t>& lengths, std::string& error) {
+        const Hashing::Algorithm algs[] = { Hashing::MD5_ALG, Hashing::SHA1_ALG, Hashing::SHA256_ALG };
+        for (Hashing::Algorithm alg : algs) {
+            std::unique_ptr<HashContext> expectedHash = reference.newHash(alg);
+            std::unique_ptr<HashContext> hash = backend.newHash(alg);
+            for (size_t length : lengths) {
+                std::vector<uint8_t> data = randomBytes(rng, length);
+                uint8_t expected[Digest::MAX_SIZE] = { 0 };
+                uint8_t digest[Digest::MAX_SIZE] = { 0 };
+                expectedHash->init();
+                expectedHash->update(data.data(), data.size());
+                expectedHash->final(expected);
+
+                hash->init();
+                size_t offset = 0;
+                for (size_t piece = 1; offset < data.size(); piece = piece * 3 + 1) {
+                    size_t size = std::min(piece, data.size() - offset);
+                    hash->update(data.data() + offset, size);
+                    offset += size;
+                }
+                hash->final(digest);
+                if (!std::equal(digest, digest + Digest::MAX_SIZE, expected)) {
+                    error = describe(Hashing::algorithmName(alg), backend, reference, length);
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    // A chunked .crypt file as EncryptionSession writes it, with the IV fixed
+    // and GCM and MD5 taken from backend.
+    bool writeCryptFile(const CryptoBackend& backend, uint8_t algId, const std::vector<uint8_t>& key,
+        const std::vector<uint8_t>& iv, uint32_t chunkSize, const std::vector<uint8_t>& data, std::string& file,
+        std::string& error) {
+        CryptoBackend::use(CryptoBackend::GCM_PRIMITIVE, backend);
+        CryptoBackend::use(CryptoBackend::MD5_PRIMITIVE, backend);
+        ChunkedCipher::EncryptContext context;
+        context.gcm->setKey(key.data(), key.size());
+
+        CryptFormat::Header header;
+        header.algId = algId;
+        header.iv = iv;
+        header.md5.assign(CryptFormat::MD5_HEX_SIZE, '0');
+        header.chunkSize = chunkSize;
+
+        std::istringstream in(std::string(data.begin(), data.end()));
+        std::stringstream out;
+        CryptFormat::writeHeader(out, header);
+        std::string md5;
+        if (!ChunkedCipher::encrypt(in, out, context, header, md5, error)) {
+            return false;
+        }
+        if (!CryptFormat::patchMD5(out, md5)) {
+            error = "Failed writing test file.";
+            return false;
+        }
+        file = out.str();
+        return true;
+    }
+
+    bool compareCryptFiles(const CryptoBackend& backend, const CryptoBackend& reference, std::mt19937& rng,
+        uint32_t chunkSize, std::string& error) {
+        const size_t lengths[] = { 0, 1, chunkSize, 3 * static_cast<size_t>(chunkSize) + 100 };
+        for (size_t keySize : { 16, 32 }) {
+            uint8_t algId = keySize == 16 ? CryptFormat::AES128_CHUNKED : CryptFormat::AES256_CHUNKED;
+            std::vector<uint8_t> key = randomBytes(rng, keySize);
+            for (size_t length : lengths) {
+                std::vector<uint8_t> iv = randomBytes(rng, CryptFormat::IV_SIZE);
+                std::vector<uint8_t> data = randomBytes(rng, length);
+                std::string expected;
+                std::string file;
+                if (!writeCryptFile(reference, algId, key, iv, chunkSize, data, expected, error) ||
+                    !writeCryptFile(backend, algId, key, iv, chunkSize, data, file, error)) {
+                    return false;
+                }
+                if (file != expected) {
+                    error = describe(keySize == 16 ? "AES-128 .crypt file" : "AES-256 .crypt file", backend,
+                                     reference, length);
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+}
+
+bool SelfTest::checkBase64(std::ostream& out, std::string& error) {
+    std::mt19937 rng(SEED);
+    const Base64Codec::Implementation kernels[] = { Base64Codec::SCALAR, Base64Codec::SSSE3, Base64Codec::AVX2 };
+
+    std::vector<Base64Codec::Options> variants(4);
+    variants[1].alphabet = Base64Codec::URL_SAFE;
+    variants[1].lineLength = 0;
+    variants[2].lineLength = 0;
+    variants[2].padding = false;
+    variants[3].alphabet = Base64Codec::URL_SAFE;
+    variants[3].lineLength = 76;
+    variants[3].padding = false;
+
+    // Every length mod 3 over several kernel blocks and 72-column lines, then
+    // around a 4 KiB boundary.
+    std::vector<size_t> lengths;
+    for (size_t length = 0; length <= 300; ++length) {
+        lengths.push_back(length);
+    }
+    for (size_t length = 4090; length <= 4102; ++length) {
+        lengths.push_back(length);
+    }
+
+    bool ok = true;
+    for (Base64Codec::Implementation impl : kernels) {
+        if (!Base64Codec::setImplementation(impl)) {
+            out << "Base64 " << Base64Codec::implementationName(impl) << ": not supported on this CPU, skipped\n";
+            continue;
+        }
+        for (size_t length : lengths) {
+            std::vector<uint8_t> data = randomBytes(rng, length);
+            for (const auto& options : variants) {
+                if (!compareWithScalar(impl, options, data, error)) {
+                    ok = false;
+                    break;
+                }
+            }
+            if (!ok) {
+                break;
+            }
+        }
+        if (!ok) {
+            break;
+        }
+        out << "Base64 " << Base64Codec::implementationName(impl) << ": " << lengths.size() << " lengths x "
+            << variants.size() << " option sets match scalar\n";
+    }
+
+    // Inputs large enough to be split across threads, ending on and off a
+    // group and line boundary.
+    if (ok) {
+        const size_t bigLengths[] = { (3 << 20) - 1, 3 << 20, (3 << 20) + 1, (3 << 20) + 2 };
+        for (size_t length : bigLengths) {
+            std::vector<uint8_t> data = randomBytes(rng, length);
+            for (Base64Codec::Implementation impl : kernels) {
+                if (!Base64Codec::setImplementation(impl)) {
+                    continue;
+                }
+                for (auto options : variants) {
+                    options.threads = 4;
+                    if (!compareWithScalar(impl, options, data, error)) {
+                        ok = false;
+                        break;
+                    }
+                }
+                if (!ok) {
+                    break;
+                }
+            }
+            if (!ok) {
+                break;
+            }
+        }
+        if (ok) {
+            out << "Base64 threaded split: matches scalar\n";
+        }
+    }
+
+    Base64Codec::setImplementation(Base64Codec::AUTO);
+
+    // The streaming encoder reads in blocks; its output must not show the seams.
+    if (ok) {
+        std::vector<uint8_t> data = randomBytes(rng, (5 << 20) / 2 + 7);
+        Base64Codec::Options options;
+        std::string expected = Base64Codec::encode(data.data(), data.size(), options);
+        for (size_t threads : { 1, 4 }) {
+            options.threads = threads;
+            std::istringstream in(std::string(data.begin(), data.end()));
+            std::ostringstream encoded;
+            std::ostringstream decoded;
+            std::istringstream encodedIn;
+            if (!Base64Stream::encode(in, encoded, options, error)) {
+                ok = false;
+                break;
+            }
+            encodedIn.str(encoded.str());
+            if (encoded.str() != expected || !Base64Stream::decode(encodedIn, decoded, options, error) ||
+                decoded.str() != std::string(data.begin(), data.end())) {
+                error = "Base64Stream differs from Base64Codec with " + std::to_string(threads) + " thread(s)";
+                ok = false;
+                break;
+            }
+        }
+        if (ok) {
+            out << "Base64 streaming: matches Base64Codec\n";
+        }
+    }
+
+    // Default options must still give exactly what the Crypto++ encoder gave.
+    if (ok) {
+        Base64Codec::Options options;
+        for (size_t length : lengths) {
+            std::vector<uint8_t> data = randomBytes(rng, length);
+            if (Base64Codec::encode(data.data(), data.size(), options) != cryptoPPEncode(data)) {
+                error = "Encoding differs from the Crypto++ Base64Encoder at " + std::to_string(length) + " bytes";
+                ok = false;
+                break;
+            }
+        }
+        if (ok) {
+            out << "Base64 " << Base64Codec::implementationName(Base64Codec::implementation())
+                << ": matches the Crypto++ encoder\n";
+        }
+    }
+    return ok;
+}
+
+bool SelfTest::checkBackends(std::ostream& out, std::string& error) {
+    const std::vector<const CryptoBackend*>& backends = CryptoBackend::available();
+    const CryptoBackend& reference = *backends[0];
+    if (backends.size() < 2) {
+        out << "Backends: only " << reference.name() << " is built in, skipped\n";
+        return true;
+    }
+
+    std::mt19937 rng(SEED);
+    // Around the AES block, the 64-byte hash block and the padding cases, then
+    // a record much larger than any internal buffer.
+    std::vector<size_t> lengths;
+    for (size_t length = 0; length <= 130; ++length) {
+        lengths.push_back(length);
+    }
+    lengths.push_back(4096);
+    lengths.push_back((1 << 20) + 13);
+
+    const CryptoBackend* saved[CryptoBackend::PRIMITIVE_COUNT];
+    for (int primitive = 0; primitive < CryptoBackend::PRIMITIVE_COUNT; ++primitive) {
+        saved[primitive] = &CryptoBackend::current(static_cast<CryptoBackend::Primitive>(primitive));
+    }
+
+    bool ok = true;
+    try {
+        for (size_t i = 1; i < backends.size() && ok; ++i) {
+            const CryptoBackend& backend = *backends[i];
+            ok = compareGcm(backend, reference, rng, lengths, error) &&
+                 compareHashes(backend, reference, rng, lengths, error) &&
+                 compareCryptFiles(backend, reference, rng, TEST_CHUNK_SIZE, error);
+            if (ok) {
+                out << "Backend " << backend.name() << ": GCM, MD5, SHA-1, SHA-256 and .crypt files match "
+                    << reference.name() << "\n";
+            }
+        }
+    }
+    catch (const std::exception& e) {
+        error = std::string("Backend check failed: ") + e.what();
+        ok = false;
+    }
+
+    for (int primitive = 0; primitive < CryptoBackend::PRIMITIVE_COUNT; ++primitive) {
+        CryptoBackend::use(static_cast<CryptoBackend::Primitive>(primitive), *saved[primitive]);
+    }
+    return ok;
+}
+
+bool SelfTest::run(std::ostream& out) {
+    std::string error;
+    bool ok = true;
+    if (!checkBase64(out, error)) {
+        out << "FAILED: " << error << "\n";
+        ok = false;
+    }
+    if (!checkBackends(out, error)) {
+        out << "FAILED: " << error << "\n";
+        ok = false;
+    }
+    out << (ok ? "All checks passed" : "Some checks failed") << std::endl;
+    return ok;
+}
\ No newline at end of file
@@ -0,0 +1,28 @@
+#pragma once
+#include <string>
+#include <iostream>
+#include <cstdint>
+
+// Checks that code paths which must produce the same bytes do, on this CPU and
+// this build: the Base64 kernels and threaded split against the scalar codec
+// (and the Crypto++ encoder it replaced), and every crypto backend against
+// Crypto++. Inputs are pseudo-random from a fixed seed, so a failure
+// reproduces. Run by --selftest.
+class SelfTest {
+public:
+    // Each check prints a line per part to out and stops at the first mismatch,
+    // describing it in error.
+    static bool checkBase64(std::ostream& out, std::string& error);
+
+    // GCM records, digests and whole .crypt files from each backend. Leaves the
+    // backend selections as it found them.
+    static bool checkBackends(std::ostream& out, std::string& error);
+
+    // Runs every check; true when all of them pass.
+    static bool run(std::ostream& out);
+
+private:
+    static const uint32_t SEED = 0x41a7c0de;
+    // Small enough that the test files hold many records, including a short last one.
+    static const uint32_t TEST_CHUNK_SIZE = 4096;
+};
\ No newline at end of file
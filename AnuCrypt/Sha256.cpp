@@ -1,21 +1,26 @@
 #include "Sha256.h"
-#include <cryptopp/sha.h>
-#include <cryptopp/hex.h>
-#include <cryptopp/filters.h>
+#include "CryptoBackend.h"
 
 std::string Sha256::hash(const std::vector<uint8_t>& data) {
-    try {
-        CryptoPP::byte digest[CryptoPP::SHA256::DIGESTSIZE];
-        CryptoPP::SHA256().CalculateDigest(digest, data.data(), data.size());
-
-        std::string output;
-        CryptoPP::HexEncoder encoder(new CryptoPP::StringSink(output));
-        encoder.Put(digest, sizeof(digest));
-        encoder.MessageEnd();
+    return hash(data.data(), data.size());
+}
 
-        return output;
+std::string Sha256::hash(const uint8_t* data, size_t size) {
+    try {
+        SHA256Digest value = digest(data, size);
+        char hex[Digest::HEX_CAPACITY];
+        return std::string(hex, Digest::toHex(value.data(), value.size(), hex));
     }
     catch (...) {
         return "";
     }
+}
+
+SHA256Digest Sha256::digest(const uint8_t* data, size_t size) {
+    static_assert(sizeof(SHA256Digest) == 32, "digest size mismatch");
+    SHA256Digest value;
+    HashContext& context = CryptoBackend::threadHash(Hashing::SHA256_ALG);
+    context.update(data, size);
+    context.final(value.data());
+    return value;
 }
\ No newline at end of file
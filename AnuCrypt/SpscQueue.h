@@ -0,0 +1,44 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+// Bounded single-producer, single-consumer ring. Exactly one thread may push
+// and one other thread may pop; neither ever takes a lock. Head and tail live
+// on separate cache lines so the two sides do not keep stealing each other's.
+template <typename T>
+class SpscQueue {
+public:
+    explicit SpscQueue(size_t capacity)
+        : m_slots(capacity + 1), m_head(0), m_tail(0) {
+    }
+
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    bool push(const T& value) {
+        size_t tail = m_tail.load(std::memory_order_relaxed);
+        size_t next = tail + 1 == m_slots.size() ? 0 : tail + 1;
+        if (next == m_head.load(std::memory_order_acquire)) {
+            return false;
+        }
+        m_slots[tail] = value;
+        m_tail.store(next, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(T& value) {
+        size_t head = m_head.load(std::memory_order_relaxed);
+        if (head == m_tail.load(std::memory_order_acquire)) {
+            return false;
+        }
+        value = m_slots[head];
+        m_head.store(head + 1 == m_slots.size() ? 0 : head + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    std::vector<T> m_slots;
+    alignas(64) std::atomic<size_t> m_head;
+    alignas(64) std::atomic<size_t> m_tail;
+};
\ No newline at end of file
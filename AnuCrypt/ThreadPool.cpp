@@ -0,0 +1,135 @@
+#include "ThreadPool.h"
+
+namespace {
+    thread_local const ThreadPool* currentPool = nullptr;
+    thread_local size_t currentIndex = 0;
+}
+
+ThreadPool::ThreadPool(size_t threads, size_t maxQueued)
+    : m_nextQueue(0), m_maxQueued(maxQueued), m_queued(0), m_pending(0), m_stopping(false) {
+    if (threads == 0) {
+        threads = 1;
+    }
+
+    for (size_t i = 0; i < threads; ++i) {
+        m_queues.push_back(std::unique_ptr<WorkQueue>(new WorkQueue()));
+    }
+    for (size_t i = 0; i < threads; ++i) {
+        m_threads.emplace_back(&ThreadPool::workerLoop, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    wait();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_workAvailable.notify_all();
+    for (auto& thread : m_threads) {
+        thread.join();
+    }
+}
+
+size_t ThreadPool::size() const {
+    return m_threads.size();
+}
+
+size_t ThreadPool::workerIndex() const {
+    return currentPool == this ? currentIndex : size();
+}
+
+size_t ThreadPool::defaultThreadCount() {
+    unsigned int count = std::thread::hardware_concurrency();
+    return count > 0 ? count : 1;
+}
+
+void ThreadPool::submit(std::function<void()> task) {
+    size_t index = workerIndex();
+    bool external = index == size();
+
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (external && m_maxQueued > 0) {
+            m_spaceAvailable.wait(lock, [this] { return m_queued < m_maxQueued; });
+        }
+        ++m_queued;
+        ++m_pending;
+    }
+
+    if (external) {
+        index = m_nextQueue.fetch_add(1) % size();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_queues[index]->mutex);
+        m_queues[index]->tasks.push_back(std::move(task));
+    }
+    m_workAvailable.notify_one();
+}
+
+void ThreadPool::wait() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_idle.wait(lock, [this] { return m_pending == 0; });
+}
+
+bool ThreadPool::popTask(size_t index, std::function<void()>& task) {
+    {
+        WorkQueue& own = *m_queues[index];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty()) {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            return true;
+        }
+    }
+
+    for (size_t offset = 1; offset < m_queues.size(); ++offset) {
+        WorkQueue& victim = *m_queues[(index + offset) % m_queues.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::workerLoop(size_t index) {
+    currentPool = this;
+    currentIndex = index;
+
+    while (true) {
+        std::function<void()> task;
+        if (popTask(index, task)) {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                --m_queued;
+            }
+            m_spaceAvailable.notify_one();
+
+            try {
+                task();
+            }
+            catch (...) {
+                // Tasks report their own failures; never let one take down the pool.
+            }
+
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (--m_pending == 0) {
+                m_idle.notify_all();
+            }
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (m_stopping && m_pending == 0) {
+            return;
+        }
+        m_workAvailable.wait(lock, [this] { return m_stopping || m_queued > 0; });
+        if (m_stopping && m_queued == 0) {
+            return;
+        }
+    }
+}
\ No newline at end of file
@@ -0,0 +1,57 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Work-stealing thread pool. Every worker owns a deque: it pops its own work from
+// the back and, when empty, steals from the front of the other workers' deques.
+// Tasks submitted from outside the pool are spread round-robin; tasks submitted
+// from a worker go to that worker's own deque.
+class ThreadPool {
+public:
+    // maxQueued > 0 makes submit() from outside the pool block while that many
+    // tasks are waiting, so a fast producer cannot queue an entire directory tree.
+    explicit ThreadPool(size_t threads, size_t maxQueued = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    void submit(std::function<void()> task);
+    void wait();
+
+    size_t size() const;
+
+    // Index of the calling worker thread in [0, size()), or size() when called
+    // from a thread that does not belong to this pool.
+    size_t workerIndex() const;
+
+    static size_t defaultThreadCount();
+
+private:
+    struct WorkQueue {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    void workerLoop(size_t index);
+    bool popTask(size_t index, std::function<void()>& task);
+
+    std::vector<std::unique_ptr<WorkQueue>> m_queues;
+    std::vector<std::thread> m_threads;
+    std::atomic<size_t> m_nextQueue;
+    size_t m_maxQueued;
+
+    std::mutex m_mutex;
+    std::condition_variable m_workAvailable;
+    std::condition_variable m_spaceAvailable;
+    std::condition_variable m_idle;
+    size_t m_queued;
+    size_t m_pending;
+    bool m_stopping;
+};
\ No newline at end of file